@@ -125,12 +125,12 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage)
 
     // Update lastPing for our masternode in Masternode list
     pmn->lastPing = mnp;
-    mnodeman.mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    mnodeman.AddSeenPing(mnp);
 
     //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
     CMasternodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
-    if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = mnp;
+    mnodeman.UpdateSeenBroadcastPing(hash, mnp);
 
     mnp.Relay();
     return true;
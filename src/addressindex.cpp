@@ -0,0 +1,70 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+
+#include "coins.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "undo.h"
+
+bool GetAddressIndexKey(const CTxDestination& dest, uint8_t& type, uint160& hashBytes)
+{
+    if (const CKeyID* keyID = boost::get<CKeyID>(&dest)) {
+        type = ADDRESS_INDEX_KEY;
+        hashBytes = *keyID;
+        return true;
+    }
+    if (const CScriptID* scriptID = boost::get<CScriptID>(&dest)) {
+        type = ADDRESS_INDEX_SCRIPT;
+        hashBytes = *scriptID;
+        return true;
+    }
+    return false;
+}
+
+bool GetAddressIndexKey(const CScript& script, uint8_t& type, uint160& hashBytes)
+{
+    CTxDestination dest;
+    return ExtractDestination(script, dest) && GetAddressIndexKey(dest, type, hashBytes);
+}
+
+void GetAddressIndexChanges(const CBlock& block, const CBlockUndo& blockundo, int nHeight, CAddressIndexBlock& changes, bool fUnspent)
+{
+    uint8_t type;
+    uint160 hashBytes;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+
+        // the coinbase spends nothing, and has no undo entry
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            for (unsigned int j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                if (!GetAddressIndexKey(coin.out.scriptPubKey, type, hashBytes))
+                    continue;
+                changes.vIndex.emplace_back(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, j, true), -coin.out.nValue);
+                if (fUnspent) {
+                    const COutPoint& prevout = tx.vin[j].prevout;
+                    changes.vUnspent.emplace_back(CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n),
+                                                  CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight),
+                                                  true);
+                }
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            if (!GetAddressIndexKey(out.scriptPubKey, type, hashBytes))
+                continue;
+            changes.vIndex.emplace_back(CAddressIndexKey(type, hashBytes, nHeight, i, txhash, k, false), out.nValue);
+            if (fUnspent) {
+                changes.vUnspent.emplace_back(CAddressUnspentKey(type, hashBytes, txhash, k),
+                                              CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight),
+                                              false);
+            }
+        }
+    }
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include "amount.h"
+#include "script/script.h"
+#include "script/standard.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/** Kinds of destination the address index keys its entries by */
+enum AddressIndexType : uint8_t {
+    ADDRESS_INDEX_NONE = 0,
+    ADDRESS_INDEX_KEY = 1,     //!< pay to pubkey hash, and pay to pubkey under the key's hash
+    ADDRESS_INDEX_SCRIPT = 2,  //!< pay to script hash
+};
+
+/**
+ * One credit (an output) or debit (a spent input) of an address. Heights and positions are
+ * stored big endian, so that the entries of an address are ordered as in the chain.
+ */
+struct CAddressIndexKey {
+    uint8_t type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    unsigned int index;
+    bool spending;
+
+    CAddressIndexKey() { SetNull(); }
+
+    CAddressIndexKey(uint8_t typeIn, const uint160& hashBytesIn, int blockHeightIn, unsigned int txindexIn,
+                     const uint256& txhashIn, unsigned int indexIn, bool spendingIn) : type(typeIn),
+                                                                                       hashBytes(hashBytesIn),
+                                                                                       blockHeight(blockHeightIn),
+                                                                                       txindex(txindexIn),
+                                                                                       txhash(txhashIn),
+                                                                                       index(indexIn),
+                                                                                       spending(spendingIn) {}
+
+    void SetNull()
+    {
+        type = ADDRESS_INDEX_NONE;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+        spending = ser_readdata8(s);
+    }
+};
+
+/** Prefix of the index entries of an address from a height on, to seek to */
+struct CAddressIndexIteratorKey {
+    uint8_t type;
+    uint160 hashBytes;
+    int blockHeight;
+
+    CAddressIndexIteratorKey(uint8_t typeIn, const uint160& hashBytesIn, int blockHeightIn = 0) : type(typeIn),
+                                                                                                  hashBytes(hashBytesIn),
+                                                                                                  blockHeight(blockHeightIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+    }
+};
+
+/** An unspent output of an address */
+struct CAddressUnspentKey {
+    uint8_t type;
+    uint160 hashBytes;
+    uint256 txhash;
+    unsigned int index;
+
+    CAddressUnspentKey() { SetNull(); }
+
+    CAddressUnspentKey(uint8_t typeIn, const uint160& hashBytesIn, const uint256& txhashIn, unsigned int indexIn) : type(typeIn),
+                                                                                                                 hashBytes(hashBytesIn),
+                                                                                                                 txhash(txhashIn),
+                                                                                                                 index(indexIn) {}
+
+    void SetNull()
+    {
+        type = ADDRESS_INDEX_NONE;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+};
+
+/** Prefix of the unspent outputs of an address, to seek to */
+struct CAddressUnspentIteratorKey {
+    uint8_t type;
+    uint160 hashBytes;
+
+    CAddressUnspentIteratorKey(uint8_t typeIn, const uint160& hashBytesIn) : type(typeIn), hashBytes(hashBytesIn) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+    }
+};
+
+struct CAddressUnspentValue {
+    CAmount satoshis;
+    CScript script;
+    int blockHeight;
+
+    CAddressUnspentValue() { SetNull(); }
+
+    CAddressUnspentValue(CAmount satoshisIn, const CScript& scriptIn, int blockHeightIn) : satoshis(satoshisIn),
+                                                                                        script(scriptIn),
+                                                                                        blockHeight(blockHeightIn) {}
+
+    void SetNull()
+    {
+        satoshis = -1;
+        script.clear();
+        blockHeight = 0;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(satoshis);
+        READWRITE(*(CScriptBase*)(&script));
+        READWRITE(blockHeight);
+    }
+};
+
+/** An output a block adds to (fSpent false) or takes from (fSpent true) the unspent outputs of an address */
+struct CAddressUnspentChange {
+    CAddressUnspentKey key;
+    CAddressUnspentValue value;
+    bool fSpent;
+
+    CAddressUnspentChange(const CAddressUnspentKey& keyIn, const CAddressUnspentValue& valueIn, bool fSpentIn) : key(keyIn),
+                                                                                                               value(valueIn),
+                                                                                                               fSpent(fSpentIn) {}
+};
+
+/** Everything connecting a block changes in the address index, in the order of the block */
+struct CAddressIndexBlock {
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vIndex;
+    std::vector<CAddressUnspentChange> vUnspent;
+
+    void clear()
+    {
+        vIndex.clear();
+        vUnspent.clear();
+    }
+};
+
+/** Type and hash a destination is indexed under, false if it is not indexed */
+bool GetAddressIndexKey(const CTxDestination& dest, uint8_t& type, uint160& hashBytes);
+/** Type and hash the outputs paying to a script are indexed under, false if they are not indexed */
+bool GetAddressIndexKey(const CScript& script, uint8_t& type, uint160& hashBytes);
+
+/**
+ * Collect the address index changes of a block at height nHeight, its undo data giving the
+ * coins its transactions spend.
+ * @param[in] fUnspent  whether to collect the unspent output changes as well
+ */
+void GetAddressIndexChanges(const CBlock& block, const CBlockUndo& blockundo, int nHeight, CAddressIndexBlock& changes, bool fUnspent = true);
+
+#endif // BITCOIN_ADDRESSINDEX_H
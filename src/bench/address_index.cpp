@@ -0,0 +1,105 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "pubkey.h"
+#include "txdb.h"
+#include "util.h"
+#include "utiltime.h"
+
+#include <iostream>
+
+// Queries of the address index on an address with a million entries, as busy exchange
+// and pool addresses have: 600000 outputs paid to it over 100000 blocks, two thirds of
+// them spent again. Prints the latency of a single query.
+static const int INDEX_BLOCKS = 100000;
+static const int INDEX_OUTPUTS_PER_BLOCK = 6;
+static const int INDEX_SPENT_PER_BLOCK = 4;
+
+static const uint160 hashIndexed(0x1111111111111111ULL);
+
+static void FillAddressIndex(CBlockTreeDB& db)
+{
+    const CScript script = GetScriptForDestination(CKeyID(hashIndexed));
+    CAddressIndexBlock changes;
+    for (int nHeight = 1; nHeight <= INDEX_BLOCKS; nHeight++) {
+        const uint256 txhash = ArithToUint256(arith_uint256(nHeight));
+        for (int n = 0; n < INDEX_OUTPUTS_PER_BLOCK; n++) {
+            changes.vIndex.emplace_back(CAddressIndexKey(ADDRESS_INDEX_KEY, hashIndexed, nHeight, 1, txhash, n, false), COIN);
+            // all but every third output are spent by the next block
+            if (n % 3)
+                changes.vIndex.emplace_back(CAddressIndexKey(ADDRESS_INDEX_KEY, hashIndexed, nHeight + 1, 2, txhash, n, true), -COIN);
+            else
+                changes.vUnspent.emplace_back(CAddressUnspentKey(ADDRESS_INDEX_KEY, hashIndexed, txhash, n), CAddressUnspentValue(COIN, script, nHeight), false);
+        }
+        if (nHeight % 1000 == 0) {
+            db.WriteAddressIndex(changes);
+            changes.clear();
+        }
+    }
+}
+
+static void AddressIndexQuery(benchmark::State& state, const char* strName, const std::function<void(CBlockTreeDB&)>& query)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const fs::path pathTemp = GetTempPath() / strprintf("bench_address_index_%lu", (unsigned long)GetTime());
+    fs::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+    {
+        CBlockTreeDB db(1 << 23, true);
+        FillAddressIndex(db);
+
+        int64_t nTotal = 0;
+        int nQueries = 0;
+        while (state.KeepRunning()) {
+            const int64_t nStart = GetTimeMicros();
+            query(db);
+            nTotal += GetTimeMicros() - nStart;
+            nQueries++;
+        }
+        std::cout << "#" << strName << ": " << nTotal / 1000 / std::max(1, nQueries) << " ms per query" << std::endl;
+    }
+    fs::remove_all(pathTemp);
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+}
+
+static void AddressIndexBalance(benchmark::State& state)
+{
+    AddressIndexQuery(state, "AddressIndexBalance", [](CBlockTreeDB& db) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+        db.ReadAddressIndex(ADDRESS_INDEX_KEY, hashIndexed, vEntries);
+        CAmount nBalance = 0;
+        for (const std::pair<CAddressIndexKey, CAmount>& entry : vEntries)
+            nBalance += entry.second;
+        assert(vEntries.size() == (size_t)INDEX_BLOCKS * (INDEX_OUTPUTS_PER_BLOCK + INDEX_SPENT_PER_BLOCK));
+        assert(nBalance == (CAmount)INDEX_BLOCKS * (INDEX_OUTPUTS_PER_BLOCK - INDEX_SPENT_PER_BLOCK) * COIN);
+    });
+}
+
+static void AddressIndexUtxos(benchmark::State& state)
+{
+    AddressIndexQuery(state, "AddressIndexUtxos", [](CBlockTreeDB& db) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+        db.ReadAddressUnspentIndex(ADDRESS_INDEX_KEY, hashIndexed, vUnspent);
+        assert(vUnspent.size() == (size_t)INDEX_BLOCKS * (INDEX_OUTPUTS_PER_BLOCK - INDEX_SPENT_PER_BLOCK));
+    });
+}
+
+static void AddressIndexTxidsRange(benchmark::State& state)
+{
+    // the last 1000 blocks, as an explorer pages through the history of an address
+    AddressIndexQuery(state, "AddressIndexTxidsRange", [](CBlockTreeDB& db) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+        db.ReadAddressIndex(ADDRESS_INDEX_KEY, hashIndexed, vEntries, INDEX_BLOCKS - 999, INDEX_BLOCKS);
+        assert(!vEntries.empty());
+    });
+}
+
+BENCHMARK(AddressIndexBalance);
+BENCHMARK(AddressIndexUtxos);
+BENCHMARK(AddressIndexTxidsRange);
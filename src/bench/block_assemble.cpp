@@ -0,0 +1,54 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "miner.h"
+#include "policy/policy.h"
+#include "txmempool.h"
+
+#include <vector>
+
+// Transaction selection for a new block out of a full memory pool: 50000
+// transactions in chains of five, each chain started by a low fee parent
+// so that the package selection has child-pays-for-parent work to do.
+static const int MEMPOOL_TXS = 50000;
+static const int CHAIN_LENGTH = 5;
+
+static void FillMemPool(CTxMemPool& pool)
+{
+    uint256 hashPrev;
+    for (int i = 0; i < MEMPOOL_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        if (i % CHAIN_LENGTH == 0) {
+            // spends a confirmed output
+            tx.vin[0].prevout = COutPoint(ArithToUint256(arith_uint256(i + 1)), 0);
+        } else {
+            tx.vin[0].prevout = COutPoint(hashPrev, 0);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 100 * COIN;
+
+        const CAmount nFee = (i % CHAIN_LENGTH == 0) ? 1000 : 10000 + (i * 7919) % 40000;
+        hashPrev = tx.GetHash();
+        pool.addUnchecked(hashPrev, CTxMemPoolEntry(tx, nFee, 0, 0.0, 1, i % CHAIN_LENGTH == 0, 0, false, 1));
+    }
+}
+
+static void AssembleBlock(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(0));
+    FillMemPool(pool);
+
+    LOCK(pool.cs);
+    while (state.KeepRunning()) {
+        CBlockTxSelection selection;
+        SelectBlockTransactions(pool, 2, 0, DEFAULT_BLOCK_MAX_SIZE, DEFAULT_BLOCK_PRIORITY_SIZE, DEFAULT_BLOCK_MIN_SIZE, selection);
+    }
+}
+
+BENCHMARK(AssembleBlock);
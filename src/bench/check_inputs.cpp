@@ -0,0 +1,84 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "key.h"
+#include "keystore.h"
+#include "main.h"
+#include "script/sign.h"
+#include "script/standard.h"
+
+// The script checks that ConnectBlock runs through CheckInputs for 1000 P2PKH spends, once
+// with nothing cached and once with the mempool having accepted every transaction before,
+// so that the script execution cache answers for them.
+static const int CONNECT_TXS = 1000;
+
+static void BuildSpends(CCoinsViewCache& view, std::vector<CTransaction>& vTxs)
+{
+    CBasicKeyStore keystore;
+    CKey key;
+    key.MakeNewKey(true);
+    keystore.AddKey(key);
+    const CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+
+    for (int i = 0; i < CONNECT_TXS; i++) {
+        const COutPoint prevout(ArithToUint256(arith_uint256(i + 1)), 0);
+        view.AddCoin(prevout, Coin(CTxOut(COIN, script), 1, false, false), false);
+        CMutableTransaction tx;
+        tx.vin.emplace_back(prevout);
+        tx.vout.emplace_back(COIN - 10000, script);
+        SignSignature(keystore, script, tx, 0, COIN, SIGHASH_ALL);
+        vTxs.emplace_back(tx);
+    }
+}
+
+static void CheckInputsScripts(benchmark::State& state, bool fWarmMempool)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    InitSignatureCache();
+
+    // CheckInputs takes the spend height from the block index entry of the view's best block
+    CBlockIndex index;
+    index.nHeight = 1000;
+    const uint256 hashBest = ArithToUint256(arith_uint256(CONNECT_TXS + 1));
+    {
+        LOCK(cs_main);
+        mapBlockIndex.emplace(hashBest, &index);
+    }
+
+    CCoinsView base;
+    CCoinsViewCache view(&base);
+    view.SetBestBlock(hashBest);
+    std::vector<CTransaction> vTxs;
+    BuildSpends(view, vTxs);
+
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+    CValidationState validationState;
+    if (fWarmMempool) {
+        for (const CTransaction& tx : vTxs) {
+            PrecomputedTransactionData txdata(tx);
+            CheckInputs(tx, validationState, view, true, flags, true, true, txdata);
+        }
+    }
+
+    while (state.KeepRunning()) {
+        for (const CTransaction& tx : vTxs) {
+            // ConnectBlock consumes the cache entries it hits, keep them for the next run
+            PrecomputedTransactionData txdata(tx);
+            bool fValid = CheckInputs(tx, validationState, view, true, flags, false, fWarmMempool, txdata);
+            assert(fValid);
+        }
+    }
+
+    LOCK(cs_main);
+    mapBlockIndex.erase(hashBest);
+}
+
+static void CheckInputsScripts_Cold(benchmark::State& state) { CheckInputsScripts(state, false); }
+static void CheckInputsScripts_WarmMempool(benchmark::State& state) { CheckInputsScripts(state, true); }
+
+BENCHMARK(CheckInputsScripts_Cold);
+BENCHMARK(CheckInputsScripts_WarmMempool);
@@ -0,0 +1,41 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "coins.h"
+#include "script/standard.h"
+
+#include <iostream>
+
+// The coins cache work of connecting blocks: add new coins, look up and spend
+// earlier ones, and flush the result into the parent cache. Also reports the
+// memory the cache takes per coin, pool chunks and bucket array included.
+static const int CACHE_COINS = 100000;
+
+static void CoinsCacheAddSpendFlush(benchmark::State& state)
+{
+    CCoinsView base;
+    CCoinsViewCache parent(&base);
+
+    CTxOut out(50 * COIN, CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG);
+    size_t nUsagePerCoin = 0;
+    uint32_t nRound = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&parent);
+        const uint256 hash = ArithToUint256(arith_uint256(++nRound));
+        for (int i = 0; i < CACHE_COINS; i++)
+            cache.AddCoin(COutPoint(hash, i), Coin(out, nRound, false, false), false);
+        if (nUsagePerCoin == 0)
+            nUsagePerCoin = cache.DynamicMemoryUsage() / CACHE_COINS;
+        for (int i = 0; i < CACHE_COINS; i += 2)
+            cache.SpendCoin(COutPoint(hash, i));
+        cache.Flush();
+        // drop the survivors again, the base view takes nothing
+        parent.Flush();
+    }
+    std::cout << "#CoinsCacheAddSpendFlush memory per coin: " << nUsagePerCoin << " bytes" << std::endl;
+}
+
+BENCHMARK(CoinsCacheAddSpendFlush);
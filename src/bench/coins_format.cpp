@@ -0,0 +1,109 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "key.h"
+#include "script/standard.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <iostream>
+
+// The chainstate coin format on a UTXO set shaped like a staking chain's: each coinstake
+// leaves its empty marker output, two P2PK stake outputs and a P2PKH masternode reward.
+// Prints the serialized size per coin in the compact format and in the Coin format it
+// replaced, then times decoding both, and a Cursor() scan over an in-memory coins database.
+static const int FORMAT_COINSTAKES = 25000;
+
+static std::vector<Coin> MakeStakingCoins()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptStake = GetScriptForRawPubKey(key.GetPubKey());
+    const CScript scriptReward = GetScriptForDestination(key.GetPubKey().GetID());
+
+    std::vector<Coin> vCoins;
+    for (int i = 0; i < FORMAT_COINSTAKES; i++) {
+        const uint32_t nHeight = 1500000 + i;
+        vCoins.emplace_back(CTxOut(0, CScript()), nHeight, false, true);
+        vCoins.emplace_back(CTxOut(1000 * COIN + i * 7919, scriptStake), nHeight, false, true);
+        vCoins.emplace_back(CTxOut(1000 * COIN + i * 7907, scriptStake), nHeight, false, true);
+        vCoins.emplace_back(CTxOut(3 * COIN + i, scriptReward), nHeight, false, true);
+    }
+    return vCoins;
+}
+
+static void CoinsFormatDecodeLegacy(benchmark::State& state)
+{
+    const std::vector<Coin> vCoins = MakeStakingCoins();
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    for (const Coin& coin : vCoins)
+        ss << coin;
+    std::cout << "#CoinsFormat Coin format: " << (double)ss.size() / vCoins.size() << " bytes per coin" << std::endl;
+
+    Coin coin;
+    while (state.KeepRunning()) {
+        CDataStream ssRead(ss);
+        while (!ssRead.empty())
+            ssRead >> coin;
+    }
+}
+
+static void CoinsFormatDecodeCompact(benchmark::State& state)
+{
+    std::vector<Coin> vCoins = MakeStakingCoins();
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    for (Coin& coin : vCoins)
+        ss << CCoinCompressor(coin);
+    std::cout << "#CoinsFormat compact format: " << (double)ss.size() / vCoins.size() << " bytes per coin" << std::endl;
+
+    Coin coin;
+    CCoinCompressor compact(coin);
+    while (state.KeepRunning()) {
+        CDataStream ssRead(ss);
+        while (!ssRead.empty())
+            ssRead >> compact;
+    }
+}
+
+static void CoinsDBCursorScan(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    const fs::path pathTemp = GetTempPath() / strprintf("bench_coins_format_%lu", (unsigned long)GetTime());
+    fs::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    ClearDatadirCache();
+    {
+        CCoinsViewDB db(1 << 23, true);
+        {
+            CCoinsViewCache cache(&db);
+            const std::vector<Coin> vCoins = MakeStakingCoins();
+            for (size_t i = 0; i < vCoins.size(); i++)
+                cache.AddCoin(COutPoint(ArithToUint256(arith_uint256(i / 4 + 1)), i % 4), Coin(vCoins[i]), false);
+            cache.SetBestBlock(ArithToUint256(arith_uint256(1)));
+            cache.Flush();
+        }
+
+        COutPoint key;
+        Coin coin;
+        while (state.KeepRunning()) {
+            std::unique_ptr<CCoinsViewCursor> pcursor(db.Cursor());
+            for (; pcursor->Valid(); pcursor->Next()) {
+                pcursor->GetKey(key);
+                pcursor->GetValue(coin);
+            }
+        }
+    }
+    fs::remove_all(pathTemp);
+    mapArgs.erase("-datadir");
+    ClearDatadirCache();
+}
+
+BENCHMARK(CoinsFormatDecodeLegacy);
+BENCHMARK(CoinsFormatDecodeCompact);
+BENCHMARK(CoinsDBCursorScan);
@@ -41,6 +41,33 @@ static void SHA256(benchmark::State& state)
         CSHA256().Write(begin_ptr(in), in.size()).Finalize(hash);
 }
 
+static void SHA256_32b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(32,0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000000; i++) {
+            CSHA256().Write(begin_ptr(in), in.size()).Finalize(&in[0]);
+        }
+    }
+}
+
+/* 1024 double-SHA256's of 64-byte blobs, the work of one merkle tree level, with the given backend */
+static void SHA256D64_1024(benchmark::State& state, const std::string& strImpl)
+{
+    std::cout << "#SHA256D64_1024 " << strImpl << ": " << SHA256AutoDetect(strImpl) << std::endl;
+    std::vector<uint8_t> in(64 * 1024);
+    std::vector<uint8_t> out(32 * 1024);
+    while (state.KeepRunning())
+        SHA256D64(out.data(), in.data(), 1024);
+    SHA256AutoDetect();
+}
+
+static void SHA256D64_1024_Standard(benchmark::State& state) { SHA256D64_1024(state, "standard"); }
+static void SHA256D64_1024_SSE41(benchmark::State& state) { SHA256D64_1024(state, "sse41"); }
+static void SHA256D64_1024_AVX2(benchmark::State& state) { SHA256D64_1024(state, "avx2"); }
+static void SHA256D64_1024_SHANI(benchmark::State& state) { SHA256D64_1024(state, "shani"); }
+static void SHA256D64_1024_Auto(benchmark::State& state) { SHA256D64_1024(state, "auto"); }
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -74,6 +101,12 @@ static void FastRandom_1bit(benchmark::State& state)
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
 BENCHMARK(SHA256);
+BENCHMARK(SHA256_32b);
+BENCHMARK(SHA256D64_1024_Standard);
+BENCHMARK(SHA256D64_1024_SSE41);
+BENCHMARK(SHA256D64_1024_AVX2);
+BENCHMARK(SHA256D64_1024_SHANI);
+BENCHMARK(SHA256D64_1024_Auto);
 BENCHMARK(SHA512);
 
 BENCHMARK(FastRandom_32bit);
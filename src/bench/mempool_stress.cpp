@@ -0,0 +1,71 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "policy/policy.h"
+#include "txmempool.h"
+
+#include <fstream>
+#include <iostream>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+// A spam wave: 100000 two-input, two-output transactions admitted to the memory pool,
+// every fifth spending the one before it. Prints the resident memory the pool added to the
+// process next to what DynamicMemoryUsage() reports for it, which -maxmempool is held to.
+static const int STRESS_TXS = 100000;
+
+/** Resident set size of the process, 0 where /proc is not available */
+static size_t GetResidentBytes()
+{
+#ifndef WIN32
+    std::ifstream statm("/proc/self/statm");
+    size_t nPages = 0, nResident = 0;
+    if (statm >> nPages >> nResident)
+        return nResident * sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+static void MempoolStress(benchmark::State& state)
+{
+    std::vector<CMutableTransaction> vTxs(STRESS_TXS);
+    for (int i = 0; i < STRESS_TXS; i++) {
+        CMutableTransaction& tx = vTxs[i];
+        tx.vin.resize(2);
+        tx.vin[0].prevout = COutPoint(i % 5 ? vTxs[i - 1].GetHash() : ArithToUint256(arith_uint256(i + 1)), 0);
+        tx.vin[1].prevout = COutPoint(ArithToUint256(arith_uint256(STRESS_TXS + i + 1)), 1);
+        for (CTxIn& txin : tx.vin)
+            txin.scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+        tx.vout.resize(2);
+        for (CTxOut& txout : tx.vout) {
+            txout.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i & 0xff) << OP_EQUALVERIFY << OP_CHECKSIG;
+            txout.nValue = COIN + i;
+        }
+    }
+    std::vector<CTransaction> vFinal(vTxs.begin(), vTxs.end());
+    vTxs.clear();
+    vTxs.shrink_to_fit();
+
+    // resident memory can also shrink over a run, when the allocator reuses pages freed before
+    int64_t nResidentAdded = 0;
+    size_t nUsage = 0;
+    while (state.KeepRunning()) {
+        const size_t nResidentBefore = GetResidentBytes();
+        {
+            CTxMemPool pool(CFeeRate(0));
+            LOCK(pool.cs);
+            for (const CTransaction& tx : vFinal)
+                pool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 10000, 0, 0.0, 1, false, 0, false, 2));
+            nUsage = pool.DynamicMemoryUsage();
+            nResidentAdded = (int64_t)GetResidentBytes() - (int64_t)nResidentBefore;
+        }
+    }
+    std::cout << "#MempoolStress " << STRESS_TXS << " txs: reported usage " << nUsage / 1024 << " KiB, resident memory added " << nResidentAdded / 1024 << " KiB" << std::endl;
+}
+
+BENCHMARK(MempoolStress);
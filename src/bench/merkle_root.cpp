@@ -0,0 +1,51 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "consensus/merkle.h"
+#include "merkleblock.h"
+#include "random.h"
+
+// Merkle work on blocks of 1000 to 10000 transactions: the root CheckBlock and
+// CreateNewBlock compute, and the partial tree of a merkleblock reply matching
+// one transaction in a hundred.
+static std::vector<uint256> MakeLeaves(size_t nLeaves)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves(nLeaves);
+    for (uint256& leaf : leaves)
+        leaf = rng.rand256();
+    return leaves;
+}
+
+static void MerkleRoot(benchmark::State& state, size_t nLeaves)
+{
+    const std::vector<uint256> leaves = MakeLeaves(nLeaves);
+    while (state.KeepRunning()) {
+        bool mutated = false;
+        ComputeMerkleRoot(leaves, &mutated);
+    }
+}
+
+static void MerkleBlockTree(benchmark::State& state, size_t nLeaves)
+{
+    const std::vector<uint256> leaves = MakeLeaves(nLeaves);
+    std::vector<bool> vMatch(nLeaves);
+    for (size_t i = 0; i < nLeaves; i += 100)
+        vMatch[i] = true;
+    while (state.KeepRunning())
+        CPartialMerkleTree(leaves, vMatch);
+}
+
+static void MerkleRoot_1000(benchmark::State& state) { MerkleRoot(state, 1000); }
+static void MerkleRoot_4000(benchmark::State& state) { MerkleRoot(state, 4000); }
+static void MerkleRoot_10000(benchmark::State& state) { MerkleRoot(state, 10000); }
+static void MerkleBlockTree_1000(benchmark::State& state) { MerkleBlockTree(state, 1000); }
+static void MerkleBlockTree_10000(benchmark::State& state) { MerkleBlockTree(state, 10000); }
+
+BENCHMARK(MerkleRoot_1000);
+BENCHMARK(MerkleRoot_4000);
+BENCHMARK(MerkleRoot_10000);
+BENCHMARK(MerkleBlockTree_1000);
+BENCHMARK(MerkleBlockTree_10000);
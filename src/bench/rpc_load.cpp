@@ -0,0 +1,104 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chainsnapshot.h"
+#include "main.h"
+#include "rpc/server.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+#include <boost/thread/thread.hpp>
+
+// 64 RPC clients asking for block hashes and headers of a 10000 block chain while another
+// thread keeps taking cs_main for 5 ms at a time, as block connection does. Once with the
+// calls reading the chain snapshot, once with every call holding cs_main as they did before.
+// Prints the median and 99th percentile latency of a single call.
+static const int LOAD_BLOCKS = 10000;
+static const int LOAD_CLIENTS = 64;
+static const int LOAD_CALLS = 16;
+
+static void RpcLoad(benchmark::State& state, bool fSerialized)
+{
+    std::vector<uint256> vHashes(LOAD_BLOCKS);
+    std::vector<CBlockIndex> vIndex(LOAD_BLOCKS);
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < LOAD_BLOCKS; i++) {
+            vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+            CBlockIndex& index = vIndex[i];
+            index.phashBlock = &vHashes[i];
+            index.pprev = i ? &vIndex[i - 1] : nullptr;
+            index.nHeight = i;
+            index.nTime = 1600000000 + i * 60;
+            index.nBits = 0x1e0ffff0;
+            mapBlockIndex.emplace(vHashes[i], &index);
+        }
+        chainActive.SetTip(&vIndex.back());
+        PublishChainSnapshot(chainActive);
+    }
+
+    std::vector<int64_t> vLatencies;
+    while (state.KeepRunning()) {
+        std::atomic<bool> fDone{false};
+        boost::thread connector([&fDone] {
+            while (!fDone) {
+                LOCK(cs_main);
+                MilliSleep(5);
+            }
+        });
+
+        std::vector<std::vector<int64_t> > vClientLatencies(LOAD_CLIENTS);
+        boost::thread_group clients;
+        for (int c = 0; c < LOAD_CLIENTS; c++) {
+            clients.create_thread([&, c] {
+                for (int n = 0; n < LOAD_CALLS; n++) {
+                    const int nHeight = (c * LOAD_CALLS + n) * 7919 % LOAD_BLOCKS;
+                    JSONRPCRequest request;
+                    request.params = UniValue(UniValue::VARR);
+                    const int64_t nStart = GetTimeMicros();
+                    {
+                        LOCK(fSerialized ? &cs_main : nullptr);
+                        if (n % 2) {
+                            request.params.push_back(nHeight);
+                            getblockhash(request);
+                        } else {
+                            request.params.push_back(vHashes[nHeight].GetHex());
+                            getblockheader(request);
+                        }
+                    }
+                    vClientLatencies[c].push_back(GetTimeMicros() - nStart);
+                }
+            });
+        }
+        clients.join_all();
+        fDone = true;
+        connector.join();
+
+        for (const std::vector<int64_t>& v : vClientLatencies)
+            vLatencies.insert(vLatencies.end(), v.begin(), v.end());
+    }
+
+    std::sort(vLatencies.begin(), vLatencies.end());
+    const int64_t nP50 = vLatencies[vLatencies.size() / 2];
+    const int64_t nP99 = vLatencies[vLatencies.size() * 99 / 100];
+    std::cout << "#RpcLoad " << (fSerialized ? "cs_main" : "snapshot") << " " << LOAD_CLIENTS << " clients: p50 "
+              << nP50 << " us, p99 " << nP99 << " us" << std::endl;
+
+    LOCK(cs_main);
+    chainActive.SetTip(nullptr);
+    PublishChainSnapshot(chainActive);
+    for (const uint256& hash : vHashes)
+        mapBlockIndex.erase(hash);
+}
+
+static void RpcLoad_Snapshot(benchmark::State& state) { RpcLoad(state, false); }
+static void RpcLoad_Serialized(benchmark::State& state) { RpcLoad(state, true); }
+
+BENCHMARK(RpcLoad_Snapshot);
+BENCHMARK(RpcLoad_Serialized);
@@ -0,0 +1,103 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "checkqueue.h"
+#include "key.h"
+#include "random.h"
+#include "util.h"
+
+#include <boost/thread/thread.hpp>
+
+// Signatures per second of CPubKey::Verify, one after the other as the masternode, spork and
+// block signature callers do, against the same checks handed to a check queue served by one
+// thread per core. A burst of 1000 stands for the script checks of a block, a burst of 2 for
+// a masternode broadcast, the largest burst outside of blocks. Signatures per second are the
+// burst size over the time of an iteration.
+static const int SIG_BURST_BLOCK = 1000;
+static const int SIG_BURST_MESSAGE = 2;
+static const int SIG_QUEUE_BATCH_SIZE = 128;
+
+struct SigCheck {
+    const CPubKey* pubkey;
+    const uint256* hash;
+    const std::vector<unsigned char>* sig;
+
+    SigCheck() : pubkey(nullptr), hash(nullptr), sig(nullptr) {}
+    SigCheck(const CPubKey& pubkeyIn, const uint256& hashIn, const std::vector<unsigned char>& sigIn) : pubkey(&pubkeyIn), hash(&hashIn), sig(&sigIn) {}
+
+    bool operator()()
+    {
+        return pubkey->Verify(*hash, *sig);
+    }
+
+    void swap(SigCheck& check)
+    {
+        std::swap(pubkey, check.pubkey);
+        std::swap(hash, check.hash);
+        std::swap(sig, check.sig);
+    }
+};
+
+struct SigBurst {
+    std::vector<CPubKey> vPubKeys;
+    std::vector<uint256> vHashes;
+    std::vector<std::vector<unsigned char> > vSigs;
+
+    explicit SigBurst(int nSigs)
+    {
+        for (int i = 0; i < nSigs; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            vHashes.push_back(GetRandHash());
+            vSigs.emplace_back();
+            key.Sign(vHashes.back(), vSigs.back());
+            vPubKeys.push_back(key.GetPubKey());
+        }
+    }
+};
+
+static void SigVerifySequential(benchmark::State& state, int nSigs)
+{
+    const SigBurst burst(nSigs);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < nSigs; i++) {
+            bool fValid = burst.vPubKeys[i].Verify(burst.vHashes[i], burst.vSigs[i]);
+            assert(fValid);
+        }
+    }
+}
+
+static void SigVerifyQueue(benchmark::State& state, int nSigs)
+{
+    const SigBurst burst(nSigs);
+    CCheckQueue<SigCheck> queue(SIG_QUEUE_BATCH_SIZE);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < std::max(1, GetNumCores() - 1); i++)
+        threadGroup.create_thread([&] { queue.Thread(); });
+
+    while (state.KeepRunning()) {
+        CCheckQueueControl<SigCheck> control(&queue);
+        std::vector<SigCheck> vChecks;
+        vChecks.reserve(nSigs);
+        for (int i = 0; i < nSigs; i++)
+            vChecks.emplace_back(burst.vPubKeys[i], burst.vHashes[i], burst.vSigs[i]);
+        control.Add(vChecks);
+        bool fValid = control.Wait();
+        assert(fValid);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+static void SigBatch_BlockSequential(benchmark::State& state) { SigVerifySequential(state, SIG_BURST_BLOCK); }
+static void SigBatch_BlockQueue(benchmark::State& state) { SigVerifyQueue(state, SIG_BURST_BLOCK); }
+static void SigBatch_MessageSequential(benchmark::State& state) { SigVerifySequential(state, SIG_BURST_MESSAGE); }
+static void SigBatch_MessageQueue(benchmark::State& state) { SigVerifyQueue(state, SIG_BURST_MESSAGE); }
+
+BENCHMARK(SigBatch_BlockSequential);
+BENCHMARK(SigBatch_BlockQueue);
+BENCHMARK(SigBatch_MessageSequential);
+BENCHMARK(SigBatch_MessageQueue);
@@ -0,0 +1,86 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "compat.h"
+
+#include <vector>
+
+#ifdef USE_POLL
+#include <poll.h>
+#endif
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+// Cost of one wait on the socket events primitives with many idle peers
+// and a single readable one, which is what the net thread sees on a
+// well-connected node. Kept below the default 1024 descriptor limit.
+static const int IDLE_SOCKET_PAIRS = 400;
+
+#ifdef USE_POLL
+struct SocketPairs {
+    std::vector<int> vRead;
+    std::vector<int> vWrite;
+
+    SocketPairs()
+    {
+        for (int i = 0; i < IDLE_SOCKET_PAIRS; i++) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+                break;
+            vRead.push_back(fds[0]);
+            vWrite.push_back(fds[1]);
+        }
+        // make the last socket permanently readable
+        if (!vWrite.empty()) {
+            char c = 0;
+            if (write(vWrite.back(), &c, 1) != 1)
+                vRead.pop_back();
+        }
+    }
+
+    ~SocketPairs()
+    {
+        for (int fd : vRead) close(fd);
+        for (int fd : vWrite) close(fd);
+    }
+};
+
+static void SocketEventsPoll(benchmark::State& state)
+{
+    SocketPairs pairs;
+    std::vector<struct pollfd> vPollfds(pairs.vRead.size());
+    while (state.KeepRunning()) {
+        // the set is rebuilt every round, as CConnman does in poll mode
+        for (size_t i = 0; i < pairs.vRead.size(); i++) {
+            vPollfds[i].fd = pairs.vRead[i];
+            vPollfds[i].events = POLLIN | POLLOUT;
+            vPollfds[i].revents = 0;
+        }
+        poll(vPollfds.data(), vPollfds.size(), 0);
+    }
+}
+BENCHMARK(SocketEventsPoll);
+#endif
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketPairs pairs;
+    int epollfd = epoll_create1(EPOLL_CLOEXEC);
+    for (int fd : pairs.vRead) {
+        epoll_event event;
+        event.data.fd = fd;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event);
+    }
+    epoll_event events[64];
+    while (state.KeepRunning()) {
+        epoll_wait(epollfd, events, 64, 0);
+    }
+    close(epollfd);
+}
+BENCHMARK(SocketEventsEpoll);
+#endif
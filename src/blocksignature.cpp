@@ -70,6 +70,10 @@ bool CheckBlockSignature(const CBlock& block, const bool enableP2PKH)
         }
     }
 
+    // The signature itself was already verified off the main thread (see LoadExternalBlockFile)
+    if (block.fCheckedSignature)
+        return true;
+
     if (whichType == TX_PUBKEY) {
         valtype& vchPubKey = vSolutions[0];
         pubkey = CPubKey(vchPubKey);
@@ -10,12 +10,23 @@
 
 #include "amount.h"
 #include "chainparams.h"
+#include "crypto/sha256.h"
 #include "curl.h"
 #include "guiinterface.h"
+#include "init.h"
+#include "main.h"
+#include "sync.h"
 #include "util.h"
+#include "utilstrencodings.h"
 #include "zip.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
 
 namespace fs = boost::filesystem;
 
@@ -52,12 +63,21 @@ int progressCallback(
     return 0;
 }
 
-bool CBootstrap::DownloadAndApply()
+std::string CBootstrap::GetBaseURL()
 {
-    const auto url =
+    auto url = GetArg(
+        "-bootstrapurl",
         std::string(BOOTSTRAP_URL) +
-        (Params().IsTestNet() ? "T" : "") + std::string(CURRENCY_UNIT) +
-        "/bootstrap.zip";
+        (Params().IsTestNet() ? "T" : "") + std::string(CURRENCY_UNIT));
+    if (url.empty() || url.back() != '/') {
+        url += "/";
+    }
+    return url;
+}
+
+bool CBootstrap::DownloadAndApply()
+{
+    const auto url = GetBaseURL() + "bootstrap.zip";
     const auto datadir = GetDataDir();
     const auto fileName = datadir / extractFilenameFromURL(url);
     const auto blocks = datadir / "blocks";
@@ -119,3 +139,299 @@ bool CBootstrap::DownloadAndApply()
 
     return true;
 }
+
+/** One piece of the streamed bootstrap, a run of whole blocks as in bootstrap.dat */
+struct CBootstrapChunk {
+    std::string name;
+    uint64_t size;
+    std::string sha256; //!< lower case hex of the SHA-256 of the chunk
+};
+
+static const std::string LOCAL_URL_PREFIX = "file://";
+static const int CHUNK_FETCH_ATTEMPTS = 3;
+
+/** Fetches url into path, reading file:// URLs straight from the disk */
+static bool FetchFile(const std::string& url, const fs::path& path, bool resume)
+{
+    if (url.compare(0, LOCAL_URL_PREFIX.size(), LOCAL_URL_PREFIX) != 0) {
+        return CCurlWrapper::DownloadFile(url, path.string(), nullptr, resume);
+    }
+
+    std::ifstream input(url.substr(LOCAL_URL_PREFIX.size()), std::ios::binary);
+    if (!input.is_open()) {
+        LogPrintf("CBootstrap::%s: Error opening %s\n", __func__, url);
+        return false;
+    }
+    const uint64_t offset = resume && fs::exists(path) ? fs::file_size(path) : 0;
+    std::ofstream output(path.string(), std::ios::binary | (offset > 0 ? std::ios::app : std::ios::trunc));
+    input.seekg(offset);
+    std::vector<char> buffer(1 << 20);
+    while (input && output) {
+        if (ShutdownRequested()) {
+            return false;
+        }
+        input.read(buffer.data(), buffer.size());
+        output.write(buffer.data(), input.gcount());
+    }
+    return input.eof() && output.good();
+}
+
+static bool FileSHA256(const fs::path& path, std::string& hex)
+{
+    std::ifstream input(path.string(), std::ios::binary);
+    if (!input.is_open()) {
+        return false;
+    }
+    CSHA256 hasher;
+    std::vector<char> buffer(1 << 20);
+    while (input) {
+        input.read(buffer.data(), buffer.size());
+        hasher.Write((const unsigned char*)buffer.data(), input.gcount());
+    }
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    hasher.Finalize(hash);
+    hex = HexStr(hash, hash + sizeof(hash));
+    return input.eof();
+}
+
+/** Reads lines of "<sha256 hex> <size> <file name>"; empty lines and lines starting with # are skipped */
+static bool ParseManifest(const fs::path& path, std::vector<CBootstrapChunk>& chunks)
+{
+    std::ifstream input(path.string());
+    if (!input.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        CBootstrapChunk chunk;
+        if (!(fields >> chunk.sha256 >> chunk.size >> chunk.name) ||
+            chunk.sha256.size() != 2 * CSHA256::OUTPUT_SIZE || !IsHex(chunk.sha256) ||
+            chunk.name.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789._-") != std::string::npos ||
+            chunk.name[0] == '.') {
+            LogPrintf("CBootstrap::%s: Invalid manifest line: %s\n", __func__, line);
+            return false;
+        }
+        std::transform(chunk.sha256.begin(), chunk.sha256.end(), chunk.sha256.begin(), ::tolower);
+        chunks.push_back(chunk);
+    }
+    return !chunks.empty();
+}
+
+/** Downloads a chunk to <dir>/<name>, resuming a partial download, and checks its size and hash */
+static bool FetchChunk(const std::string& baseUrl, const fs::path& dir, const CBootstrapChunk& chunk)
+{
+    const auto partial = dir / (chunk.name + ".part");
+    const auto complete = dir / chunk.name;
+    if (fs::exists(complete)) {
+        // verified before the rename
+        return true;
+    }
+
+    for (int attempt = 0; attempt < CHUNK_FETCH_ATTEMPTS && !ShutdownRequested(); attempt++) {
+        const bool resume = fs::exists(partial) && fs::file_size(partial) < chunk.size;
+        if (!FetchFile(baseUrl + chunk.name, partial, resume)) {
+            // a server without range support fails the resume, start over next time
+            if (resume) {
+                fs::remove(partial);
+            }
+            continue;
+        }
+
+        std::string sha256;
+        if (fs::file_size(partial) != chunk.size || !FileSHA256(partial, sha256) || sha256 != chunk.sha256) {
+            LogPrintf("CBootstrap::%s: Checksum mismatch for %s, downloading it again\n", __func__, chunk.name);
+            fs::remove(partial);
+            continue;
+        }
+        fs::rename(partial, complete);
+        return true;
+    }
+    return false;
+}
+
+/** Hashes of the chunks already imported, one per line */
+static std::set<std::string> ReadImportedChunks(const fs::path& path)
+{
+    std::set<std::string> imported;
+    std::ifstream input(path.string());
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty()) {
+            imported.insert(line);
+        }
+    }
+    return imported;
+}
+
+/** Downloads the chunks, at most one ahead of the import, on its own thread */
+class CBootstrapDownloader
+{
+private:
+    const std::string baseUrl;
+    const fs::path dir;
+    const std::vector<const CBootstrapChunk*> chunks;
+
+    Mutex cs;
+    std::condition_variable cv;
+    size_t nReady GUARDED_BY(cs){0};    //!< chunks downloaded and verified
+    size_t nImported GUARDED_BY(cs){0}; //!< chunks imported and deleted
+    bool fFailed GUARDED_BY(cs){false};
+    bool fStop GUARDED_BY(cs){false};
+    std::thread thread;
+
+    void ThreadDownload()
+    {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            {
+                WAIT_LOCK(cs, lock);
+                while (!fStop && i > nImported + 1) {
+                    cv.wait(lock);
+                }
+                if (fStop) {
+                    return;
+                }
+            }
+            const bool fetched = FetchChunk(baseUrl, dir, *chunks[i]);
+            {
+                LOCK(cs);
+                if (fetched) {
+                    nReady = i + 1;
+                } else {
+                    fFailed = true;
+                }
+            }
+            cv.notify_all();
+            if (!fetched) {
+                LogPrintf("CBootstrap::%s: Failed to download %s\n", __func__, chunks[i]->name);
+                return;
+            }
+        }
+    }
+
+public:
+    CBootstrapDownloader(const std::string& baseUrlIn, const fs::path& dirIn, const std::vector<const CBootstrapChunk*>& chunksIn)
+        : baseUrl(baseUrlIn), dir(dirIn), chunks(chunksIn)
+    {
+        thread = std::thread(&TraceThread<std::function<void()> >, "bootstrapdl", std::function<void()>(std::bind(&CBootstrapDownloader::ThreadDownload, this)));
+    }
+
+    ~CBootstrapDownloader()
+    {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cv.notify_all();
+        thread.join();
+    }
+
+    /** Waits until chunk i can be imported; false if its download failed or shutdown was requested */
+    bool WaitForChunk(size_t i)
+    {
+        WAIT_LOCK(cs, lock);
+        while (nReady <= i && !fFailed && !ShutdownRequested()) {
+            cv.wait_for(lock, std::chrono::milliseconds(500));
+        }
+        return nReady > i;
+    }
+
+    void ChunkImported(size_t i)
+    {
+        {
+            LOCK(cs);
+            nImported = i + 1;
+        }
+        cv.notify_all();
+    }
+};
+
+bool CBootstrap::StreamImport()
+{
+    const auto baseUrl = GetBaseURL();
+    const auto dir = GetDataDir() / "bootstrap";
+    const auto manifest = dir / "bootstrap.manifest";
+    const auto importedFile = dir / "imported";
+
+    try {
+        fs::create_directories(dir);
+
+        // Step 1: Fetch the list of chunks, always fresh as it grows with the chain
+        std::vector<CBootstrapChunk> allChunks;
+        if (!FetchFile(baseUrl + "bootstrap.manifest", manifest, false) ||
+            !ParseManifest(manifest, allChunks)) {
+            LogPrintf(
+                "CBootstrap::%s: Failed to get the bootstrap manifest from %s\n",
+                __func__, baseUrl);
+            return false;
+        }
+
+        // Step 2: Skip what an earlier run already imported
+        const auto imported = ReadImportedChunks(importedFile);
+        std::vector<const CBootstrapChunk*> chunks;
+        for (const auto& chunk : allChunks) {
+            if (!imported.count(chunk.sha256)) {
+                chunks.push_back(&chunk);
+            }
+        }
+        LogPrintf(
+            "CBootstrap::%s: %u of %u chunks to import from %s\n",
+            __func__, chunks.size(), allChunks.size(), baseUrl);
+        if (chunks.empty()) {
+            return true;
+        }
+
+        // Step 3: Import each chunk while the next one downloads
+        ImportProgressBegin("bootstrap", chunks.size());
+        CBootstrapDownloader downloader(baseUrl, dir, chunks);
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (!downloader.WaitForChunk(i)) {
+                ImportProgressEnd();
+                return false;
+            }
+
+            const auto path = dir / chunks[i]->name;
+            FILE* file = fsbridge::fopen(path, "rb");
+            if (!file) {
+                LogPrintf("CBootstrap::%s: Could not open %s\n", __func__, path.string());
+                ImportProgressEnd();
+                return false;
+            }
+            LogPrintf("CBootstrap::%s: Importing %s\n", __func__, chunks[i]->name);
+            uiInterface.ShowProgress(_("Importing bootstrap: "), (int)(i * 100 / chunks.size()));
+            ImportProgressFile(i);
+            bool fFailed = false;
+            LoadExternalBlockFile(file, nullptr, &fFailed);
+            if (ShutdownRequested()) {
+                // not known to be complete, import it again next time
+                ImportProgressEnd();
+                return false;
+            }
+            if (fFailed) {
+                // keep the verified chunk and leave it unmarked, the next run imports it again
+                LogPrintf("CBootstrap::%s: Failed to import %s\n", __func__, chunks[i]->name);
+                ImportProgressEnd();
+                return false;
+            }
+
+            // Step 4: Drop the imported chunk and remember it
+            fs::remove(path);
+            std::ofstream(importedFile.string(), std::ios::app) << chunks[i]->sha256 << "\n";
+            downloader.ChunkImported(i);
+        }
+        ImportProgressEnd();
+        uiInterface.ShowProgress("", 100);
+
+    } catch (const std::exception& e) {
+        LogPrintf(
+            "CBootstrap::%s: Error importing the bootstrap: %s\n",
+            __func__, e.what());
+        ImportProgressEnd();
+        return false;
+    }
+
+    return true;
+}
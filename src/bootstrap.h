@@ -5,10 +5,27 @@
 #ifndef BOOTSTRAP_H
 #define BOOTSTRAP_H
 
+#include <string>
+
+/** Default for -bootstrapmode */
+static const char* const DEFAULT_BOOTSTRAP_MODE = "zip";
+
 class CBootstrap
 {
 public:
+    /** Base URL of the bootstrap files, -bootstrapurl or the built in one for this network */
+    static std::string GetBaseURL();
+
+    /** Replaces blocks, chainstate and sporks with the content of bootstrap.zip */
     static bool DownloadAndApply();
+
+    /**
+     * Downloads the chunked bootstrap listed in bootstrap.manifest and imports it through
+     * LoadExternalBlockFile, so every block is validated as usual. The next chunk downloads
+     * while the current one is imported; each chunk is checked against its SHA-256 before
+     * import and deleted after. Interrupted downloads and imports resume where they stopped.
+     */
+    static bool StreamImport();
 };
 
 #endif
@@ -0,0 +1,49 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainsnapshot.h"
+
+#include "sync.h"
+
+#include <algorithm>
+
+CChainSnapshot::CChainSnapshot(const CChain& chain, const CChainSnapshot& prev) : nHeight(chain.Height())
+{
+    // highest height both chains agree on, usually the previous tip
+    int nFork = std::min(prev.nHeight, nHeight);
+    while (nFork >= 0 && prev[nFork] != chain[nFork])
+        nFork--;
+
+    // the chunks entirely below the fork are shared, the others are filled from chain
+    const int nChunks = (nHeight + CHUNK_SIZE) / CHUNK_SIZE;
+    const int nShared = std::min((nFork + 1) / CHUNK_SIZE, nChunks);
+    vChunks.reserve(nChunks);
+    vChunks.assign(prev.vChunks.begin(), prev.vChunks.begin() + nShared);
+    for (int nChunk = nShared; nChunk < nChunks; nChunk++) {
+        const int nBegin = nChunk * CHUNK_SIZE;
+        const int nEnd = std::min(nHeight + 1, nBegin + CHUNK_SIZE);
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+        chunk->reserve(nEnd - nBegin);
+        for (int h = nBegin; h < nEnd; h++)
+            chunk->push_back(chain[h]);
+        vChunks.push_back(std::move(chunk));
+    }
+}
+
+static Mutex cs_chainsnapshot;
+static CChainSnapshotRef g_chainsnapshot GUARDED_BY(cs_chainsnapshot) = std::make_shared<const CChainSnapshot>();
+
+void PublishChainSnapshot(const CChain& chain)
+{
+    CChainSnapshotRef prev = GetChainSnapshot();
+    CChainSnapshotRef next = std::make_shared<const CChainSnapshot>(chain, *prev);
+    LOCK(cs_chainsnapshot);
+    g_chainsnapshot.swap(next);
+}
+
+CChainSnapshotRef GetChainSnapshot()
+{
+    LOCK(cs_chainsnapshot);
+    return g_chainsnapshot;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CHAINSNAPSHOT_H
+#define BITCOIN_CHAINSNAPSHOT_H
+
+#include "chain.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * Immutable view of the active chain at one tip, published each time the tip moves.
+ * Read-only RPC calls resolve heights, confirmations and successors against it without
+ * taking cs_main, so they keep running side by side while blocks are connected.
+ *
+ * The entries are held in chunks of CHUNK_SIZE heights which consecutive snapshots
+ * share: publishing a new tip copies the last chunk only, a reorg the chunks above the
+ * fork. The block index entries of a published chain are not modified anymore, apart
+ * from validity flags that readers don't use.
+ */
+class CChainSnapshot
+{
+public:
+    static const int CHUNK_SIZE = 4096;
+
+private:
+    typedef std::vector<CBlockIndex*> Chunk;
+    std::vector<std::shared_ptr<const Chunk> > vChunks;
+    int nHeight;
+
+public:
+    CChainSnapshot() : nHeight(-1) {}
+    /** Snapshot of chain, reusing the chunks it has in common with prev */
+    CChainSnapshot(const CChain& chain, const CChainSnapshot& prev);
+
+    /** Returns the index entry at a particular height, or nullptr if no such height exists */
+    CBlockIndex* operator[](int nHeightIn) const
+    {
+        if (nHeightIn < 0 || nHeightIn > nHeight)
+            return nullptr;
+        return (*vChunks[nHeightIn / CHUNK_SIZE])[nHeightIn % CHUNK_SIZE];
+    }
+
+    /** Returns the index entry for the tip, or nullptr for an empty chain */
+    CBlockIndex* Tip() const { return (*this)[nHeight]; }
+
+    /** Returns the height of the tip, -1 for an empty chain */
+    int Height() const { return nHeight; }
+
+    bool Contains(const CBlockIndex* pindex) const
+    {
+        return pindex && (*this)[pindex->nHeight] == pindex;
+    }
+
+    /** Find the successor of a block in this chain, or nullptr if the block is not in it or is the tip */
+    CBlockIndex* Next(const CBlockIndex* pindex) const
+    {
+        return Contains(pindex) ? (*this)[pindex->nHeight + 1] : nullptr;
+    }
+};
+
+typedef std::shared_ptr<const CChainSnapshot> CChainSnapshotRef;
+
+/** Publish the current state of chain to the readers of GetChainSnapshot. Requires cs_main. */
+void PublishChainSnapshot(const CChain& chain);
+
+/** The snapshot of the active chain published last */
+CChainSnapshotRef GetChainSnapshot();
+
+#endif // BITCOIN_CHAINSNAPSHOT_H
@@ -91,6 +91,101 @@ public:
     }
 };
 
+/**
+ * Compact serialization of a Coin, used for the coins in the chainstate database.
+ *
+ * Serialized format:
+ * - one byte: script template (bits 0-2), coinbase (bit 3), coinstake (bit 4) and the low
+ *   three bits of the height (bits 5-7)
+ * - VARINT(height >> 3)
+ * - the template data:
+ *   - templates 0-5: the 20 or 32 bytes of a CScriptCompressor special script, then
+ *     VARINT(compressed amount)
+ *   - template 6: nothing, the empty zero value output that starts every coinstake
+ *   - template 7: VARINT(script size), the script and VARINT(compressed amount)
+ *
+ * Compared to the Coin format the script type shares a byte with the flags and part of the
+ * height, which saves a byte on most coins and two on the coinstake markers.
+ */
+class CCoinCompressor
+{
+private:
+    Coin& coin;
+
+    static const unsigned int TEMPLATE_COINSTAKE_MARKER = 6;
+    static const unsigned int TEMPLATE_RAW = 7;
+
+public:
+    explicit CCoinCompressor(Coin& coinIn) : coin(coinIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        assert(!coin.IsSpent());
+        CScript& script = coin.out.scriptPubKey;
+        std::vector<unsigned char> compr;
+        unsigned int nTemplate = TEMPLATE_RAW;
+        if (coin.out.nValue == 0 && script.empty()) {
+            nTemplate = TEMPLATE_COINSTAKE_MARKER;
+        } else if (CScriptCompressor(script).Compress(compr)) {
+            nTemplate = compr[0];
+        }
+        uint8_t nHeader = nTemplate | (coin.fCoinBase ? 0x08 : 0) | (coin.fCoinStake ? 0x10 : 0) | ((coin.nHeight & 0x07) << 5);
+        ::Serialize(s, nHeader);
+        uint32_t nHeightHigh = coin.nHeight >> 3;
+        ::Serialize(s, VARINT(nHeightHigh));
+        if (nTemplate == TEMPLATE_COINSTAKE_MARKER)
+            return;
+        if (nTemplate == TEMPLATE_RAW) {
+            unsigned int nSize = script.size();
+            ::Serialize(s, VARINT(nSize));
+            ::Serialize(s, CFlatData(script));
+        } else {
+            ::Serialize(s, CFlatData(compr.data() + 1, compr.data() + compr.size()));
+        }
+        uint64_t nVal = CTxOutCompressor::CompressAmount(coin.out.nValue);
+        ::Serialize(s, VARINT(nVal));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        uint8_t nHeader = 0;
+        ::Unserialize(s, nHeader);
+        uint32_t nHeightHigh = 0;
+        ::Unserialize(s, VARINT(nHeightHigh));
+        const unsigned int nTemplate = nHeader & 0x07;
+        coin.fCoinBase = nHeader & 0x08;
+        coin.fCoinStake = nHeader & 0x10;
+        coin.nHeight = (nHeightHigh << 3) | (nHeader >> 5);
+
+        CScript& script = coin.out.scriptPubKey;
+        script.clear();
+        if (nTemplate == TEMPLATE_COINSTAKE_MARKER) {
+            coin.out.nValue = 0;
+            return;
+        }
+        if (nTemplate == TEMPLATE_RAW) {
+            unsigned int nSize = 0;
+            ::Unserialize(s, VARINT(nSize));
+            if (nSize > MAX_SCRIPT_SIZE) {
+                // Overly long script, replace with a short invalid one
+                script << OP_RETURN;
+                s.ignore(nSize);
+            } else {
+                script.resize(nSize);
+                ::Unserialize(s, REF(CFlatData(script)));
+            }
+        } else {
+            CScriptCompressor cscript(script);
+            std::vector<unsigned char> vch(cscript.GetSpecialSize(nTemplate), 0x00);
+            ::Unserialize(s, REF(CFlatData(vch)));
+            cscript.Decompress(nTemplate, vch);
+        }
+        uint64_t nVal = 0;
+        ::Unserialize(s, VARINT(nVal));
+        coin.out.nValue = CTxOutCompressor::DecompressAmount(nVal);
+    }
+};
+
 class SaltedOutpointHasher
 {
 private:
@@ -123,7 +218,15 @@ struct CCoinsCacheEntry {
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef boost::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The cache map takes its nodes from a PoolResource: one malloc per cached coin would
+ * cost both time on the hot AddCoin/FetchCoin paths and a malloc header per entry.
+ * Blocks are sized for a boost::unordered_map node (the value plus link and hash).
+ */
+static const size_t COINS_MAP_POOL_BLOCK_SIZE = sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4;
+typedef PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>, COINS_MAP_POOL_BLOCK_SIZE, alignof(void*)> CCoinsMapAllocator;
+typedef CCoinsMapAllocator::ResourceType CCoinsMapMemoryResource;
+typedef boost::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -164,6 +267,10 @@ public:
     //! The passed mapCoins can be modified.
     virtual bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock);
 
+    //! Like BatchWrite, but the view may finish writing in the background. Reads
+    //! through this view already see the changes when it returns.
+    virtual bool BatchWriteAsync(CCoinsMap& mapCoins, const uint256& hashBlock) { return BatchWrite(mapCoins, hashBlock); }
+
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor* Cursor() const;
 
@@ -172,6 +279,9 @@ public:
 
     //! Estimate database size (0 if not implemented)
     virtual size_t EstimateSize() const { return 0; }
+
+    //! Memory held by background writes not committed yet (see BatchWriteAsync)
+    virtual size_t PendingWriteUsage() const { return 0; }
 };
 
 
@@ -188,8 +298,10 @@ public:
     uint256 GetBestBlock() const override;
     void SetBackend(CCoinsView& viewIn);
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
+    bool BatchWriteAsync(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     CCoinsViewCursor* Cursor() const override;
     size_t EstimateSize() const override;
+    size_t PendingWriteUsage() const override;
 };
 
 
@@ -206,6 +318,8 @@ protected:
      * declared as "const".  
      */
     mutable uint256 hashBlock;
+    //! backs the nodes of cacheCoins, so it must be declared (and constructed) first
+    CCoinsMapMemoryResource cacheCoinsMemoryResource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -252,8 +366,9 @@ public:
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
      * If false is returned, the state of this cache (and its backing view) will be undefined.
+     * With fAsync the base view may complete the write in the background (see BatchWriteAsync).
      */
-    bool Flush();
+    bool Flush(bool fAsync = false);
 
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is not modified.
@@ -263,6 +378,13 @@ public:
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
+    /**
+     * Release the memory held by the cache map. Flush() and clearing the map only put the
+     * nodes back on the pool free lists; this gives the pool chunks back as well.
+     * The cache must be empty.
+     */
+    void ReallocateCache();
+
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
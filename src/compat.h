@@ -94,12 +94,21 @@ typedef u_int SOCKET;
 size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
-bool static inline IsSelectableSocket(SOCKET s)
+#ifndef WIN32
+// poll(2) is available on every POSIX target, epoll(7) only on Linux
+#define USE_POLL
+#if defined(__linux__)
+#define USE_EPOLL
+#endif
+#endif
+
+/** select() can only watch descriptors below FD_SETSIZE, poll and epoll have no such limit */
+bool static inline IsSelectableSocket(const SOCKET& s, bool fSelect = true)
 {
 #ifdef WIN32
     return true;
 #else
-    return (s < FD_SETSIZE);
+    return !fSelect || (s < FD_SETSIZE);
 #endif
 }
 
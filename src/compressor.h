@@ -40,6 +40,9 @@ private:
 
     CScript& script;
 
+    // the chainstate format shares the special scripts
+    friend class CCoinCompressor;
+
 protected:
     /**
      * These check for scripts for which a special case with a shorter encoding is defined.
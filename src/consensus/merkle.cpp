@@ -3,7 +3,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/pivx-config.h"
+#endif
+
 #include "merkle.h"
+#include "crypto/sha256.h"
 #include "hash.h"
 #include "utilstrencodings.h"
 
@@ -39,106 +44,85 @@
        root.
 */
 
-/* This implements a constant-space merkle root/path calculator, limited to 2^32 leaves. */
-static void MerkleComputation(const std::vector<uint256>& leaves, uint256* proot, bool* pmutated, uint32_t branchpos, std::vector<uint256>* pbranch) {
-    if (pbranch) pbranch->clear();
-    if (leaves.size() == 0) {
-        if (pmutated) *pmutated = false;
-        if (proot) *proot = uint256();
-        return;
-    }
-    bool mutated = false;
-    // count is the number of leaves processed so far.
-    uint32_t count = 0;
-    // inner is an array of eagerly computed subtree hashes, indexed by tree
-    // level (0 being the leaves).
-    // For example, when count is 25 (11001 in binary), inner[4] is the hash of
-    // the first 16 leaves, inner[3] of the next 8 leaves, and inner[0] equal to
-    // the last leaf. The other inner entries are undefined.
-    uint256 inner[32];
-    // Which position in inner is a hash that depends on the matching leaf.
-    int matchlevel = -1;
-    // First process all leaves into 'inner' values.
-    while (count < leaves.size()) {
-        uint256 h = leaves[count];
-        bool matchh = count == branchpos;
-        count++;
-        int level;
-        // For each of the lower bits in count that are 0, do 1 step. Each
-        // corresponds to an inner value that existed before processing the
-        // current leaf, and each needs a hash to combine it.
-        for (level = 0; !(count & (((uint32_t)1) << level)); level++) {
-            if (pbranch) {
-                if (matchh) {
-                    pbranch->push_back(inner[level]);
-                } else if (matchlevel == level) {
-                    pbranch->push_back(h);
-                    matchh = true;
-                }
-            }
-            mutated |= (inner[level] == h);
-            CHash256().Write(inner[level].begin(), 32).Write(h.begin(), 32).Finalize(h.begin());
-        }
-        // Store the resulting hash at inner position level.
-        inner[level] = h;
-        if (matchh) {
-            matchlevel = level;
-        }
-    }
-    // Do a final 'sweep' over the rightmost branch of the tree to process
-    // odd levels, and reduce everything to a single top value.
-    // Level is the level (counted from the bottom) up to which we've sweeped.
-    int level = 0;
-    // As long as bit number level in count is zero, skip it. It means there
-    // is nothing left at this level.
-    while (!(count & (((uint32_t)1) << level))) {
-        level++;
+/* Each tree level is hashed in one SHA256D64 batch, so the multi-way SHA-256 kernels get
+   four or eight pairs at a time. Levels are reduced in place in a buffer owned by the
+   calling thread, which keeps its capacity between calls. Without thread_local, every
+   call allocates its own buffer. */
+#if defined(HAVE_THREAD_LOCAL)
+static thread_local std::vector<uint256> g_merkle_scratch;
+#endif
+
+/** Pad an odd level by duplicating its last hash, then replace it by the level above. */
+static void MerkleHashLevel(std::vector<uint256>& hashes)
+{
+    if (hashes.size() & 1) {
+        hashes.push_back(hashes.back());
     }
-    uint256 h = inner[level];
-    bool matchh = matchlevel == level;
-    while (count != (((uint32_t)1) << level)) {
-        // If we reach this point, h is an inner value that is not the top.
-        // We combine it with itself (Bitcoin's special rule for odd levels in
-        // the tree) to produce a higher level one.
-        if (pbranch && matchh) {
-            pbranch->push_back(h);
-        }
-        CHash256().Write(h.begin(), 32).Write(h.begin(), 32).Finalize(h.begin());
-        // Increment count to the value it would have if two entries at this
-        // level had existed.
-        count += (((uint32_t)1) << level);
-        level++;
-        // And propagate the result upwards accordingly.
-        while (!(count & (((uint32_t)1) << level))) {
-            if (pbranch) {
-                if (matchh) {
-                    pbranch->push_back(inner[level]);
-                } else if (matchlevel == level) {
-                    pbranch->push_back(h);
-                    matchh = true;
-                }
+    SHA256D64(hashes[0].begin(), hashes[0].begin(), hashes.size() / 2);
+    hashes.resize(hashes.size() / 2);
+}
+
+/** Reduce the leaves in hashes to the root, flagging two identical siblings as a mutation. */
+static uint256 MerkleRootInPlace(std::vector<uint256>& hashes, bool* mutated)
+{
+    bool mutation = false;
+    while (hashes.size() > 1) {
+        if (mutated) {
+            for (size_t pos = 0; pos + 1 < hashes.size(); pos += 2) {
+                if (hashes[pos] == hashes[pos + 1]) mutation = true;
             }
-            CHash256().Write(inner[level].begin(), 32).Write(h.begin(), 32).Finalize(h.begin());
-            level++;
         }
+        MerkleHashLevel(hashes);
     }
-    // Return result.
-    if (pmutated) *pmutated = mutated;
-    if (proot) *proot = h;
+    if (mutated) *mutated = mutation;
+    if (hashes.size() == 0) return uint256();
+    return hashes[0];
 }
 
 uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated) {
-    uint256 hash;
-    MerkleComputation(leaves, &hash, mutated, -1, NULL);
-    return hash;
+#if defined(HAVE_THREAD_LOCAL)
+    std::vector<uint256>& hashes = g_merkle_scratch;
+#else
+    std::vector<uint256> hashes;
+#endif
+    hashes.assign(leaves.begin(), leaves.end());
+    return MerkleRootInPlace(hashes, mutated);
 }
 
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position) {
     std::vector<uint256> ret;
-    MerkleComputation(leaves, NULL, NULL, position, &ret);
+    if (position >= leaves.size()) {
+        return ret;
+    }
+#if defined(HAVE_THREAD_LOCAL)
+    std::vector<uint256>& hashes = g_merkle_scratch;
+#else
+    std::vector<uint256> hashes;
+#endif
+    hashes.assign(leaves.begin(), leaves.end());
+    while (hashes.size() > 1) {
+        // the sibling of the last hash of an odd level is that hash itself
+        ret.push_back(hashes[std::min<size_t>(position ^ 1, hashes.size() - 1)]);
+        position >>= 1;
+        MerkleHashLevel(hashes);
+    }
     return ret;
 }
 
+std::vector<std::vector<uint256>> ComputeMerkleTree(const std::vector<uint256>& leaves) {
+    std::vector<std::vector<uint256>> tree(1, leaves);
+    while (tree.back().size() > 1) {
+        const std::vector<uint256>& below = tree.back();
+        std::vector<uint256> level((below.size() + 1) / 2);
+        SHA256D64(level[0].begin(), below[0].begin(), below.size() / 2);
+        if (below.size() & 1) {
+            level.back() = Hash(below.back().begin(), below.back().end(), below.back().begin(), below.back().end());
+        }
+        tree.push_back(std::move(level));
+    }
+    return tree;
+}
+
 uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& vMerkleBranch, uint32_t nIndex) {
     uint256 hash = leaf;
     for (std::vector<uint256>::const_iterator it = vMerkleBranch.begin(); it != vMerkleBranch.end(); ++it) {
@@ -154,12 +138,17 @@ uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint2
 
 uint256 BlockMerkleRoot(const CBlock& block, bool* mutated)
 {
+    // the txids are cached on the transactions, so this is the only hashing done
+#if defined(HAVE_THREAD_LOCAL)
+    std::vector<uint256>& leaves = g_merkle_scratch;
+#else
     std::vector<uint256> leaves;
+#endif
     leaves.resize(block.vtx.size());
     for (size_t s = 0; s < block.vtx.size(); s++) {
         leaves[s] = block.vtx[s].GetHash();
     }
-    return ComputeMerkleRoot(leaves, mutated);
+    return MerkleRootInPlace(leaves, mutated);
 }
 
 std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position)
@@ -17,6 +17,12 @@ uint256 ComputeMerkleRoot(const std::vector<uint256>& leaves, bool* mutated = NU
 std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position);
 uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& branch, uint32_t position);
 
+/*
+ * Compute every level of the merkle tree over the given leaves: the leaves
+ * themselves first, the root last.
+ */
+std::vector<std::vector<uint256>> ComputeMerkleTree(const std::vector<uint256>& leaves);
+
 /*
  * Compute the Merkle root of the transactions in a block.
  * *mutated is set to true if a duplicated subtree was found.
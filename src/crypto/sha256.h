@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
 
 /** A hasher class for SHA-256. */
 class CSHA256
@@ -27,4 +28,20 @@ public:
     CSHA256& Reset();
 };
 
+/** Backend names accepted by SHA256AutoDetect(), "auto" picking the fastest supported one */
+static const char* const SHA256_IMPLEMENTATIONS[] = {"auto", "standard", "sse41", "avx2", "shani"};
+
+/** Select the SHA-256 backend to use: the one named by strImpl if this CPU supports it,
+ *  falling back to the portable code otherwise. Every selected backend is checked against
+ *  the portable code before it is used. Returns a description of what was selected.
+ */
+std::string SHA256AutoDetect(const std::string& strImpl = "auto");
+
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -66,7 +66,8 @@ std::string caPath = "";
 bool CCurlWrapper::DownloadFile(
     const std::string& url,
     const std::string& filename,
-    curl_xferinfo_callback xferinfoCallback)
+    curl_xferinfo_callback xferinfoCallback,
+    bool resume)
 {
     try {
         // Initializes libcurl
@@ -101,8 +102,12 @@ bool CCurlWrapper::DownloadFile(
             __func__,
             url);
 
-        // Creates and open the destination file
-        std::ofstream outputFile(filename, std::ios::binary);
+        // Creates and open the destination file, or appends to a partial one
+        curl_off_t resumeFrom = 0;
+        if (resume && fs::exists(filename)) {
+            resumeFrom = fs::file_size(filename);
+        }
+        std::ofstream outputFile(filename, std::ios::binary | (resumeFrom > 0 ? std::ios::app : std::ios::trunc));
         if (!outputFile.is_open()) {
             LogPrintf(
                 "CCurlWrapper::%s: Error opening output file %s\n", 
@@ -113,6 +118,17 @@ bool CCurlWrapper::DownloadFile(
         // Sets url parameter
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
+        // Fails on HTTP errors instead of saving the error page
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+        // Continues a partial download
+        if (resumeFrom > 0) {
+            LogPrintf(
+                "CCurlWrapper::%s: Resuming at byte %d\n",
+                __func__, (int64_t)resumeFrom);
+            curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, resumeFrom);
+        }
+
         // Sets HTTPS parameters
         curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
         curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NATIVE_CA);
@@ -156,14 +172,18 @@ bool CCurlWrapper::DownloadFile(
                     "CCurlWrapper::%s: Error downloading file: %s\n", 
                     __func__, curl_easy_strerror(res));
             }
-            fs::remove_all(filename);
+            if (!resume) {
+                fs::remove_all(filename);
+            }
             return false;
         }
     } catch (const std::exception& e) {
         LogPrintf(
             "CCurlWrapper::%s: Error downloading file: %s\n", 
             __func__, e.what());
-        fs::remove_all(filename);
+        if (!resume) {
+            fs::remove_all(filename);
+        }
         return false;
     }
 
@@ -11,10 +11,15 @@
 class CCurlWrapper
 {
 public:
+    /**
+     * Downloads url into filename. With resume set, an existing partial file is
+     * continued from its current size and kept if the download fails again.
+     */
     static bool DownloadFile(
         const std::string& url,
         const std::string& filename,
-        curl_xferinfo_callback xferinfoCallback = nullptr);
+        curl_xferinfo_callback xferinfoCallback = nullptr,
+        bool resume = false);
 };
 
 #endif // CURL_H
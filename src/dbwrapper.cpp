@@ -5,8 +5,14 @@
 
 #include "dbwrapper.h"
 
+#include "sync.h"
 #include "util.h"
+#include "utilstrencodings.h"
 
+#include <map>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
 #include <boost/scoped_ptr.hpp>
 
 #include <leveldb/cache.h>
@@ -16,14 +22,81 @@
 #include <stdint.h>
 
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static Mutex cs_dbwrappers;
+static std::map<std::string, CDBWrapper*> mapDBWrappers GUARDED_BY(cs_dbwrappers);
+
+static void ApplyDBPreset(const std::string& strPreset, CDBProfile& profile)
+{
+    profile = CDBProfile();
+    if (strPreset == "nvme") {
+        // fast random reads: keep every table open and fetch larger blocks per read
+        profile.nMaxOpenFiles = 1000;
+        profile.nBlockSize = 16 * 1024;
+    }
+}
+
+bool ParseDBProfile(const std::string& strValue, CDBProfile& profile, std::string& strError)
+{
+    std::vector<std::string> vTokens;
+    boost::split(vTokens, strValue, boost::is_any_of(","));
+    for (std::string strToken : vTokens) {
+        boost::trim(strToken);
+        if (strToken.empty())
+            continue;
+        const size_t nPos = strToken.find('=');
+        if (nPos == std::string::npos) {
+            if (strToken != "default" && strToken != "nvme") {
+                strError = strprintf("unknown preset '%s'", strToken);
+                return false;
+            }
+            ApplyDBPreset(strToken, profile);
+            continue;
+        }
+        const std::string strKey = strToken.substr(0, nPos);
+        const std::string strVal = strToken.substr(nPos + 1);
+        int nValue;
+        if (!ParseInt32(strVal, &nValue) || nValue < 0) {
+            strError = strprintf("invalid value '%s' for %s", strVal, strKey);
+            return false;
+        }
+        if (strKey == "maxopenfiles" && nValue >= 16 && nValue <= 50000) {
+            profile.nMaxOpenFiles = nValue;
+        } else if (strKey == "blocksize" && nValue >= 1 && nValue <= 1024) {
+            profile.nBlockSize = nValue * 1024;
+        } else if (strKey == "compression" && nValue <= 1) {
+            profile.fCompression = nValue != 0;
+        } else if (strKey == "bloombits" && nValue <= 32) {
+            profile.nBloomBits = nValue;
+        } else if (strKey == "cache" && nValue <= 100) {
+            profile.nCachePercent = nValue;
+        } else {
+            strError = strprintf("invalid setting %s", strToken);
+            return false;
+        }
+    }
+    return true;
+}
+
+CDBProfile GetDBProfile(const std::string& strName)
+{
+    CDBProfile profile;
+    std::string strError;
+    if (!strName.empty() && mapArgs.count("-dbprofile." + strName)) {
+        if (!ParseDBProfile(mapArgs["-dbprofile." + strName], profile, strError))
+            profile = CDBProfile();
+    }
+    return profile;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBProfile& profile)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.filter_policy = profile.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(profile.nBloomBits) : NULL;
+    options.compression = profile.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = profile.nMaxOpenFiles;
+    options.block_size = profile.nBlockSize;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -32,14 +105,15 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, const std::string& strNameIn) : strName(strNameIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    const CDBProfile profile = GetDBProfile(strName);
+    options = GetOptions(nCacheSize, profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -56,10 +130,22 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    if (!strName.empty()) {
+        LogPrint(BCLog::LEVELDB, "LevelDB profile %s: max_open_files=%d block_size=%u compression=%d bloom_bits=%d\n",
+            strName, profile.nMaxOpenFiles, profile.nBlockSize, profile.fCompression, profile.nBloomBits);
+        LOCK(cs_dbwrappers);
+        mapDBWrappers[strName] = this;
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    if (!strName.empty()) {
+        LOCK(cs_dbwrappers);
+        auto it = mapDBWrappers.find(strName);
+        if (it != mapDBWrappers.end() && it->second == this)
+            mapDBWrappers.erase(it);
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -74,6 +160,8 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    nWriteBatches++;
+    nWriteBytes += batch.batch.ApproximateSize();
     return true;
 }
 
@@ -84,6 +172,71 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+bool CDBWrapper::Compact()
+{
+    if (fCompacting.exchange(true))
+        return false;
+    const int64_t nStart = GetTimeMillis();
+    nCompactionStart = nStart;
+    LogPrintf("Compacting LevelDB %s\n", strName);
+    pdb->CompactRange(NULL, NULL);
+    const int64_t nEnd = GetTimeMillis();
+    nLastCompactionEnd = nEnd;
+    nLastCompactionDuration = nEnd - nStart;
+    fCompacting = false;
+    LogPrintf("Compacted LevelDB %s in %dms\n", strName, nEnd - nStart);
+    return true;
+}
+
+CDBStats CDBWrapper::GetStats() const
+{
+    CDBStats stats;
+    stats.nReads = nReads;
+    stats.nReadBytes = nReadBytes;
+    stats.nWriteBatches = nWriteBatches;
+    stats.nWriteBytes = nWriteBytes;
+    stats.fCompacting = fCompacting;
+    stats.nCompactionStart = nCompactionStart;
+    stats.nLastCompactionEnd = nLastCompactionEnd;
+    stats.nLastCompactionDuration = nLastCompactionDuration;
+
+    // the property is a table, one row per non-empty level after a dashed header line:
+    // Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    std::string strStats;
+    if (!pdb->GetProperty("leveldb.stats", &strStats))
+        return stats;
+    std::istringstream ss(strStats);
+    std::string strLine;
+    bool fRows = false;
+    while (std::getline(ss, strLine)) {
+        if (!fRows) {
+            fRows = strLine.compare(0, 4, "----") == 0;
+            continue;
+        }
+        CDBLevelStats level;
+        if (sscanf(strLine.c_str(), "%d %d %lf %lf %lf %lf", &level.nLevel, &level.nFiles, &level.dSizeMB,
+                &level.dTimeSec, &level.dReadMB, &level.dWriteMB) == 6)
+            stats.vLevels.push_back(level);
+    }
+    return stats;
+}
+
+CDBWrapper* FindDBWrapper(const std::string& strName)
+{
+    LOCK(cs_dbwrappers);
+    auto it = mapDBWrappers.find(strName);
+    return it == mapDBWrappers.end() ? NULL : it->second;
+}
+
+std::vector<std::string> ListDBWrappers()
+{
+    LOCK(cs_dbwrappers);
+    std::vector<std::string> vNames;
+    for (const auto& entry : mapDBWrappers)
+        vNames.push_back(entry.first);
+    return vNames;
+}
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
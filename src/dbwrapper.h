@@ -14,6 +14,9 @@
 #include "version.h"
 
 
+#include <atomic>
+#include <vector>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
@@ -30,6 +33,48 @@ public:
 
 class CDBWrapper;
 
+/**
+ * LevelDB settings of one database, configured with -dbprofile.<name>=[preset,]key=value,...
+ * Known databases are "blockindex", "chainstate" and "sporks".
+ */
+struct CDBProfile {
+    int nMaxOpenFiles{64};
+    size_t nBlockSize{4096};
+    bool fCompression{false};
+    int nBloomBits{10};
+    //! share of -dbcache in percent, -1 to keep the default split
+    int nCachePercent{-1};
+};
+
+/** Parse a -dbprofile value on top of the given profile. Returns false and sets strError on bad input. */
+bool ParseDBProfile(const std::string& strValue, CDBProfile& profile, std::string& strError);
+
+/** The profile configured for a database, or the defaults when there is none or it does not parse. */
+CDBProfile GetDBProfile(const std::string& strName);
+
+/** Compaction statistics of one LevelDB level, as reported by the "leveldb.stats" property */
+struct CDBLevelStats {
+    int nLevel{0};
+    int nFiles{0};
+    double dSizeMB{0};
+    double dTimeSec{0};
+    double dReadMB{0};
+    double dWriteMB{0};
+};
+
+/** Activity counters of a CDBWrapper since it was opened */
+struct CDBStats {
+    uint64_t nReads{0};
+    uint64_t nReadBytes{0};
+    uint64_t nWriteBatches{0};
+    uint64_t nWriteBytes{0};
+    bool fCompacting{false};
+    int64_t nCompactionStart{0};
+    int64_t nLastCompactionEnd{0};
+    int64_t nLastCompactionDuration{0};
+    std::vector<CDBLevelStats> vLevels;
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -197,16 +242,34 @@ private:
     //! the database itself
     leveldb::DB* pdb;
 
+    //! profile name, empty for unnamed databases
+    std::string strName;
+
+    //! activity counters, see GetStats()
+    mutable std::atomic<uint64_t> nReads{0};
+    mutable std::atomic<uint64_t> nReadBytes{0};
+    std::atomic<uint64_t> nWriteBatches{0};
+    std::atomic<uint64_t> nWriteBytes{0};
+
+    //! manual compaction state, times in milliseconds
+    std::atomic<bool> fCompacting{false};
+    std::atomic<int64_t> nCompactionStart{0};
+    std::atomic<int64_t> nLastCompactionEnd{0};
+    std::atomic<int64_t> nLastCompactionDuration{0};
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] strNameIn   Profile name; named databases use -dbprofile.<name> and can be looked up with FindDBWrapper.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, const std::string& strNameIn = "");
     ~CDBWrapper();
 
+    const std::string& GetName() const { return strName; }
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -217,12 +280,14 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadBytes += strValue.size();
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
@@ -250,12 +315,14 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        nReads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        nReadBytes += strValue.size();
         return true;
     }
 
@@ -292,6 +359,15 @@ public:
     */
     bool IsEmpty();
 
+    /**
+     * Compact the whole key range. Blocks until LevelDB is done; returns false without
+     * doing anything when a manual compaction of this database is already running.
+     */
+    bool Compact();
+
+    /** Snapshot of the activity counters and the per level LevelDB compaction statistics */
+    CDBStats GetStats() const;
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -310,4 +386,10 @@ public:
 
 };
 
+/** Open database with the given profile name, or NULL. Valid until the database is closed. */
+CDBWrapper* FindDBWrapper(const std::string& strName);
+
+/** Names of the open named databases */
+std::vector<std::string> ListDBWrappers();
+
 #endif // BITCOIN_DBWRAPPER_H
@@ -78,6 +78,35 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+HTTPJSONReply::HTTPJSONReply(HTTPRequest* reqIn) : req(reqIn),
+                                                    stream([reqIn](const std::string& strChunk) {
+                                                        if (!reqIn->IsChunked()) {
+                                                            reqIn->WriteHeader("Content-Type", "application/json");
+                                                            reqIn->StartChunkedReply(HTTP_OK);
+                                                        }
+                                                        reqIn->WriteReplyChunk(strChunk);
+                                                    })
+{
+}
+
+void HTTPJSONReply::Finish()
+{
+    if (!stream.Flushed()) {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, stream.GetBuffer());
+        return;
+    }
+    stream.Flush();
+    req->EndChunkedReply();
+}
+
+void HTTPJSONReply::Abort()
+{
+    assert(stream.Flushed());
+    LogPrintf("%s: reply to %s cut short\n", __func__, req->GetURI());
+    req->EndChunkedReply();
+}
+
 static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUsernameOut)
 {
     if (strRPCUserColonPass.empty()) // Belt-and-suspenders measure if InitRPCAuthentication was not called
@@ -121,6 +150,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    HTTPJSONReply reply(req);
     try {
         // Parse request
         UniValue valRequest;
@@ -130,29 +160,45 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // The reply is written as JSONRPCReply would, the calls listing many entries
+            // stream them into its result instead of returning it
+            JSONStreamWriter& stream = reply.Stream();
+            stream.BeginObject();
+            stream.Key("result");
+            jreq.pstream = &stream;
             UniValue result = tableRPC.execute(jreq);
+            if (stream.AwaitingValue())
+                stream.Value(result);
+            stream.KeyValue("error", NullUniValue);
+            stream.KeyValue("id", jreq.id);
+            stream.EndObject();
+            stream.Raw("\n");
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            reply.Finish();
 
         // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        } else if (valRequest.isArray()) {
+            std::string strReply = JSONRPCExecBatch(valRequest.get_array());
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strReply);
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
-
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        if (reply.Started())
+            reply.Abort();
+        else
+            JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (reply.Started())
+            reply.Abort();
+        else
+            JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
     return true;
@@ -6,11 +6,36 @@
 #ifndef BITCOIN_HTTPRPC_H
 #define BITCOIN_HTTPRPC_H
 
+#include "rpc/jsonstream.h"
+
 #include <string>
 #include <map>
 
 class HTTPRequest;
 
+/**
+ * JSON reply to an HTTP request, written through a JSONStreamWriter. Once the first flush
+ * worth of output is produced the reply goes out chunked while the rest is written, a
+ * smaller one is sent whole.
+ */
+class HTTPJSONReply
+{
+private:
+    HTTPRequest* req;
+    JSONStreamWriter stream;
+
+public:
+    explicit HTTPJSONReply(HTTPRequest* reqIn);
+
+    JSONStreamWriter& Stream() { return stream; }
+    /** Whether part of the reply was sent, so that an error can't take its place anymore */
+    bool Started() const { return stream.Flushed(); }
+    /** Send the rest of the reply, with status HTTP_OK */
+    void Finish();
+    /** End a started reply where it is, the client sees a truncated document */
+    void Abort();
+};
+
 /** Start HTTP RPC subsystem.
  * Precondition; HTTP and RPC has been started.
  */
@@ -35,4 +60,16 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start the Prometheus metrics endpoint.
+ * Precondition; HTTP and RPC has been started.
+ */
+bool StartMetrics();
+/** Interrupt the metrics endpoint.
+ */
+void InterruptMetrics();
+/** Stop the metrics endpoint.
+ * Precondition; HTTP and RPC has been stopped.
+ */
+void StopMetrics();
+
 #endif
@@ -558,12 +558,20 @@ void HTTPEvent::trigger(struct timeval* tv)
         evtimer_add(ev, tv); // trigger after timeval passed
 }
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       replyChunked(false),
+                                                       replyFileSegment(nullptr)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    // the ranges added to the reply hold references of their own
+    if (replyFileSegment)
+        evbuffer_file_segment_free(replyFileSegment);
+    if (replyChunked && !replySent) {
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -616,7 +624,7 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && !replyChunked && req);
     // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
@@ -628,6 +636,65 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+bool HTTPRequest::AddReplyFile(const fs::path& path, int64_t nOffset, int64_t nLength)
+{
+    assert(!replySent && !replyChunked && req);
+    if (!replyFileSegment || path != pathReplyFile) {
+        FILE* file = fsbridge::fopen(path, "rb");
+        if (!file)
+            return false;
+        int fd = dup(fileno(file));
+        fclose(file);
+        if (fd < 0)
+            return false;
+        struct evbuffer_file_segment* segment = evbuffer_file_segment_new(fd, 0, -1, EVBUF_FS_CLOSE_ON_FREE);
+        if (!segment) {
+            close(fd);
+            return false;
+        }
+        if (replyFileSegment)
+            evbuffer_file_segment_free(replyFileSegment);
+        replyFileSegment = segment;
+        pathReplyFile = path;
+    }
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    return evbuffer_add_file_segment(evb, replyFileSegment, nOffset, nLength) == 0;
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !replyChunked && req);
+    // The pieces are sent from the main http thread too, in the order they were triggered
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        std::bind(evhttp_send_reply_start, req, nStatus, (const char*)NULL));
+    ev->trigger(0);
+    replyChunked = true;
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(replyChunked && !replySent && req);
+    struct evhttp_request* reqChunk = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [reqChunk, strChunk] {
+        struct evbuffer* evb = evbuffer_new();
+        assert(evb);
+        evbuffer_add(evb, strChunk.data(), strChunk.size());
+        evhttp_send_reply_chunk(reqChunk, evb);
+        evbuffer_free(evb);
+    });
+    ev->trigger(0);
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(replyChunked && !replySent && req);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(evhttp_send_reply_end, req));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
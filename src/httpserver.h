@@ -6,6 +6,8 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include "fs.h"
+
 #include <string>
 #include <stdint.h>
 #include <functional>
@@ -15,6 +17,7 @@ static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
 struct evhttp_request;
+struct evbuffer_file_segment;
 struct event_base;
 class CService;
 class HTTPRequest;
@@ -60,6 +63,10 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool replyChunked;
+    //! file AddReplyFile added ranges of last, kept open for the next range
+    fs::path pathReplyFile;
+    struct evbuffer_file_segment* replyFileSegment;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -115,6 +122,37 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Add nLength bytes of the file at path from nOffset to the body of the reply. They
+     * are not read into memory but sent from the file when the reply goes out, with
+     * sendfile where the platform has it. Consecutive ranges of one file share its handle.
+     *
+     * @note call before WriteReply, which sends these ranges ahead of strReply.
+     */
+    bool AddReplyFile(const fs::path& path, int64_t nOffset, int64_t nLength);
+
+    /**
+     * Start a reply whose body is sent in pieces as it is produced, with chunked
+     * transfer encoding. nStatus is the HTTP status code to send.
+     *
+     * @note Instead of WriteReply. Send the body with WriteReplyChunk, then finish
+     * with EndChunkedReply.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /** Send the next piece of a chunked reply. */
+    void WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Finish a chunked reply.
+     *
+     * @note As for WriteReply, do not call any other HTTPRequest methods after this.
+     */
+    void EndChunkedReply();
+
+    /** Whether a chunked reply was started. */
+    bool IsChunked() const { return replyChunked; }
 };
 
 /** Event handler closure.
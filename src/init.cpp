@@ -24,6 +24,7 @@
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/upgrades.h"
+#include "crypto/sha256.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
@@ -79,7 +80,9 @@
 #include <boost/foreach.hpp>
 
 #if ENABLE_ZMQ
+#include "zmq/zmqabstractnotifier.h"
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqrpc.h"
 #endif
 
 
@@ -91,9 +94,6 @@ volatile bool fRestartRequested = false; // true: restart false: shutdown
 
 std::unique_ptr<CConnman> g_connman;
 
-#if ENABLE_ZMQ
-static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
-#endif
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -185,6 +185,7 @@ void Interrupt()
     InterruptHTTPRPC();
     InterruptRPC();
     InterruptREST();
+    InterruptMetrics();
     InterruptTorControl();
     if (g_connman)
         g_connman->Interrupt();
@@ -209,6 +210,7 @@ void PrepareShutdown()
     mempool.AddTransactionsUpdated(1);
     StopHTTPRPC();
     StopREST();
+    StopMetrics();
     StopRPC();
     StopHTTPServer();
 #ifdef ENABLE_WALLET
@@ -391,7 +393,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-debuglogfile=<file>", strprintf(_("Specify location of debug log file: this can be an absolute path or a path relative to the data directory (default: %s)"), DEFAULT_DEBUGLOGFILE));
     strUsage += HelpMessageOpt("-disablesystemnotifications", strprintf(_("Disable OS notifications for incoming transactions (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-asyncflush", strprintf(_("Write the coin database from a background thread on periodic and cache size flushes (default: %u)"), DEFAULT_ASYNC_FLUSH));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbprofile.<db>=<settings>", _("Tune the LevelDB options of <db> (blockindex, chainstate or sporks). <settings> is a comma separated list of a preset (default, nvme) and "
+        "key=value pairs: maxopenfiles=<n>, blocksize=<KiB>, compression=<0|1>, bloombits=<n>, cache=<percent of -dbcache>. "
+        "Open files above the default of 64 are taken from the file descriptors left for connections"));
+    strUsage += HelpMessageOpt("-importthreads=<n>", strprintf(_("Set the number of threads parsing and checking blocks during -reindex and -loadblock (%d to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), 1 - GetNumCores(), MAX_IMPORT_THREADS, DEFAULT_IMPORT_THREADS));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), DEFAULT_MAX_REORG_DEPTH));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
@@ -403,11 +410,19 @@ std::string HelpMessage(HelpMessageMode mode)
 #endif
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-resync", _("Delete blockchain folders and resync from scratch") + " " + _("on startup"));
+#ifdef ENABLE_BOOTSTRAP
+    strUsage += HelpMessageOpt("-bootstrap", _("Download the blockchain from the bootstrap server") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-bootstrapmode=<mode>", strprintf(_("How -bootstrap gets the blockchain: zip replaces the block and chainstate folders with a downloaded archive, "
+        "stream imports and validates verified chunks of blocks while they download (default: %s)"), DEFAULT_BOOTSTRAP_MODE));
+    strUsage += HelpMessageOpt("-bootstrapurl=<url>", _("Download the bootstrap from <url> instead of the default server; file:// URLs read a local directory"));
+#endif
     strUsage += HelpMessageOpt("-rewindblockindex[=<n or hash>]", _("When used without a value, rewinds blockchain to last checkpoint. When passing a number, rolls back the chain by the given number of blocks. When passing a block hash (as a hex string), rewind up to (not including) the block with the matching hash."));
 #if !defined(WIN32)
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
+    strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain an index of the outputs and spends of every address, used by the getaddressbalance, getaddressutxos and getaddresstxids rpc calls. Turning it on builds it for the existing chain (default: %u)"), DEFAULT_ADDRESSINDEX));
+    strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain an index of the input spending every output and the fees of every block, used by the getspentinfo and getblockindexstats rpc calls. Turning it on builds it for the existing chain (default: %u)"), DEFAULT_SPENTINDEX));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
@@ -426,6 +441,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandlerworkers=<n>", strprintf(_("Number of threads handling masternode, spork, address and ping messages alongside block and transaction processing (0-%d, default: %d)"), MAX_MSGHANDLER_WORKERS, DEFAULT_MSGHANDLER_WORKERS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -434,6 +450,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsModes(), SocketEventsModeToString(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -456,6 +473,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawtxbatch=<address>", _("Enable publish the raw transactions of each connected block as one message in <address>"));
+    strUsage += HelpMessageOpt("-zmqpub<type>hwm=<n>", strprintf(_("Set the outbound message high water mark of a <type> notification, messages are dropped and counted once it is reached (default: %d)"), DEFAULT_ZMQ_SNDHWM));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -476,6 +495,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf(_("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u)."), DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-sporkkey=<privkey>", _("Enable spork administration functionality with the appropriate private key."));
         strUsage += HelpMessageOpt("-nuparams=upgradeName:activationHeight", "Use given activation height for specified network upgrade (regtest-only)");
+        strUsage += HelpMessageOpt("-sha256impl=<impl>", strprintf("SHA-256 implementation to use if the CPU supports it: %s (default: auto)", boost::algorithm::join(std::vector<std::string>(std::begin(SHA256_IMPLEMENTATIONS), std::end(SHA256_IMPLEMENTATIONS)), ", ")));
     }
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied, output all debugging information.") + _("<category> can be:") + " " + ListLogCategories() + ".");
@@ -490,7 +510,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug) {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf(_("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:%u)"), DEFAULT_LIMITFREERELAY));
         strUsage += HelpMessageOpt("-relaypriority", strprintf(_("Require high priority for relaying free or low-fee transactions (default:%u)"), DEFAULT_RELAYPRIORITY));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(_("Limit size of signature cache to <n> MiB (default: %u)"), DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf(_("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)"), DEFAULT_MAX_SIG_CACHE_SIZE));
     }
     strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/Kb) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)"), CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -508,6 +528,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Masternode options:"));
     strUsage += HelpMessageOpt("-masternode=<n>", strprintf(_("Enable the client to act as a masternode (0-1, default: %u)"), DEFAULT_MASTERNODE));
     strUsage += HelpMessageOpt("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), PIVX_MASTERNODE_CONF_FILENAME));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-forcedseglimit", strprintf("Refuse requests of the whole masternode list coming within %d seconds of the last one from every peer, on every network (default: %u)", MASTERNODES_DSEG_SECONDS, 0));
     strUsage += HelpMessageOpt("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), DEFAULT_MNCONFLOCK));
     strUsage += HelpMessageOpt("-masternodeprivkey=<n>", _("Set the masternode private key"));
 
@@ -526,6 +548,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metrics", strprintf(_("Serve network message statistics in Prometheus text format on /metrics (default: %u)"), DEFAULT_METRICS_ENABLE));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", _("Bind to given address to listen for JSON-RPC connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: bind to all interfaces)"));
     strUsage += HelpMessageOpt("-rpccookiefile=<loc>", _("Location of the auth cookie (default: data dir)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
@@ -628,6 +651,10 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
     // -reindex
     if (fReindex) {
         CImportingNow imp;
+        int nFiles = 0;
+        while (fs::exists(GetBlockPosFilename(CDiskBlockPos(nFiles, 0), "blk")))
+            nFiles++;
+        ImportProgressBegin("reindex", nFiles);
         int nFile = 0;
         while (true) {
             CDiskBlockPos pos(nFile, 0);
@@ -637,9 +664,11 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
             if (!file)
                 break; // This error is logged in OpenBlockFile
             LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+            ImportProgressFile(nFile);
             LoadExternalBlockFile(file, &pos);
             nFile++;
         }
+        ImportProgressEnd();
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -655,24 +684,41 @@ void ThreadImport(std::vector<fs::path> vImportFiles)
             CImportingNow imp;
             fs::path pathBootstrapOld = GetDataDir() / "bootstrap.dat.old";
             LogPrintf("Importing bootstrap.dat...\n");
+            ImportProgressBegin("bootstrap", 1);
             LoadExternalBlockFile(file);
+            ImportProgressEnd();
             RenameOver(pathBootstrap, pathBootstrapOld);
         } else {
             LogPrintf("Warning: Could not open bootstrap file %s\n", pathBootstrap.string());
         }
     }
 
+#ifdef ENABLE_BOOTSTRAP
+    // -bootstrap -bootstrapmode=stream
+    if (GetBoolArg("-bootstrap", false) && GetArg("-bootstrapmode", DEFAULT_BOOTSTRAP_MODE) == "stream") {
+        CImportingNow imp;
+        LogPrintf("Importing the bootstrap from %s...\n", CBootstrap::GetBaseURL());
+        if (!CBootstrap::StreamImport())
+            LogPrintf("Warning: The bootstrap import did not complete, it resumes on the next start with -bootstrap\n");
+    }
+#endif
+
     // -loadblock=
-    for (fs::path& path : vImportFiles) {
+    if (!vImportFiles.empty())
+        ImportProgressBegin("loadblock", vImportFiles.size());
+    for (size_t i = 0; i < vImportFiles.size(); i++) {
+        const fs::path& path = vImportFiles[i];
         FILE* file = fsbridge::fopen(path, "rb");
         if (file) {
             CImportingNow imp;
             LogPrintf("Importing blocks file %s...\n", path.string());
+            ImportProgressFile(i);
             LoadExternalBlockFile(file);
         } else {
             LogPrintf("Warning: Could not open blocks file %s\n", path.string());
         }
     }
+    ImportProgressEnd();
 
     if (GetBoolArg("-stopafterblockimport", DEFAULT_STOPAFTERBLOCKIMPORT)) {
         LogPrintf("Stopping after block import\n");
@@ -715,6 +761,8 @@ bool AppInitServers()
         return false;
     if (GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
         return false;
+    if (GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE) && !StartMetrics())
+        return false;
     if (!StartHTTPServer())
         return false;
     return true;
@@ -933,13 +981,32 @@ bool AppInit2()
     int nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     int nMaxConnections = std::max(nUserMaxConnections, 4 * MAX_OUTBOUND_CONNECTIONS);
 
+    SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+    if (mapArgs.count("-socketevents") && !SocketEventsModeFromString(GetArg("-socketevents", ""), socketEventsMode))
+        return UIError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), GetArg("-socketevents", ""), GetSupportedSocketEventsModes()));
+
+    const std::string strSHA256Impl = GetArg("-sha256impl", "auto");
+    if (std::find(std::begin(SHA256_IMPLEMENTATIONS), std::end(SHA256_IMPLEMENTATIONS), strSHA256Impl) == std::end(SHA256_IMPLEMENTATIONS))
+        return UIError(strprintf(_("Unknown -sha256impl ('%s') specified."), strSHA256Impl));
+
+    // LevelDB keeps up to max_open_files table files of each database open. The core
+    // descriptors cover the default; larger -dbprofile settings come out of the connections.
+    int nDBFileDescriptors = 0;
+    for (const std::string strDB : {"blockindex", "chainstate", "sporks"})
+        nDBFileDescriptors += std::max(GetDBProfile(strDB).nMaxOpenFiles - CDBProfile().nMaxOpenFiles, 0);
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
-    int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
+    if (socketEventsMode == SOCKETEVENTS_SELECT) {
+        // select() cannot watch descriptors above FD_SETSIZE
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - nDBFileDescriptors)), 0);
+    }
+    int nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + nDBFileDescriptors);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return UIError(_("Not enough file descriptors available."));
-    if (nFD - MIN_CORE_FILEDESCRIPTORS < nMaxConnections)
-        nMaxConnections = nFD - MIN_CORE_FILEDESCRIPTORS;
+    if (nFD < MIN_CORE_FILEDESCRIPTORS + nDBFileDescriptors)
+        return UIError(strprintf(_("Not enough file descriptors available for the -dbprofile maxopenfiles settings (%d available, %d needed)."), nFD, MIN_CORE_FILEDESCRIPTORS + nDBFileDescriptors));
+    if (nFD - MIN_CORE_FILEDESCRIPTORS - nDBFileDescriptors < nMaxConnections)
+        nMaxConnections = nFD - MIN_CORE_FILEDESCRIPTORS - nDBFileDescriptors;
 
     // ********************************************************* Step 3: parameter-to-internal-flags
 
@@ -1011,6 +1078,12 @@ bool AppInit2()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+#ifdef ENABLE_BOOTSTRAP
+    const std::string strBootstrapMode = GetArg("-bootstrapmode", DEFAULT_BOOTSTRAP_MODE);
+    if (strBootstrapMode != "zip" && strBootstrapMode != "stream")
+        return UIError(strprintf(_("Unknown -bootstrapmode: '%s'"), strBootstrapMode));
+#endif
+
     setvbuf(stdout, NULL, _IOLBF, 0); /// ***TODO*** do we still need this after -printtoconsole is gone?
 
     // Staking needs a CWallet instance, so make sure wallet is enabled
@@ -1027,6 +1100,11 @@ bool AppInit2()
     }
 #endif
 
+#if ENABLE_ZMQ
+    // Register ZMQ RPC commands
+    zmqRegisterRPCCommands();
+#endif
+
     nConnectTimeout = GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1069,6 +1147,8 @@ bool AppInit2()
 
     fReindex = GetBoolArg("-reindex", false);
 
+    LogPrintf("Using SHA256 implementation: %s\n", SHA256AutoDetect(strSHA256Impl));
+
     // Initialize elliptic curve code
     RandomInit();
     ECC_Start();
@@ -1240,7 +1320,7 @@ bool AppInit2()
         }
 
 #ifdef ENABLE_BOOTSTRAP
-        if (GetBoolArg("-bootstrap", false) ) {
+        if (GetBoolArg("-bootstrap", false) && GetArg("-bootstrapmode", DEFAULT_BOOTSTRAP_MODE) == "zip") {
 
             uiInterface.InitMessage(_("Preparing for bootstrap..."));
 
@@ -1429,16 +1509,40 @@ bool AppInit2()
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
+    // -dbprofile.<db>=...,cache=<n> replaces the default share of a database
+    const int64_t nTotalDbCache = nTotalCache;
+    int nProfileCachePercent = 0;
+    for (const std::string strDB : {"blockindex", "chainstate", "sporks"}) {
+        if (!mapArgs.count("-dbprofile." + strDB))
+            continue;
+        CDBProfile profile;
+        std::string strError;
+        if (!ParseDBProfile(mapArgs["-dbprofile." + strDB], profile, strError))
+            return UIError(strprintf(_("Invalid -dbprofile.%s: %s"), strDB, strError));
+        nProfileCachePercent += std::max(profile.nCachePercent, 0);
+    }
+    if (nProfileCachePercent > 100)
+        return UIError(_("The -dbprofile cache shares add up to more than 100 percent"));
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     if (nBlockTreeDBCache > (1 << 21) && !GetBoolArg("-txindex", DEFAULT_TXINDEX))
         nBlockTreeDBCache = (1 << 21); // block tree db cache shouldn't be larger than 2 MiB
+    if (GetDBProfile("blockindex").nCachePercent >= 0)
+        nBlockTreeDBCache = nTotalDbCache * GetDBProfile("blockindex").nCachePercent / 100;
     nTotalCache -= nBlockTreeDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
+    if (GetDBProfile("chainstate").nCachePercent >= 0)
+        nCoinDBCache = std::min(nTotalCache, nTotalDbCache * GetDBProfile("chainstate").nCachePercent / 100);
     nTotalCache -= nCoinDBCache;
+    int64_t nSporkDBCache = 0;
+    if (GetDBProfile("sporks").nCachePercent >= 0)
+        nSporkDBCache = std::min(nTotalCache, nTotalDbCache * GetDBProfile("sporks").nCachePercent / 100);
+    nTotalCache -= nSporkDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    if (nSporkDBCache > 0)
+        LogPrintf("* Using %.1fMiB for spork database\n", nSporkDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
 
     const CChainParams& chainparams = Params();
@@ -1460,7 +1564,7 @@ bool AppInit2()
                 delete pSporkDB;
 
                 //specific: spork DB's
-                pSporkDB = new CSporkDB(0, false, false);
+                pSporkDB = new CSporkDB(nSporkDBCache, false, false);
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
@@ -1470,11 +1574,12 @@ bool AppInit2()
                     pblocktree->WriteReindexing(true);
                 } else {
                     uiInterface.InitMessage(_("Upgrading coins database..."));
-                    // If necessary, upgrade from older database format.
-                    if (!pcoinsdbview->Upgrade()) {
-                        strLoadError = _("Error upgrading chainstate database");
-                        break;
-                    }
+                }
+                // If necessary, upgrade from older database format. A wiped database only
+                // gets its format marked, which keeps older versions from starting on it.
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
                 }
 
                 // End loop if shutdown was requested
@@ -1512,6 +1617,35 @@ bool AppInit2()
                     break;
                 }
 
+                // Check for changed -addressindex state: build the index of the chain there is
+                // when it is turned on, stop maintaining it when it is turned off
+                if (fAddressIndex != GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+                    if (fAddressIndex) {
+                        fAddressIndex = false;
+                        pblocktree->WriteFlag("addressindex", false);
+                    } else {
+                        uiInterface.InitMessage(_("Building address index..."));
+                        if (!BuildAddressIndex()) {
+                            strLoadError = _("Error building address index");
+                            break;
+                        }
+                    }
+                }
+
+                // The same for -spentindex
+                if (fSpentIndex != GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+                    if (fSpentIndex) {
+                        fSpentIndex = false;
+                        pblocktree->WriteFlag("spentindex", false);
+                    } else {
+                        uiInterface.InitMessage(_("Building spent index..."));
+                        if (!BuildSpentIndex()) {
+                            strLoadError = _("Error building spent index");
+                            break;
+                        }
+                    }
+                }
+
                 if (!fReindex) {
                     uiInterface.InitMessage(_("Verifying blocks..."));
 
@@ -1760,6 +1894,8 @@ bool AppInit2()
     connOptions.uiInterface = &uiInterface;
     connOptions.nSendBufferMaxSize = 1000*GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.socketEventsMode = socketEventsMode;
+    connOptions.nMessageHandlerWorkers = GetArg("-msghandlerworkers", DEFAULT_MSGHANDLER_WORKERS);
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return UIError(strNodeError);
@@ -1783,6 +1919,7 @@ bool AppInit2()
         // StakeMiner thread disabled by default on regtest
         if (fStaking) {
             threadGroup.create_thread(boost::bind(&ThreadStakeMinter));
+            threadGroup.create_thread(boost::bind(&ThreadStakeTemplateBuilder));
         }
     }
 #endif
@@ -12,6 +12,7 @@
 
 const bool DEFAULT_PROXYRANDOMIZE = true;
 const bool DEFAULT_REST_ENABLE = false;
+const bool DEFAULT_METRICS_ENABLE = false;
 const bool DEFAULT_DISABLE_SAFEMODE = false;
 const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 const bool DEFAULT_MASTERNODE  = false;
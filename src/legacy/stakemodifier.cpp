@@ -41,10 +41,10 @@ static bool SelectBlockFromCandidates(
     uint256 hashBest;
     *pindexSelected = (const CBlockIndex*)0;
     for (const auto& item : vSortedByTimestamp) {
-        if (!mapBlockIndex.count(item.second))
+        const CBlockIndex* pindex = LookupBlockIndex(item.second);
+        if (!pindex)
             return error("%s : failed to find block index for candidate block %s", __func__, item.second.ToString().c_str());
 
-        const CBlockIndex* pindex = mapBlockIndex[item.second];
         if (fSelected && pindex->GetBlockTime() > nSelectionIntervalStop)
             break;
 
@@ -11,10 +11,12 @@
 
 #include "main.h"
 
+#include "addressindex.h"
 #include "addrman.h"
 #include "amount.h"
 #include "blocksignature.h"
 #include "chainparams.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
@@ -36,6 +38,7 @@
 #include "reverse_iterate.h"
 #include "rewards.h"
 #include "spork.h"
+#include "spentindex.h"
 #include "sporkdb.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -49,9 +52,12 @@
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/foreach.hpp>
 #include <atomic>
+#include <condition_variable>
 #include <queue>
+#include <thread>
 #include <regex>
 
 
@@ -77,6 +83,8 @@
 RecursiveMutex cs_main;
 
 BlockMap mapBlockIndex;
+/** Changes to mapBlockIndex hold this on top of cs_main, lookups without cs_main share it */
+static boost::shared_mutex cs_mapBlockIndex;
 CChain chainActive;
 CBlockIndex* pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
@@ -90,6 +98,8 @@ int nScriptCheckThreads = 0;
 std::atomic<bool> fImporting{false};
 std::atomic<bool> fReindex{false};
 bool fTxIndex = true;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
 bool fCheckBlockIndex = false;
 bool fVerifyingBlocks = false;
 size_t nCoinCacheUsage = 5000 * 300;
@@ -222,6 +232,12 @@ std::set<CBlockIndex*> setDirtyBlockIndex;
 
 /** Dirty block file entries. */
 std::set<int> setDirtyFileInfo;
+
+/** Spent index changes, a null value erasing the entry, and fee records of the blocks connected
+ *  or disconnected since the last flush, which writes them with the block index. */
+Mutex cs_dirtyIndexes;
+std::map<COutPoint, CSpentIndexValue> mapDirtySpentIndex;
+std::map<uint256, CBlockFeeRecord> mapDirtyBlockFees;
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -667,6 +683,13 @@ CBlockIndex* GetChainTip()
     return mapBlockIndex.at(p->GetBlockHash());
 }
 
+CBlockIndex* LookupBlockIndex(const uint256& hash)
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_mapBlockIndex);
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    return it == mapBlockIndex.end() ? nullptr : it->second;
+}
+
 CCoinsViewCache* pcoinsTip = NULL;
 CBlockTreeDB* pblocktree = NULL;
 CSporkDB* pSporkDB = NULL;
@@ -826,6 +849,15 @@ std::string FormatStateMessage(const CValidationState &state)
         state.GetRejectCode());
 }
 
+/** Script verification flags ConnectBlock applies to the transactions of a block on top of the given height */
+static unsigned int GetBlockScriptFlags(int nPrevHeight, const Consensus::Params& consensus)
+{
+    unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+    if (consensus.NetworkUpgradeActive(nPrevHeight, Consensus::UPGRADE_BIP65))
+        flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
+    return flags;
+}
+
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, bool fLimitFree,
                               bool* pfMissingInputs, bool fOverrideMempoolLimit, bool fRejectAbsurdFee, bool ignoreFees,
                               std::vector<COutPoint>& coins_to_uncache)
@@ -1044,23 +1076,22 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState &state, const C
             flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
 
         PrecomputedTransactionData precomTxData(tx);
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+        if (!CheckInputs(tx, state, view, true, flags, true, false, precomTxData)) {
             return false;
         }
 
-        // Check again against just the consensus-critical mandatory script
-        // verification flags, in case of bugs in the standard flags that cause
-        // transactions to pass as valid when they're actually invalid. For
-        // instance the STRICTENC flag was incorrectly allowing certain
-        // CHECKSIG NOT scripts to pass, even though they were invalid.
+        // Check again against the consensus-critical flags a block would apply,
+        // in case of bugs in the standard flags that cause transactions to pass
+        // as valid when they're actually invalid. For instance the STRICTENC flag
+        // was incorrectly allowing certain CHECKSIG NOT scripts to pass, even
+        // though they were invalid. Running them with the block's flags lets the
+        // script execution cache spare ConnectBlock the same work.
         //
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
-        flags = MANDATORY_SCRIPT_VERIFY_FLAGS;
-        if (fCLTVIsActivated)
-            flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-        if (!CheckInputs(tx, state, view, true, flags, true, precomTxData)) {
+        flags = GetBlockScriptFlags(chainHeight, consensus);
+        if (!CheckInputs(tx, state, view, true, flags, true, true, precomTxData)) {
             return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
                     __func__, hash.ToString(), FormatStateMessage(state));
         }
@@ -1258,7 +1289,7 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
             flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
 
         PrecomputedTransactionData precomTxData(tx);
-        if (!CheckInputs(tx, state, view, false, flags, true, precomTxData)) {
+        if (!CheckInputs(tx, state, view, false, flags, true, false, precomTxData)) {
             return error("AcceptableInputs: : ConnectInputs failed %s", hash.ToString());
         }
 
@@ -1272,7 +1303,7 @@ bool AcceptableInputs(CTxMemPool& pool, CValidationState& state, const CTransact
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
         // for any real tx this will be checked on AcceptToMemoryPool anyway
-        //        if (!CheckInputs(tx, state, view, false, MANDATORY_SCRIPT_VERIFY_FLAGS, true, precomTxData))
+        //        if (!CheckInputs(tx, state, view, false, MANDATORY_SCRIPT_VERIFY_FLAGS, true, false, precomTxData))
         //        {
         //            return error("AcceptableInputs: : BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s", hash.ToString());
         //        }
@@ -1305,8 +1336,8 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
 {
     CBlockIndex* pindexSlow = blockIndex;
 
-    LOCK(cs_main);
-
+    // The mempool and the transaction index have locks of their own, so do the block files;
+    // only the coins cache of the slow path needs cs_main.
     if (!blockIndex) {
         if (mempool.lookup(hash, txOut)) {
             return true;
@@ -1337,6 +1368,7 @@ bool GetTransaction(const uint256& hash, CTransaction& txOut, uint256& hashBlock
         }
 
         if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
+            LOCK(cs_main);
             const Coin& coin = AccessByTxid(*pcoinsTip, hash);
             if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
         }
@@ -1421,6 +1453,77 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadBlockSizeFromDisk(unsigned int& nSizeRet, const CDiskBlockPos& pos)
+{
+    // WriteBlockToDisk puts the message start and the size right before the block
+    if (pos.nPos < MESSAGE_START_SIZE + sizeof(nSizeRet))
+        return error("%s : no block header at %d:%u", __func__, pos.nFile, pos.nPos);
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - MESSAGE_START_SIZE - sizeof(nSizeRet));
+    CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed for %d:%u", __func__, pos.nFile, pos.nPos);
+
+    CMessageHeader::MessageStartChars messageStart;
+    try {
+        filein >> FLATDATA(messageStart) >> nSizeRet;
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (memcmp(messageStart, Params().MessageStart(), MESSAGE_START_SIZE))
+        return error("%s : block header magic mismatch at %d:%u", __func__, pos.nFile, pos.nPos);
+    if (nSizeRet < 80 || nSizeRet > MAX_BLOCK_SIZE_CURRENT)
+        return error("%s : block size %u out of range at %d:%u", __func__, nSizeRet, pos.nFile, pos.nPos);
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos)
+{
+    unsigned int nSize;
+    if (!ReadBlockSizeFromDisk(nSize, pos))
+        return false;
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s : OpenBlockFile failed for %d:%u", __func__, pos.nFile, pos.nPos);
+
+    vchBlock.resize(nSize);
+    try {
+        filein.read((char*)vchBlock.data(), nSize);
+    } catch (const std::exception& e) {
+        return error("%s : I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool ReadRawTransactionFromDisk(const uint256& hash, std::vector<unsigned char>& vchTx, uint256& hashBlock)
+{
+    CDiskTxPos postx;
+    if (!fTxIndex || !pblocktree->ReadTxIndex(hash, postx))
+        return false;
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+
+    // the index has the offset of the transaction but not its size, which takes parsing it
+    CBlockHeader header;
+    CTransaction tx;
+    long nTxPos;
+    try {
+        file >> header;
+        fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+        nTxPos = ftell(file.Get());
+        file >> tx;
+        vchTx.resize(ftell(file.Get()) - nTxPos);
+        fseek(file.Get(), nTxPos, SEEK_SET);
+        file.read((char*)vchTx.data(), vchTx.size());
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+    if (tx.GetHash() != hash)
+        return error("%s : txid mismatch", __func__);
+    hashBlock = header.GetHash();
+    return true;
+}
+
 
 double ConvertBitsToDouble(unsigned int nBits)
 {
@@ -1702,7 +1805,7 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
 }
 }// namespace Consensus
 
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck> *pvChecks, bool fCountCacheLookup)
 {
     if (!tx.IsCoinBase()) {
 
@@ -1720,6 +1823,12 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
+            // Transactions validated before with these same flags, typically on
+            // mempool acceptance, need not run their scripts again.
+            const uint256 hashCacheEntry = ScriptExecutionCacheEntry(tx, flags);
+            if (ScriptExecutionCacheGet(hashCacheEntry, !cacheFullScriptStore, fCountCacheLookup))
+                return true;
+
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint& prevout = tx.vin[i].prevout;
                 const Coin& coin = inputs.AccessCoin(prevout);
@@ -1734,7 +1843,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 const CAmount amount = coin.out.nValue;
 
                 // Verify signature
-                CScriptCheck check(scriptPubKey, amount, tx, i, flags, cacheStore, &precomTxData);
+                CScriptCheck check(scriptPubKey, amount, tx, i, flags, cacheSigStore, &precomTxData);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1747,7 +1856,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
                         CScriptCheck check2(scriptPubKey, amount, tx, i,
-                            flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &precomTxData);
+                            flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &precomTxData);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -1761,6 +1870,11 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                     return state.DoS(100, false, REJECT_INVALID, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
                 }
             }
+
+            if (cacheFullScriptStore && !pvChecks) {
+                // All scripts ran above and passed, so the result can be cached.
+                ScriptExecutionCacheSet(hashCacheEntry);
+            }
         }
     }
 
@@ -1881,8 +1995,9 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
- *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view)
+ *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state.
+ *  With fJustCheck the block indexes are left untouched, for a disconnect in a throwaway view. */
+DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewCache& view, bool fJustCheck = false)
 {
     AssertLockHeld(cs_main);
 
@@ -1912,6 +2027,11 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
         return DISCONNECT_FAILED;
     }
 
+    // collected before the spent coins are moved out of the undo data
+    CAddressIndexBlock addressIndex;
+    if (fAddressIndex && !fJustCheck)
+        GetAddressIndexChanges(block, blockUndo, pindex->nHeight, addressIndex);
+
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction& tx = block.vtx[i];
@@ -1959,6 +2079,19 @@ DisconnectResult DisconnectBlock(CBlock& block, CBlockIndex* pindex, CCoinsViewC
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
+    if (fAddressIndex && !fJustCheck && !pblocktree->EraseAddressIndex(addressIndex)) {
+        error("%s: failed to revert the address index", __func__);
+        return DISCONNECT_FAILED;
+    }
+
+    if (fSpentIndex && !fJustCheck) {
+        LOCK(cs_dirtyIndexes);
+        for (unsigned int i = 1; i < block.vtx.size(); i++) {
+            for (const CTxIn& txin : block.vtx[i].vin)
+                mapDirtySpentIndex[txin.prevout].SetNull();
+        }
+    }
+
     if(!IsInitialBlockDownload()) {
         // Dynamic rewards management
         if(!CRewards::DisconnectBlock(pindex)) return DISCONNECT_UNCLEAN;
@@ -2059,11 +2192,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
 
-    // If scripts won't be checked anyways, don't bother seeing if CLTV is activated
-    bool fCLTVIsActivated = false;
-    if (fScriptChecks && pindex->pprev) {
-        fCLTVIsActivated = consensus.NetworkUpgradeActive(pindex->pprev->nHeight, Consensus::UPGRADE_BIP65);
-    }
+    const unsigned int nScriptFlags = GetBlockScriptFlags(pindex->pprev->nHeight, consensus);
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
@@ -2115,12 +2244,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             nValueIn += view.GetValueIn(tx);
 
             std::vector<CScriptCheck> vChecks;
-            unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
-            if (fCLTVIsActivated)
-                flags |= SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY;
-
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : NULL))
+            if (!CheckInputs(tx, state, view, fScriptChecks, nScriptFlags, fCacheResults, fCacheResults, precomTxData[i], nScriptCheckThreads ? &vChecks : NULL, !fJustCheck))
                 return error("%s: Check inputs on %s failed with %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
         }
@@ -2203,6 +2328,22 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fAddressIndex) {
+        CAddressIndexBlock addressIndex;
+        GetAddressIndexChanges(block, blockundo, pindex->nHeight, addressIndex);
+        if (!pblocktree->WriteAddressIndex(addressIndex))
+            return AbortNode(state, "Failed to write address index");
+    }
+
+    if (fSpentIndex) {
+        std::vector<std::pair<COutPoint, CSpentIndexValue> > vSpent;
+        GetSpentIndexChanges(block, blockundo, pindex->nHeight, vSpent);
+        LOCK(cs_dirtyIndexes);
+        for (const std::pair<COutPoint, CSpentIndexValue>& entry : vSpent)
+            mapDirtySpentIndex[entry.first] = entry.second;
+        mapDirtyBlockFees[pindex->GetBlockHash()] = GetBlockFeeRecord(block, blockundo);
+    }
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2263,7 +2404,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 enum FlushStateMode {
     FLUSH_STATE_IF_NEEDED,
     FLUSH_STATE_PERIODIC,
-    FLUSH_STATE_ALWAYS
+    FLUSH_STATE_ALWAYS,
+    //! full flush, but the coin database write is left to its writer thread
+    FLUSH_STATE_ASYNC
 };
 
 /**
@@ -2291,7 +2434,8 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             nLastSetChain = nNow;
         }
         int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
+        // coins queued for the background write are still in memory until it commits
+        int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR + pcoinsTip->PendingWriteUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now
         // (not in the middle of a block processing).
@@ -2305,9 +2449,16 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
-        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush;
-        // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        bool fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || (mode == FLUSH_STATE_ASYNC) || fCacheLarge || fCacheCritical || fPeriodicFlush;
+        // Write blocks and block index to disk. An asynchronous flush, for a UTXO set scan,
+        // skips this when nothing changed since the last write, as the coins it is about
+        // to flush then only refer to blocks already on disk.
+        bool fBlockIndexDirty = !setDirtyFileInfo.empty() || !setDirtyBlockIndex.empty();
+        if (!fBlockIndexDirty) {
+            LOCK(cs_dirtyIndexes);
+            fBlockIndexDirty = !mapDirtySpentIndex.empty() || !mapDirtyBlockFees.empty();
+        }
+        if ((fDoFullFlush && (mode != FLUSH_STATE_ASYNC || fBlockIndexDirty)) || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
@@ -2327,9 +2478,14 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
-                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                // Readers of the spent index wait for the batch, so they find the records
+                // either staged or in the database
+                LOCK(cs_dirtyIndexes);
+                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, mapDirtySpentIndex, mapDirtyBlockFees)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
+                mapDirtySpentIndex.clear();
+                mapDirtyBlockFees.clear();
             }
             nLastWrite = nNow;
         }
@@ -2343,8 +2499,11 @@ bool static FlushStateToDisk(CValidationState& state, FlushStateMode mode)
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Flush the chainstate (which may refer to block index entries). Only forced flushes
+            // wait for LevelDB; otherwise the coins and best block marker go to disk in one batch
+            // from the coin database writer thread, and cs_main is free in the meantime.
+            const bool fAsync = mode == FLUSH_STATE_ASYNC || (mode != FLUSH_STATE_ALWAYS && GetBoolArg("-asyncflush", DEFAULT_ASYNC_FLUSH));
+            if (!pcoinsTip->Flush(fAsync))
                 return AbortNode(state, "Failed to write to coin database");
             nLastFlush = nNow;
         }
@@ -2366,10 +2525,17 @@ void FlushStateToDisk()
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+void FlushStateToDiskAsync()
+{
+    CValidationState state;
+    FlushStateToDisk(state, FLUSH_STATE_ASYNC);
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex* pindexNew)
 {
     chainActive.SetTip(pindexNew);
+    PublishChainSnapshot(chainActive);
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -2814,12 +2980,16 @@ bool ActivateBestChain(CValidationState& state, const CBlock* pblock, bool fAlre
                         });
                     }
                 }
-                // Notify external listeners about the new tip.
-                GetMainSignals().UpdatedBlockTip(pindexNewTip);
+                // Notify external listeners about the new tip. When the tip was connected
+                // from memory, serialize it once here so listeners don't read it back from disk.
+                CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+                if (pblock && pblock->GetHash() == hashNewTip && !GetMainSignals().UpdatedBlockTip.empty())
+                    ssBlock << *pblock;
+                GetMainSignals().UpdatedBlockTip(pindexNewTip, ssBlock.empty() ? nullptr : &ssBlock);
 
                 unsigned size = 0;
                 if (pblock)
-                    size = GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION);
+                    size = ssBlock.empty() ? GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION) : ssBlock.size();
                 // If the size is over 1 MB notify external listeners, and it is within the last 5 minutes
                 if (size > MAX_BLOCK_SIZE_LEGACY && pblock->GetBlockTime() > GetAdjustedTime() - 300) {
                     uiInterface.NotifyBlockSize(static_cast<int>(size), hashNewTip);
@@ -2926,13 +3096,20 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
-    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
-
-    pindexNew->phashBlock = &((*mi).first);
+    // The entry is visible to LookupBlockIndex callers without cs_main from its insertion
+    // on, so its hash and height are set first
     BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
     if (miPrev != mapBlockIndex.end()) {
         pindexNew->pprev = (*miPrev).second;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
+    }
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_mapBlockIndex);
+        BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &((*mi).first);
+    }
+
+    if (pindexNew->pprev) {
         pindexNew->BuildSkip();
 
         const Consensus::Params& consensus = Params().GetConsensus();
@@ -3089,14 +3266,9 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool f
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+/** Context free checks of the header, merkle root, size and coinbase/coinstake layout */
+static bool CheckBlockStructure(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot)
 {
-    AssertLockHeld(cs_main);
-
-    if (block.fChecked)
-        return true;
-
-    // These are checks that are independent of context.
     const bool IsPoS = block.IsProofOfStake();
 
     // Check that the header is valid (particularly PoW).  This is mostly
@@ -3147,6 +3319,55 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
                 return state.DoS(100, false, REJECT_INVALID, "bad-cs-multiple", false, "more than one coinstake");
     }
 
+    return true;
+}
+
+/** Context free checks of the transactions and the legacy sigop limit */
+static bool CheckBlockTransactions(const CBlock& block, CValidationState& state)
+{
+    // Check transactions
+    for (const CTransaction& tx : block.vtx) {
+        if (!CheckTransaction(
+                tx,
+                state
+        ))
+            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                             strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
+
+    }
+
+    unsigned int nSigOps = 0;
+    for (const CTransaction& tx : block.vtx) {
+        nSigOps += GetLegacySigOpCount(tx);
+    }
+    unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
+    if (nSigOps > nMaxBlockSigOps)
+        return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
+            REJECT_INVALID, "bad-blk-sigops", true);
+
+    return true;
+}
+
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state)
+{
+    if (!CheckBlockStructure(block, state, true, true) || !CheckBlockTransactions(block, state))
+        return false;
+    block.fCheckedContextFree = true;
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig)
+{
+    AssertLockHeld(cs_main);
+
+    if (block.fChecked)
+        return true;
+
+    // These are checks that are independent of context, unless CheckBlockContextFree already did them.
+    const bool fContextFreeDone = block.fCheckedContextFree && fCheckPOW && fCheckMerkleRoot;
+    if (!fContextFreeDone && !CheckBlockStructure(block, state, fCheckPOW, fCheckMerkleRoot))
+        return false;
+
     // masternode payments / budgets
     CBlockIndex* pindexPrev = chainActive.Tip();
     int nHeight = 0;
@@ -3176,25 +3397,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
         }
     }
 
-    // Check transactions
-    for (const CTransaction& tx : block.vtx) {
-        if (!CheckTransaction(
-                tx,
-                state
-        ))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                             strprintf("Transaction check failed (tx hash %s) %s", tx.GetHash().ToString(), state.GetDebugMessage()));
-
-    }
-
-    unsigned int nSigOps = 0;
-    for (const CTransaction& tx : block.vtx) {
-        nSigOps += GetLegacySigOpCount(tx);
-    }
-    unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_LEGACY;
-    if (nSigOps > nMaxBlockSigOps)
-        return state.DoS(100, error("%s : out-of-bounds SigOpCount", __func__),
-            REJECT_INVALID, "bad-blk-sigops", true);
+    if (!fContextFreeDone && !CheckBlockTransactions(block, state))
+        return false;
 
     if (fCheckPOW && fCheckMerkleRoot && fCheckSig)
         block.fChecked = true;
@@ -3312,10 +3516,11 @@ bool ContextualCheckBlockHeader(const CBlockHeader& block, CValidationState& sta
 
 bool IsBlockHashInChain(const uint256& hashBlock)
 {
-    if (hashBlock.IsNull() || !mapBlockIndex.count(hashBlock))
+    if (hashBlock.IsNull())
         return false;
 
-    return chainActive.Contains(mapBlockIndex[hashBlock]);
+    const CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+    return pindex && chainActive.Contains(pindex);
 }
 
 bool IsTransactionInChain(const uint256& txId, int& nHeightTx, CTransaction& tx)
@@ -3868,9 +4073,11 @@ CBlockIndex* InsertBlockIndex(uint256 hash)
     CBlockIndex* pindexNew = new CBlockIndex();
     if (!pindexNew)
         throw std::runtime_error("LoadBlockIndex() : new CBlockIndex failed");
-    mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
-
-    pindexNew->phashBlock = &((*mi).first);
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_mapBlockIndex);
+        mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
+        pindexNew->phashBlock = &((*mi).first);
+    }
 
     return pindexNew;
 }
@@ -3965,6 +4172,16 @@ bool static LoadBlockIndexDB(std::string& strError)
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("LoadBlockIndexDB(): transaction index %s\n", fTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have an address index
+    fAddressIndex = false;
+    pblocktree->ReadFlag("addressindex", fAddressIndex);
+    LogPrintf("LoadBlockIndexDB(): address index %s\n", fAddressIndex ? "enabled" : "disabled");
+
+    // Check whether we have a spent index
+    fSpentIndex = false;
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    LogPrintf("LoadBlockIndexDB(): spent index %s\n", fSpentIndex ? "enabled" : "disabled");
+
     // If this is written true before the next client init, then we know the shutdown process failed
     pblocktree->WriteFlag("shutdown", false);
 
@@ -3973,6 +4190,7 @@ bool static LoadBlockIndexDB(std::string& strError)
     if (it == mapBlockIndex.end())
         return true;
     chainActive.SetTip(it->second);
+    PublishChainSnapshot(chainActive);
 
     PruneBlockIndexCandidates();
 
@@ -4037,7 +4255,7 @@ bool CVerifyDB::VerifyDB(CCoinsView* coinsview, int nCheckLevel, int nCheckDepth
         }
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            DisconnectResult res = DisconnectBlock(block, pindex, coins);
+            DisconnectResult res = DisconnectBlock(block, pindex, coins, true);
             if (res == DISCONNECT_FAILED) {
                 return error("%s: *** irrecoverable inconsistency in block data at %d, hash=%s", __func__,
                              pindex->nHeight, pindex->GetBlockHash().ToString());
@@ -4242,11 +4460,14 @@ bool RewindBlockIndex(std::string param)
     }
 
     // Erase block indices in-memory
-    for (auto pindex : vBlocks) {
-        auto ret = mapBlockIndex.find(*pindex->phashBlock);
-        if (ret != mapBlockIndex.end()) {
-            mapBlockIndex.erase(ret);
-            delete pindex;
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_mapBlockIndex);
+        for (auto pindex : vBlocks) {
+            auto ret = mapBlockIndex.find(*pindex->phashBlock);
+            if (ret != mapBlockIndex.end()) {
+                mapBlockIndex.erase(ret);
+                delete pindex;
+            }
         }
     }
 
@@ -4266,6 +4487,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishChainSnapshot(chainActive);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -4282,9 +4504,15 @@ void UnloadBlockIndex()
     nPreferredDownload = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    {
+        LOCK(cs_dirtyIndexes);
+        mapDirtySpentIndex.clear();
+        mapDirtyBlockFees.clear();
+    }
     mapNodeState.clear();
     recentRejects.reset(nullptr);
 
+    boost::unique_lock<boost::shared_mutex> lock(cs_mapBlockIndex);
     for (BlockMap::value_type& entry : mapBlockIndex) {
         delete entry.second;
     }
@@ -4299,6 +4527,196 @@ bool LoadBlockIndex(std::string& strError)
     return true;
 }
 
+//! Blocks a worker takes at a time when building an index of the chain, and writes in one batch
+static const int INDEX_BUILD_RUN = 100;
+//! Unspent outputs written in one batch when building the address index
+static const size_t ADDRESS_INDEX_BUILD_UNSPENT = 10000;
+
+/** Collects the records of a run of blocks for one of the workers of BuildChainIndex */
+class CChainIndexBuilder
+{
+public:
+    virtual ~CChainIndexBuilder() {}
+    virtual void AddBlock(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockundo) = 0;
+    //! Write the records of the blocks added since the last call
+    virtual bool Write() = 0;
+};
+
+/**
+ * Build an index of the active chain from the block and undo files. Worker threads take runs
+ * of INDEX_BUILD_RUN blocks from the genesis on, so that each batch covers a span of the chain,
+ * while the calling thread runs meanwhile. Requires cs_main, held until the index is built.
+ */
+static bool BuildChainIndex(const char* strName, const std::function<std::unique_ptr<CChainIndexBuilder>()>& makeBuilder,
+                            const std::function<bool(const std::atomic<bool>& fFailed)>& meanwhile)
+{
+    AssertLockHeld(cs_main);
+
+    const int64_t nStart = GetTimeMillis();
+    const int nTipHeight = chainActive.Height();
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_IMPORT_THREADS));
+    LogPrintf("%s: building the %s of %d blocks on %d threads\n", __func__, strName, nTipHeight, nThreads);
+
+    std::atomic<int> nNextHeight{1};
+    std::atomic<bool> fFailed{false};
+    boost::thread_group workers;
+    for (int n = 0; n < nThreads; n++) {
+        workers.create_thread([&nNextHeight, &fFailed, &makeBuilder, nTipHeight] {
+            std::unique_ptr<CChainIndexBuilder> builder = makeBuilder();
+            while (!fFailed && !ShutdownRequested()) {
+                const int nFirst = nNextHeight.fetch_add(INDEX_BUILD_RUN);
+                if (nFirst > nTipHeight)
+                    break;
+                for (int nHeight = nFirst; nHeight < nFirst + INDEX_BUILD_RUN && nHeight <= nTipHeight; nHeight++) {
+                    const CBlockIndex* pindex = chainActive[nHeight];
+                    CBlock block;
+                    CBlockUndo blockundo;
+                    if (!ReadBlockFromDisk(block, pindex) || pindex->GetUndoPos().IsNull() ||
+                        !UndoReadFromDisk(blockundo, pindex->GetUndoPos(), pindex->pprev->GetBlockHash())) {
+                        error("BuildChainIndex() : failed to read block %d", nHeight);
+                        fFailed = true;
+                        break;
+                    }
+                    builder->AddBlock(pindex, block, blockundo);
+                }
+                if (!fFailed && !builder->Write())
+                    fFailed = true;
+            }
+        });
+    }
+
+    if (!meanwhile(fFailed))
+        fFailed = true;
+
+    workers.join_all();
+    if (fFailed || ShutdownRequested())
+        return error("%s: the %s was not built", __func__, strName);
+
+    LogPrintf("%s: %s built in %dms\n", __func__, strName, GetTimeMillis() - nStart);
+    return true;
+}
+
+class CAddressIndexBuilder : public CChainIndexBuilder
+{
+private:
+    CAddressIndexBlock changes;
+
+public:
+    void AddBlock(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockundo) override
+    {
+        GetAddressIndexChanges(block, blockundo, pindex->nHeight, changes, false);
+    }
+
+    bool Write() override
+    {
+        const bool fOk = pblocktree->WriteAddressIndex(changes);
+        changes.clear();
+        return fOk;
+    }
+};
+
+bool BuildAddressIndex()
+{
+    LOCK(cs_main);
+
+    // The unspent outputs come from the coins database, which has to be at the tip
+    FlushStateToDisk();
+    if (!pblocktree->WipeAddressIndex())
+        return error("%s: failed to wipe the address index", __func__);
+
+    const auto makeBuilder = [] { return std::unique_ptr<CChainIndexBuilder>(new CAddressIndexBuilder()); };
+    const auto buildUnspent = [](const std::atomic<bool>& fFailed) {
+        CAddressIndexBlock unspent;
+        std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsTip->Cursor());
+        while (pcursor->Valid() && !fFailed && !ShutdownRequested()) {
+            COutPoint key;
+            Coin coin;
+            uint8_t type;
+            uint160 hashBytes;
+            if (pcursor->GetKey(key) && pcursor->GetValue(coin) && GetAddressIndexKey(coin.out.scriptPubKey, type, hashBytes)) {
+                unspent.vUnspent.emplace_back(CAddressUnspentKey(type, hashBytes, key.hash, key.n),
+                                              CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight),
+                                              false);
+            }
+            if (unspent.vUnspent.size() >= ADDRESS_INDEX_BUILD_UNSPENT) {
+                if (!pblocktree->WriteAddressIndex(unspent))
+                    return false;
+                unspent.clear();
+            }
+            pcursor->Next();
+        }
+        return pblocktree->WriteAddressIndex(unspent);
+    };
+    if (!BuildChainIndex("address index", makeBuilder, buildUnspent))
+        return false;
+
+    fAddressIndex = true;
+    pblocktree->WriteFlag("addressindex", true);
+    return true;
+}
+
+class CSpentIndexBuilder : public CChainIndexBuilder
+{
+private:
+    std::vector<std::pair<COutPoint, CSpentIndexValue> > vSpent;
+    std::vector<std::pair<uint256, CBlockFeeRecord> > vBlockFees;
+
+public:
+    void AddBlock(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockundo) override
+    {
+        GetSpentIndexChanges(block, blockundo, pindex->nHeight, vSpent);
+        vBlockFees.emplace_back(pindex->GetBlockHash(), GetBlockFeeRecord(block, blockundo));
+    }
+
+    bool Write() override
+    {
+        const bool fOk = pblocktree->WriteSpentIndex(vSpent, vBlockFees);
+        vSpent.clear();
+        vBlockFees.clear();
+        return fOk;
+    }
+};
+
+bool BuildSpentIndex()
+{
+    LOCK(cs_main);
+
+    // Write out the records staged by the blocks connected so far
+    FlushStateToDisk();
+    if (!pblocktree->WipeSpentIndex())
+        return error("%s: failed to wipe the spent index", __func__);
+
+    const auto makeBuilder = [] { return std::unique_ptr<CChainIndexBuilder>(new CSpentIndexBuilder()); };
+    if (!BuildChainIndex("spent index", makeBuilder, [](const std::atomic<bool>&) { return true; }))
+        return false;
+
+    fSpentIndex = true;
+    pblocktree->WriteFlag("spentindex", true);
+    return true;
+}
+
+bool ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value)
+{
+    LOCK(cs_dirtyIndexes);
+    auto it = mapDirtySpentIndex.find(outpoint);
+    if (it != mapDirtySpentIndex.end()) {
+        value = it->second;
+        return !value.IsNull();
+    }
+    return pblocktree->ReadSpentIndex(outpoint, value);
+}
+
+bool ReadBlockFeeRecord(const uint256& hashBlock, CBlockFeeRecord& record)
+{
+    LOCK(cs_dirtyIndexes);
+    auto it = mapDirtyBlockFees.find(hashBlock);
+    if (it != mapDirtyBlockFees.end()) {
+        record = it->second;
+        return true;
+    }
+    return pblocktree->ReadBlockFeeRecord(hashBlock, record);
+}
+
 
 bool InitBlockIndex()
 {
@@ -4314,6 +4732,10 @@ bool InitBlockIndex()
     // Use the provided setting for -txindex in the new database
     fTxIndex = GetBoolArg("-txindex", true);
     pblocktree->WriteFlag("txindex", fTxIndex);
+    fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    pblocktree->WriteFlag("addressindex", fAddressIndex);
+    fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    pblocktree->WriteFlag("spentindex", fSpentIndex);
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4342,88 +4764,338 @@ bool InitBlockIndex()
 }
 
 
-bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
+static Mutex cs_importProgress;
+static CImportProgress importProgress GUARDED_BY(cs_importProgress);
+
+void ImportProgressBegin(const std::string& strSource, int nFiles)
+{
+    LOCK(cs_importProgress);
+    importProgress = CImportProgress();
+    importProgress.fActive = true;
+    importProgress.strSource = strSource;
+    importProgress.nFiles = nFiles;
+    importProgress.nTimeStart = GetTimeMillis();
+}
+
+void ImportProgressFile(int nFile)
+{
+    LOCK(cs_importProgress);
+    importProgress.nFile = nFile;
+    importProgress.nFilePos = 0;
+    importProgress.nFileSize = 0;
+}
+
+void ImportProgressEnd()
+{
+    LOCK(cs_importProgress);
+    importProgress.fActive = false;
+}
+
+CImportProgress GetImportProgress()
+{
+    LOCK(cs_importProgress);
+    return importProgress;
+}
+
+static int GetImportThreads()
+{
+    // -importthreads=0 means autodetect, leaving one core to connect the blocks
+    int nThreads = GetArg("-importthreads", DEFAULT_IMPORT_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores() - 1;
+    return std::max(0, std::min(nThreads, MAX_IMPORT_THREADS));
+}
+
+/** A block read from an import file, waiting to be parsed and then connected */
+struct CImportBlockJob {
+    std::vector<char> vchBlock;     //!< raw block as found in the file
+    uint64_t nBlockPos{0};          //!< file position of the block
+    uint64_t nRewindPos{0};         //!< where to continue scanning if the block does not deserialize
+    CDiskBlockPos pos;              //!< position of the block, if the file is one of our block files
+
+    // set by the parser
+    bool fDone{false};
+    bool fDeserialized{false};
+    size_t nConsumed{0};            //!< bytes taken by the block, may be less than vchBlock.size()
+    std::string strError;
+    CBlock block;
+    uint256 hash;
+};
+typedef std::shared_ptr<CImportBlockJob> CImportBlockJobRef;
+
+/**
+ * Worker threads that deserialize imported blocks and run the checks that need neither
+ * cs_main nor the chain state: the context free part of CheckBlock and the block signature.
+ * Connecting the blocks stays in order on the importing thread, which then finds the
+ * expensive checks already done. Without threads the jobs are parsed on submission.
+ */
+class CBlockImportParser
+{
+private:
+    Mutex cs;
+    std::condition_variable cvWork;
+    std::condition_variable cvDone;
+    std::deque<CImportBlockJobRef> queue GUARDED_BY(cs);
+    bool fStop GUARDED_BY(cs){false};
+    std::vector<std::thread> vThreads;
+
+    static void Parse(CImportBlockJob& job)
+    {
+        try {
+            CDataStream ss(job.vchBlock.data(), job.vchBlock.data() + job.vchBlock.size(), SER_DISK, CLIENT_VERSION);
+            ss >> job.block;
+            job.nConsumed = job.vchBlock.size() - ss.size();
+            job.fDeserialized = true;
+        } catch (const std::exception& e) {
+            job.strError = e.what();
+            return;
+        }
+        job.hash = job.block.GetHash();
+        CValidationState state;
+        // failures are reported again, with the block's context, by ProcessNewBlock
+        if (CheckBlockContextFree(job.block, state) && CheckBlockSignature(job.block, true))
+            job.block.fCheckedSignature = true;
+        {
+            LOCK(cs_importProgress);
+            importProgress.nBlocksParsed++;
+        }
+    }
+
+    void ThreadParse()
+    {
+        while (true) {
+            CImportBlockJobRef job;
+            {
+                WAIT_LOCK(cs, lock);
+                while (!fStop && queue.empty())
+                    cvWork.wait(lock);
+                if (fStop)
+                    return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            Parse(*job);
+            {
+                LOCK(cs);
+                job->fDone = true;
+            }
+            cvDone.notify_all();
+        }
+    }
+
+public:
+    explicit CBlockImportParser(int nThreads)
+    {
+        for (int i = 0; i < nThreads; i++)
+            vThreads.emplace_back(&TraceThread<std::function<void()> >, "loadblkparse", std::function<void()>(std::bind(&CBlockImportParser::ThreadParse, this)));
+    }
+
+    ~CBlockImportParser()
+    {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cvWork.notify_all();
+        for (std::thread& thread : vThreads)
+            thread.join();
+    }
+
+    void Submit(const CImportBlockJobRef& job)
+    {
+        if (vThreads.empty()) {
+            Parse(*job);
+            job->fDone = true;
+            return;
+        }
+        {
+            LOCK(cs);
+            queue.push_back(job);
+        }
+        cvWork.notify_one();
+    }
+
+    void Wait(const CImportBlockJobRef& job)
+    {
+        WAIT_LOCK(cs, lock);
+        while (!job->fDone)
+            cvDone.wait(lock);
+    }
+
+    /** Forget the jobs not yet picked up by a thread */
+    void Clear()
+    {
+        LOCK(cs);
+        queue.clear();
+    }
+};
+
+/** Blocks read ahead of the one being connected, and the bytes they may take */
+static const size_t IMPORT_MAX_BLOCKS_AHEAD = 256;
+static const size_t IMPORT_MAX_BYTES_AHEAD = 32 * 1024 * 1024;
+
+bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp, bool* pfFailed)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
+    const int nThreads = GetImportThreads();
+    {
+        LOCK(cs_importProgress);
+        importProgress.nThreads = nThreads;
+        const long nFilePos = ftell(fileIn);
+        if (nFilePos >= 0 && fseek(fileIn, 0, SEEK_END) == 0) {
+            importProgress.nFileSize = std::max<long>(ftell(fileIn), 0);
+            fseek(fileIn, nFilePos, SEEK_SET);
+        }
+    }
+
     int nLoaded = 0;
+    bool fFailed = false;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
+        CBlockImportParser parser(nThreads);
+        std::deque<CImportBlockJobRef> vJobs;
+        size_t nBytesAhead = 0;
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        bool fEof = false;
+        while (true) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
+            // read ahead and hand the blocks to the parser
+            while (!fEof && vJobs.size() < IMPORT_MAX_BLOCKS_AHEAD && nBytesAhead < IMPORT_MAX_BYTES_AHEAD) {
+                if (blkdat.eof()) {
+                    fEof = true;
+                    break;
+                }
+                blkdat.SetPos(nRewind);
+                nRewind++;         // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                try {
+                    // locate a header
+                    unsigned char buf[MESSAGE_START_SIZE];
+                    blkdat.FindByte(Params().MessageStart()[0]);
+                    nRewind = blkdat.GetPos() + 1;
+                    blkdat >> FLATDATA(buf);
+                    if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                        continue;
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    fEof = true;
+                    break;
+                }
+                try {
+                    // read block
+                    CImportBlockJobRef job = std::make_shared<CImportBlockJob>();
+                    job->nRewindPos = nRewind;
+                    job->nBlockPos = blkdat.GetPos();
+                    if (dbp) {
+                        job->pos = *dbp;
+                        job->pos.nPos = job->nBlockPos;
+                    }
+                    blkdat.SetLimit(job->nBlockPos + nSize);
+                    blkdat.SetPos(job->nBlockPos);
+                    job->vchBlock.resize(nSize);
+                    // in pieces, a read may not take more than the buffer minus the rewind
+                    for (unsigned int nRead = 0; nRead < nSize; nRead += MAX_BLOCK_SIZE_CURRENT / 2)
+                        blkdat.read(&job->vchBlock[nRead], std::min(nSize - nRead, MAX_BLOCK_SIZE_CURRENT / 2));
+                    nRewind = blkdat.GetPos();
+                    parser.Submit(job);
+                    vJobs.push_back(job);
+                    nBytesAhead += nSize;
+                } catch (const std::exception& e) {
+                    LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+                    fFailed = true;
+                }
+            }
+            if (vJobs.empty())
                 break;
+
+            CImportBlockJobRef job = vJobs.front();
+            vJobs.pop_front();
+            nBytesAhead -= job->vchBlock.size();
+            parser.Wait(job);
+            if (dbp)
+                dbp->nPos = job->nBlockPos;
+
+            // The read ahead assumed the block takes all of its announced size. If it did not,
+            // scan again from where the single threaded loader would have continued.
+            const uint64_t nNext = job->fDeserialized ? job->nBlockPos + job->nConsumed : job->nRewindPos;
+            if (nNext != job->nBlockPos + job->vchBlock.size()) {
+                parser.Clear();
+                vJobs.clear();
+                nBytesAhead = 0;
+                if (!blkdat.Seek(nNext))
+                    break;
+                nRewind = nNext;
+                fEof = false;
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
+            {
+                LOCK(cs_importProgress);
+                importProgress.nBytesRead += nNext - std::min(nNext, importProgress.nFilePos);
+                importProgress.nFilePos = std::max(nNext, importProgress.nFilePos);
+            }
+            if (!job->fDeserialized) {
+                LogPrintf("%s : Deserialize or I/O error - %s", __func__, job->strError);
+                fFailed = true;
+                continue;
+            }
+
+            const CBlock& block = job->block;
+            CDiskBlockPos* pos = dbp ? &job->pos : nullptr;
+
+            // detect out of order blocks, and store them for later
+            const uint256& hash = job->hash;
+            if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
+                        hash.GetHex(), block.hashPrevBlock.GetHex());
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__,
-                            hash.GetHex(), block.hashPrevBlock.GetHex());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
+                    mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *pos));
+                continue;
+            }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, nullptr, &block, dbp, nullptr))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != Params().GetConsensus().hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+            // process in case the block isn't known yet
+            const CBlockIndex* pindexKnown = LookupBlockIndex(hash);
+            if (!pindexKnown || (pindexKnown->nStatus & BLOCK_HAVE_DATA) == 0) {
+                CValidationState state;
+                if (ProcessNewBlock(state, nullptr, &block, pos, nullptr)) {
+                    nLoaded++;
+                    LOCK(cs_importProgress);
+                    importProgress.nBlocksLoaded++;
+                } else {
+                    fFailed = true;
                 }
+                if (state.IsError())
+                    break;
+            } else if (hash != Params().GetConsensus().hashGenesisBlock && pindexKnown->nHeight % 1000 == 0) {
+                LogPrintf("Block Import: already had block %s at height %d\n", hash.ToString(), pindexKnown->nHeight);
+            }
 
+            try {
                 // Recursively process earlier encountered successors of this block
                 std::deque<uint256> queue;
                 queue.push_back(hash);
+                CBlock blockChild;
                 while (!queue.empty()) {
                     uint256 head = queue.front();
                     queue.pop_front();
                     std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
                     while (range.first != range.second) {
                         std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
+                        if (ReadBlockFromDisk(blockChild, it->second)) {
+                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, blockChild.GetHash().ToString(),
                                 head.ToString());
                             CValidationState dummy;
-                            if (ProcessNewBlock(dummy, nullptr, &block, &it->second, nullptr)) {
+                            if (ProcessNewBlock(dummy, nullptr, &blockChild, &it->second, nullptr)) {
                                 nLoaded++;
-                                queue.push_back(block.GetHash());
+                                queue.push_back(blockChild.GetHash());
                             }
                         }
                         range.first++;
@@ -4436,9 +5108,12 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
+        fFailed = true;
     }
+    if (pfFailed)
+        *pfFailed = fFailed;
     if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+        LogPrintf("Loaded %i blocks from external file in %dms (%d parser threads)\n", nLoaded, GetTimeMillis() - nStart, nThreads);
     return nLoaded > 0;
 }
 
@@ -4650,13 +5325,13 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     case MSG_SPORK:
         return mapSporks.count(inv.hash);
     case MSG_MASTERNODE_ANNOUNCE:
-        if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
+        if (mnodeman.HaveSeenBroadcast(inv.hash)) {
             masternodeSync.AddedMasternodeList(inv.hash);
             return true;
         }
         return false;
     case MSG_MASTERNODE_PING:
-        return mnodeman.mapSeenMasternodePing.count(inv.hash);
+        return mnodeman.HaveSeenPing(inv.hash);
     }
     // Don't know what it is, just say we already got one
     return true;
@@ -4698,6 +5373,31 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** Number of recently served block messages kept framed in memory */
+static const unsigned int MAX_SHARED_BLOCK_MESSAGES = 8;
+/** Recently served blocks, keyed by block hash and send version. Several peers syncing the
+ *  same range get the same reference-counted buffers instead of a fresh read and serialization each. */
+static std::deque<std::pair<std::pair<uint256, int>, CSharedNetMsg>> vSharedBlockMessages GUARDED_BY(cs_main);
+
+static CSharedNetMsg GetSharedBlockMessage(const CBlockIndex* pindex, int nSendVersion)
+{
+    AssertLockHeld(cs_main);
+    const std::pair<uint256, int> key(pindex->GetBlockHash(), nSendVersion);
+    for (const auto& entry : vSharedBlockMessages) {
+        if (entry.first == key)
+            return entry.second;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex))
+        assert(!"cannot load block from disk");
+    CSharedNetMsg msg = CConnman::MakeSharedMessage(CNetMsgMaker(nSendVersion).Make(NetMsgType::BLOCK, block));
+    vSharedBlockMessages.emplace_back(key, msg);
+    if (vSharedBlockMessages.size() > MAX_SHARED_BLOCK_MESSAGES)
+        vSharedBlockMessages.pop_front();
+    return msg;
+}
+
 void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
@@ -4737,14 +5437,14 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                 }
                 // Don't send not-validated blocks
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
-                        assert(!"cannot load block from disk");
                     if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+                        connman.PushMessage(pfrom, GetSharedBlockMessage((*mi).second, pfrom->GetSendVersion()));
                     else // MSG_FILTERED_BLOCK)
                     {
+                        // Send block from disk
+                        CBlock block;
+                        if (!ReadBlockFromDisk(block, (*mi).second))
+                            assert(!"cannot load block from disk");
                         bool send = false;
                         CMerkleBlock merkleBlock;
                         {
@@ -4794,11 +5494,11 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                 }
 
                 if (!pushed && inv.type == MSG_TX) {
-                    CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
+                    CTransactionRef ptx = mempool.get(inv.hash);
+                    if (ptx) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << tx;
+                        ss << *ptx;
                         connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, ss));
                         pushed = true;
                     }
@@ -4813,20 +5513,19 @@ void static ProcessGetData(CNode* pfrom, CConnman& connman, std::atomic<bool>& i
                     }
                 }
                 if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
-                    if (mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash];
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNBROADCAST, ss));
+                    CSharedNetMsg msg;
+                    if (mnodeman.GetBroadcastMessage(inv.hash, msg)) {
+                        connman.PushMessage(pfrom, msg);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_MASTERNODE_PING) {
-                    if (mnodeman.mapSeenMasternodePing.count(inv.hash)) {
+                    CMasternodePing mnp;
+                    if (mnodeman.GetSeenPing(inv.hash, mnp)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodePing[inv.hash];
+                        ss << mnp;
                         connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss));
                         pushed = true;
                     }
@@ -5503,7 +6202,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     // Making users (which are behind NAT and can only make outgoing connections) ignore
     // getaddr message mitigates the attack.
     else if ((strCommand == NetMsgType::GETADDR) && (pfrom->fInbound)) {
-        pfrom->vAddrToSend.clear();
+        WITH_LOCK(pfrom->cs_addrSend, pfrom->vAddrToSend.clear());
         std::vector<CAddress> vAddr = connman.GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress& addr : vAddr)
@@ -5519,10 +6218,9 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         std::vector<CInv> vInv;
         for (uint256& hash : vtxid) {
             CInv inv(MSG_TX, hash);
-            CTransaction tx;
-            bool fInMemPool = mempool.lookup(hash, tx);
-            if (!fInMemPool) continue; // another thread removed since queryHashes, maybe...
-            if ((pfrom->pfilter && pfrom->pfilter->IsRelevantAndUpdate(tx)) ||
+            CTransactionRef ptx = mempool.get(hash);
+            if (!ptx) continue; // another thread removed since queryHashes, maybe...
+            if ((pfrom->pfilter && pfrom->pfilter->IsRelevantAndUpdate(*ptx)) ||
                 (!pfrom->pfilter))
                 vInv.push_back(inv);
             if (vInv.size() == MAX_INV_SZ) {
@@ -5794,6 +6492,8 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
 
     // Process message
     bool fRet = false;
+    const int64_t nProcessStart = GetTimeMicros();
+    CLockWaitTracker lockWait(&cs_main);
     try {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, connman, interruptMsgProc);
         if (interruptMsgProc)
@@ -5816,6 +6516,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, std::atomic<bool>& interru
     } catch (...) {
         PrintExceptionContinue(NULL, "ProcessMessages()");
     }
+    connman.RecordMessageProcessed(pfrom, strCommand, nProcessStart - msg.nTime, GetTimeMicros() - nProcessStart, lockWait.nWaitMicros);
 
     if (!fRet)
         LogPrintf("ProcessMessage(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -5900,6 +6601,7 @@ bool SendMessages(CNode* pto, CConnman& connman, std::atomic<bool>& interruptMsg
         //
         if (pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            LOCK(pto->cs_addrSend);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             for (const CAddress& addr : pto->vAddrToSend) {
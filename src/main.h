@@ -56,7 +56,9 @@ class CValidationState;
 
 struct PrecomputedTransactionData;
 struct CBlockTemplate;
+struct CBlockFeeRecord;
 struct CNodeStateStats;
+struct CSpentIndexValue;
 
 /** Default for -limitancestorcount, max number of in-mempool ancestors */
 static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
@@ -72,6 +74,10 @@ static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 72;
 /** Default for -txindex */
 static const bool DEFAULT_TXINDEX = true;
+/** Default for -addressindex */
+static const bool DEFAULT_ADDRESSINDEX = false;
+/** Default for -spentindex */
+static const bool DEFAULT_SPENTINDEX = false;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 /** Default for -testsafemode */
 static const bool DEFAULT_TESTSAFEMODE = false;
@@ -95,6 +101,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of block parsing threads used by -reindex and -loadblock imports */
+static const int MAX_IMPORT_THREADS = 16;
+/** -importthreads default (number of block parsing threads, 0 = auto) */
+static const int DEFAULT_IMPORT_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -111,6 +121,8 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Default for -asyncflush, writing the coin database in the background on non-forced flushes. */
+static const bool DEFAULT_ASYNC_FLUSH = true;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /** Average delay between local address broadcasts in seconds. */
@@ -161,6 +173,8 @@ extern std::atomic<bool> fImporting;
 extern std::atomic<bool> fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fSpentIndex;
 extern bool fCheckBlockIndex;
 extern size_t nCoinCacheUsage;
 extern CFeeRate minRelayTxFee;
@@ -203,12 +217,43 @@ FILE* OpenBlockFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 FILE* OpenUndoFile(const CDiskBlockPos& pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
 fs::path GetBlockPosFilename(const CDiskBlockPos& pos, const char* prefix);
-/** Import blocks from an external file */
-bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp = NULL);
+/** Import blocks from an external file. pfFailed, if given, is set when a block could not be read or was rejected */
+bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp = NULL, bool* pfFailed = NULL);
+
+/** Progress of a running -reindex, bootstrap.dat or -loadblock import */
+struct CImportProgress {
+    bool fActive{false};
+    std::string strSource;      //!< "reindex", "bootstrap" or "loadblock"
+    int nFile{0};               //!< index of the file being read
+    int nFiles{0};              //!< number of files known so far (0 if unknown)
+    uint64_t nFilePos{0};       //!< bytes read from the current file
+    uint64_t nFileSize{0};      //!< size of the current file
+    uint64_t nBytesRead{0};     //!< bytes read from all files
+    uint64_t nBlocksParsed{0};  //!< blocks deserialized and checked by the parser threads
+    uint64_t nBlocksLoaded{0};  //!< blocks handed to ProcessNewBlock
+    int nThreads{0};            //!< parser threads
+    int64_t nTimeStart{0};      //!< GetTimeMillis() at the start of the import
+};
+/** Begin reporting progress of an import of nFiles files (0 if unknown) */
+void ImportProgressBegin(const std::string& strSource, int nFiles);
+/** Move the progress report to the next file */
+void ImportProgressFile(int nFile);
+/** Stop reporting import progress */
+void ImportProgressEnd();
+/** Snapshot of the current import progress */
+CImportProgress GetImportProgress();
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex();
 /** Load the block tree and coins database from disk */
 bool LoadBlockIndex(std::string& strError);
+/** Build the address index of the active chain from the block and undo files, on several threads */
+bool BuildAddressIndex();
+/** Build the spent index and block fee records of the active chain from the block and undo files, on several threads */
+bool BuildSpentIndex();
+/** The input spending outpoint in the active chain, from the spent index */
+bool ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value);
+/** The fee record of a connected block, from the spent index */
+bool ReadBlockFeeRecord(const uint256& hashBlock, CBlockFeeRecord& record);
 /** Unload database information */
 void UnloadBlockIndex();
 /** See whether the protocol update is enforced for connected nodes */
@@ -251,6 +296,12 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats);
 void Misbehaving(NodeId nodeid, int howmuch) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/**
+ * Flush like FlushStateToDisk(), without waiting for the coin database write, and without
+ * writing the block index when it did not change. Cursors opened afterwards already see the
+ * flushed state, so UTXO set scans use this.
+ */
+void FlushStateToDiskAsync();
 
 
 /** (try to) add transaction to memory pool **/
@@ -286,8 +337,12 @@ CAmount GetMinRelayFee(const CTransaction& tx, const CTxMemPool& pool, unsigned
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
  * instead of being performed inline.
+ * cacheSigStore stores valid signatures in the signature cache. cacheFullScriptStore records the
+ * transaction as valid under flags in the script execution cache, which is consulted first; a hit
+ * skips all script checks, and is consumed unless cacheFullScriptStore is set. fCountCacheLookup
+ * adds that lookup to the script execution cache stats, which only ConnectBlock does.
  */
-bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL);
+bool CheckInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& view, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& precomTxData, std::vector<CScriptCheck>* pvChecks = NULL, bool fCountCacheLookup = false);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -355,6 +410,12 @@ public:
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Size of the block stored at pos, from the header the block files keep in front of every block */
+bool ReadBlockSizeFromDisk(unsigned int& nSizeRet, const CDiskBlockPos& pos);
+/** Read the block stored at pos as it is serialized, without deserializing it */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CDiskBlockPos& pos);
+/** Read a transaction as it is serialized in the block files, located through -txindex */
+bool ReadRawTransactionFromDisk(const uint256& hash, std::vector<unsigned char>& vchTx, uint256& hashBlock);
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -375,6 +436,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
 bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, bool fCheckSig = true);
+/** The part of CheckBlock that needs no chain state and no cs_main, so it can run on any thread.
+ *  On success the block is marked so that CheckBlock does not repeat it. */
+bool CheckBlockContextFree(const CBlock& block, CValidationState& state);
 bool CheckWork(const CBlock block, CBlockIndex* const pindexPrev);
 
 /** Context-dependent validity checks */
@@ -407,12 +471,8 @@ bool RewindBlockIndex(std::string param = "");
 
 const CBlockIndex* GetLastCheckpoint() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-inline CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    AssertLockHeld(cs_main);
-    BlockMap::const_iterator it = mapBlockIndex.find(hash);
-    return it == mapBlockIndex.end() ? nullptr : it->second;
-}
+/** Find a block index entry by hash, nullptr if unknown. Does not require cs_main. */
+CBlockIndex* LookupBlockIndex(const uint256& hash);
 
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
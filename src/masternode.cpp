@@ -138,8 +138,9 @@ bool CMasternode::UpdateFromNewBroadcast(CMasternodeBroadcast& mnb)
         int nDoS = 0;
         if (mnb.lastPing.IsNull() || (!mnb.lastPing.IsNull() && mnb.lastPing.CheckAndUpdate(nDoS, false))) {
             lastPing = mnb.lastPing;
-            mnodeman.mapSeenMasternodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
+            mnodeman.AddSeenPing(lastPing);
         }
+        mnodeman.ListChanged();
         return true;
     }
     return false;
@@ -188,22 +189,21 @@ void CMasternode::Check(bool forceCheck)
     //once spent, stop doing the checks
     if (activeState == MASTERNODE_VIN_SPENT) return;
 
+    const bool fWasEnabled = activeState == MASTERNODE_ENABLED;
+
     if (!IsPingedWithin(MASTERNODE_REMOVAL_SECONDS)) {
         activeState = MASTERNODE_REMOVE;
-        return;
-    }
-
-    if (!IsPingedWithin(MASTERNODE_EXPIRATION_SECONDS)) {
+    } else if (!IsPingedWithin(MASTERNODE_EXPIRATION_SECONDS)) {
         activeState = MASTERNODE_EXPIRED;
-        return;
-    }
-
-    if(lastPing.sigTime - sigTime < MASTERNODE_MIN_MNP_SECONDS) {
+    } else if(lastPing.sigTime - sigTime < MASTERNODE_MIN_MNP_SECONDS) {
         activeState = MASTERNODE_PRE_ENABLED;
-        return;
+    } else {
+        activeState = MASTERNODE_ENABLED; // OK
     }
 
-    activeState = MASTERNODE_ENABLED; // OK
+    // only the enabled masternodes are announced in reply to list requests
+    if (fWasEnabled != (activeState == MASTERNODE_ENABLED))
+        mnodeman.ListChanged();
 }
 
 int CMasternode::BlocksSincePayment(const CBlockIndex* pindex)
@@ -624,7 +624,7 @@ bool CMasternodeBroadcast::CheckInputsAndAdd(int& nDoS)
         TRY_LOCK(cs_main, lockMain);
         if (!lockMain) {
             // not mnb fault, let it to be checked again later
-            mnodeman.mapSeenMasternodeBroadcast.erase(GetHash());
+            mnodeman.RemoveSeenBroadcast(GetHash());
             masternodeSync.mapSeenSyncMNB.erase(GetHash());
             return false;
         }
@@ -643,7 +643,7 @@ bool CMasternodeBroadcast::CheckInputsAndAdd(int& nDoS)
     if (pcoinsTip->GetCoinDepthAtHeight(vin.prevout, nChainHeight) < MASTERNODE_MIN_CONFIRMATIONS) {
         LogPrint(BCLog::MASTERNODE,"mnb - Input must have at least %d confirmations\n", MASTERNODE_MIN_CONFIRMATIONS);
         // maybe we miss few blocks, let this mnb to be checked again later
-        mnodeman.mapSeenMasternodeBroadcast.erase(GetHash());
+        mnodeman.RemoveSeenBroadcast(GetHash());
         masternodeSync.mapSeenSyncMNB.erase(GetHash());
         return false;
     }
@@ -814,9 +814,7 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, bool fChec
             //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
             CMasternodeBroadcast mnb(*pmn);
             uint256 hash = mnb.GetHash();
-            if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = *this;
-            }
+            mnodeman.UpdateSeenBroadcastPing(hash, *this);
 
             pmn->Check(true);
             if (!pmn->IsEnabled()) return false;
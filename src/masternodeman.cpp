@@ -203,6 +203,7 @@ void DumpMasternodes()
 CMasternodeMan::CMasternodeMan()
 {
     nDsqCount = 0;
+    nListVersion = 0;
 }
 
 bool CMasternodeMan::Add(CMasternode& mn)
@@ -217,6 +218,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if(mnScript) {
         auto it = std::find(vMasternodes.begin(), vMasternodes.end(), mnScript);
         if(it != vMasternodes.end()) vMasternodes.erase(it);
+        ListChanged();
 
         return false;
     }
@@ -225,6 +227,7 @@ bool CMasternodeMan::Add(CMasternode& mn)
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - count %i now\n", mn.vin.prevout.ToStringShort(), size() + 1);
         auto m = new CMasternode(mn);
         vMasternodes.push_back(m);
+        ListChanged();
         {
             LOCK(cs_script);
             mapScriptMasternodes[GetScriptForDestination(m->pubKeyCollateralAddress.GetID())] = m;
@@ -259,6 +262,54 @@ void CMasternodeMan::AskForMN(CNode* pnode, const CTxIn& vin)
     mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
 }
 
+bool CMasternodeMan::HaveSeenBroadcast(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodeBroadcast.count(hash);
+}
+
+bool CMasternodeMan::HaveSeenPing(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSeenMasternodePing.count(hash);
+}
+
+bool CMasternodeMan::GetSeenPing(const uint256& hash, CMasternodePing& mnp)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end())
+        return false;
+    mnp = it->second;
+    return true;
+}
+
+bool CMasternodeMan::AddSeenBroadcast(const CMasternodeBroadcast& mnb)
+{
+    LOCK(cs);
+    return mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb)).second;
+}
+
+bool CMasternodeMan::AddSeenPing(const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    return mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp)).second;
+}
+
+void CMasternodeMan::RemoveSeenBroadcast(const uint256& hash)
+{
+    LOCK(cs);
+    mapSeenMasternodeBroadcast.erase(hash);
+}
+
+void CMasternodeMan::UpdateSeenBroadcastPing(const uint256& hash, const CMasternodePing& mnp)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it != mapSeenMasternodeBroadcast.end())
+        it->second.lastPing = mnp;
+}
+
 void CMasternodeMan::Check()
 {
     LOCK(cs);
@@ -319,6 +370,7 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
             }
             delete *it;
             it = vMasternodes.erase(it);
+            ListChanged();
         } else {
             ++it;
         }
@@ -360,11 +412,25 @@ void CMasternodeMan::CheckAndRemove(bool forceExpiredRemoval)
         if ((*it3).second.lastPing.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
             mapSeenMasternodeBroadcast.erase(it3++);
             masternodeSync.mapSeenSyncMNB.erase((*it3).second.GetHash());
+            ListChanged();
         } else {
             ++it3;
         }
     }
 
+    // forget the framed broadcasts that are no longer served
+    {
+        LOCK(cs_broadcastMessages);
+        auto it5 = mapBroadcastMessages.begin();
+        while (it5 != mapBroadcastMessages.end()) {
+            if (!mapSeenMasternodeBroadcast.count(it5->first)) {
+                it5 = mapBroadcastMessages.erase(it5);
+            } else {
+                ++it5;
+            }
+        }
+    }
+
     // remove expired mapSeenMasternodePing
     std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
     while (it4 != mapSeenMasternodePing.end()) {
@@ -404,6 +470,13 @@ void CMasternodeMan::Clear()
         mapSeenMasternodeBroadcast.clear();
         mapSeenMasternodePing.clear();
         nDsqCount = 0;
+        listSnapshot.reset();
+        ListChanged();
+    }
+
+    {
+        LOCK(cs_broadcastMessages);
+        mapBroadcastMessages.clear();
     }
 
     {
@@ -637,7 +710,8 @@ const CBlockIndex* CMasternodeMan::GetLastPaidBlockSlow(const CScript& script, c
 
             if(block.hashPrevBlock.IsNull()) return nullptr; // should not happen or we reached the genesis block
 
-            pindex = mapBlockIndex[block.hashPrevBlock];
+            pindex = LookupBlockIndex(block.hashPrevBlock);
+            if (!pindex) return nullptr; // should not happen
         }
     }
 
@@ -698,11 +772,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
+        if (!AddSeenBroadcast(mnb)) { //seen
             masternodeSync.AddedMasternodeList(mnb.GetHash());
             return;
         }
-        mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
 
         int nDoS = 0;
         if (!mnb.CheckAndUpdate(nDoS)) {
@@ -745,8 +818,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
 
         LogPrint(BCLog::MNPING, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.ToStringShort());
 
-        if (mapSeenMasternodePing.count(mnp.GetHash())) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+        if (!AddSeenPing(mnp)) return; //seen
 
         int nDoS = 0;
         if (mnp.CheckAndUpdate(nDoS)) return;
@@ -772,14 +844,18 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         vRecv >> vin;
 
         if (vin == CTxIn()) { //only should ask for this once
+            pfrom->nMNListRequests++;
+            pfrom->nLastMNListRequest = GetTime();
+
             //local network
             bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
 
-            if (!isLocal && Params().NetworkID() == CBaseChainParams::MAIN) {
+            if ((!isLocal && Params().NetworkID() == CBaseChainParams::MAIN) || GetBoolArg("-forcedseglimit", false)) {
                 std::map<CNetAddr, int64_t>::iterator i = mAskedUsForMasternodeList.find(pfrom->addr);
                 if (i != mAskedUsForMasternodeList.end()) {
                     int64_t t = (*i).second;
                     if (GetTime() < t) {
+                        pfrom->nMNListRefused++;
                         LogPrintf("CMasternodeMan::ProcessMessage() : dseg - peer already asked me for the list\n");
                         return;
                     }
@@ -790,23 +866,12 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
         } //else, asking for a specific node which is ok
 
         if(vin == CTxIn()) { // send all
-            LOCK(cs);
-            int nInvCount = 0;
-            for (const auto& mn : vMasternodes) {
-                if (mn->IsEnabled() && !mn->addr.IsRFC1918()) {
-                    LogPrint(BCLog::MASTERNODE, "dseg - Sending Masternode entry - %s \n", mn->vin.prevout.ToStringShort());
-                    
-                    CMasternodeBroadcast mnb = CMasternodeBroadcast(*mn);
-                    uint256 hash = mnb.GetHash();
-                    pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
-                    nInvCount++;
-
-                    if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
-                }
-            }
+            const std::shared_ptr<const CMasternodeListSnapshot> snapshot = GetListSnapshot();
+            for (const CSharedNetMsg& msg : snapshot->vInvMessages)
+                g_connman->PushMessage(pfrom, msg);
 
-            g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, nInvCount));
-            LogPrint(BCLog::MASTERNODE, "dseg - Sent %d Masternode entries to peer %i\n", nInvCount, pfrom->GetId());
+            g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, snapshot->nCount));
+            LogPrint(BCLog::MASTERNODE, "dseg - Sent %d Masternode entries of list version %u to peer %i\n", snapshot->nCount, snapshot->nVersion, pfrom->GetId());
         } else { // send specific one
 
             const auto mn = Find(vin);
@@ -818,7 +883,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
                 uint256 hash = mnb.GetHash();
                 pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hash));
 
-                if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
+                AddSeenBroadcast(mnb);
 
                 LogPrint(BCLog::MASTERNODE, "dseg - Sent 1 Masternode entry to peer %i\n", pfrom->GetId());
             }
@@ -826,6 +891,67 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, std::string& strCommand, CData
     }
 }
 
+std::shared_ptr<const CMasternodeListSnapshot> CMasternodeMan::GetListSnapshot()
+{
+    LOCK(cs);
+
+    // read before walking the list, a change made meanwhile leaves the snapshot behind
+    const uint64_t nVersion = nListVersion;
+    if (listSnapshot && listSnapshot->nVersion == nVersion)
+        return listSnapshot;
+
+    int64_t nStart = GetTimeMicros();
+    std::vector<CInv> vInv;
+    vInv.reserve(vMasternodes.size());
+    for (const auto& mn : vMasternodes) {
+        if (mn->IsEnabled() && !mn->addr.IsRFC1918()) {
+            CMasternodeBroadcast mnb = CMasternodeBroadcast(*mn);
+            uint256 hash = mnb.GetHash();
+            vInv.emplace_back(MSG_MASTERNODE_ANNOUNCE, hash);
+
+            if (!mapSeenMasternodeBroadcast.count(hash)) mapSeenMasternodeBroadcast.insert(std::make_pair(hash, mnb));
+        }
+    }
+
+    auto snapshot = std::make_shared<CMasternodeListSnapshot>();
+    snapshot->nVersion = nVersion;
+    snapshot->nCount = vInv.size();
+    CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    for (size_t i = 0; i < vInv.size(); i += MASTERNODE_LIST_INV_SZ) {
+        std::vector<CInv> vChunk(vInv.begin() + i, vInv.begin() + std::min(vInv.size(), i + MASTERNODE_LIST_INV_SZ));
+        snapshot->vInvMessages.push_back(CConnman::MakeSharedMessage(msgMaker.Make(NetMsgType::INV, vChunk)));
+    }
+    listSnapshot = snapshot;
+
+    LogPrint(BCLog::MASTERNODE, "dseg - Built list version %u of %d entries in %dus\n", nVersion, snapshot->nCount, GetTimeMicros() - nStart);
+    return listSnapshot;
+}
+
+bool CMasternodeMan::GetBroadcastMessage(const uint256& hash, CSharedNetMsg& msg)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end())
+        return false;
+
+    // the broadcast is relayed with the last ping seen, which replaces it every few minutes
+    const int64_t nPingTime = it->second.lastPing.sigTime;
+
+    LOCK(cs_broadcastMessages);
+    auto itMsg = mapBroadcastMessages.find(hash);
+    if (itMsg != mapBroadcastMessages.end() && itMsg->second.first == nPingTime) {
+        msg = itMsg->second.second;
+        return true;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(1000);
+    ss << it->second;
+    msg = CConnman::MakeSharedMessage(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::MNBROADCAST, ss));
+    mapBroadcastMessages[hash] = std::make_pair(nPingTime, msg);
+    return true;
+}
+
 void CMasternodeMan::Remove(CTxIn vin)
 {
     LOCK(cs);
@@ -848,6 +974,7 @@ void CMasternodeMan::Remove(CTxIn vin)
             }
             delete *it;
             vMasternodes.erase(it);
+            ListChanged();
             break;
         }
         ++it;
@@ -856,8 +983,8 @@ void CMasternodeMan::Remove(CTxIn vin)
 
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb)
 {
-    mapSeenMasternodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
-    mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
+    AddSeenPing(mnb.lastPing);
+    AddSeenBroadcast(mnb);
     masternodeSync.AddedMasternodeList(mnb.GetHash());
 
     LogPrint(BCLog::MASTERNODE,"CMasternodeMan::UpdateMasternodeList() -- masternode=%s\n", mnb.vin.prevout.ToStringShort());
@@ -875,7 +1002,7 @@ bool CMasternodeMan::Init()
 {
     if(initiatedAt > 0) return true;
 
-    FlushStateToDisk();
+    FlushStateToDiskAsync();
 
     LOCK(cs_collaterals);
 
@@ -997,6 +1124,7 @@ bool CMasternodeMan::ConnectBlock(const CBlockIndex* pindex, const CBlock& block
                 const auto pmn = Find(script);
                 if(pmn) {
                     pmn->activeState = CMasternode::MASTERNODE_VIN_SPENT;
+                    ListChanged();
                 }
             }
             mapCAmountCollaterals.erase(nCollateral);
@@ -1030,6 +1158,7 @@ bool CMasternodeMan::ConnectBlock(const CBlockIndex* pindex, const CBlock& block
                 const auto pmn = Find(scriptPubKey);
                 if(pmn) {
                     pmn->activeState = CMasternode::MASTERNODE_VIN_SPENT;
+                    ListChanged();
                 }
             }
         }
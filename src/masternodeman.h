@@ -19,8 +19,14 @@
 
 #include <boost/unordered_map.hpp>
 
+#include <atomic>
+#include <memory>
+
 #define MASTERNODES_DSEG_SECONDS (5 * 60)
 
+/** Announcements per inv message of a masternode list reply */
+static const unsigned int MASTERNODE_LIST_INV_SZ = 1000;
+
 class CMasternodeMan;
 class CActiveMasternode;
 
@@ -29,6 +35,18 @@ extern CActiveMasternodeMan amnodeman;
 
 void DumpMasternodes();
 
+/**
+ * The reply to a request for the whole masternode list (dseg): the announcements of the enabled
+ * public masternodes, framed once per version of the list and pushed by reference to every peer
+ * asking until the list changes.
+ */
+struct CMasternodeListSnapshot
+{
+    uint64_t nVersion;
+    int nCount;                            // masternodes announced
+    std::vector<CSharedNetMsg> vInvMessages;
+};
+
 /** Access to the MN database (mncache.dat)
  */
 class CMasternodeDB
@@ -96,6 +114,14 @@ private:
     // which Masternodes we've asked for
     std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
 
+    // bumped whenever an entry is added, removed, updated or enabled or disabled
+    std::atomic<uint64_t> nListVersion;
+    // reply to the last request for the whole list, rebuilt when it is older than nListVersion
+    std::shared_ptr<const CMasternodeListSnapshot> listSnapshot;
+    // framed broadcasts served to getdata, with the time of the ping they were framed with
+    RecursiveMutex cs_broadcastMessages;
+    std::map<uint256, std::pair<int64_t, CSharedNetMsg>> mapBroadcastMessages;
+
     // find an entry in the masternode list that is next to be paid (internally)
     CMasternode* GetNextMasternodeInQueueForPayment(
         const CBlockIndex* pindexPrev, bool fFilterSigTime, 
@@ -103,9 +129,9 @@ private:
         bool fJustCount);
 
 public:
-    // Keep track of all broadcasts I've seen
+    // Keep track of all broadcasts I've seen, protected by cs
     std::map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
+    // Keep track of all pings I've seen, protected by cs
     std::map<uint256, CMasternodePing> mapSeenMasternodePing;
 
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
@@ -171,6 +197,17 @@ public:
     /// Ask (source) node for mnb
     void AskForMN(CNode* pnode, const CTxIn& vin);
 
+    /// Access to the seen broadcasts and pings, which the message handler workers change concurrently
+    bool HaveSeenBroadcast(const uint256& hash);
+    bool HaveSeenPing(const uint256& hash);
+    bool GetSeenPing(const uint256& hash, CMasternodePing& mnp);
+    /// Remember a broadcast or ping, false if it was seen already
+    bool AddSeenBroadcast(const CMasternodeBroadcast& mnb);
+    bool AddSeenPing(const CMasternodePing& mnp);
+    void RemoveSeenBroadcast(const uint256& hash);
+    /// Relay a seen broadcast with a newer ping of its masternode
+    void UpdateSeenBroadcastPing(const uint256& hash, const CMasternodePing& mnp);
+
     /// Check all Masternodes
     void Check();
 
@@ -186,6 +223,16 @@ public:
 
     void DsegUpdate(CNode* pnode);
 
+    /// Mark the list as changed, so that the next request for it gets a fresh snapshot
+    void ListChanged() { ++nListVersion; }
+    uint64_t GetListVersion() const { return nListVersion; }
+
+    /// Reply to a request for the whole list, built at most once per version of the list
+    std::shared_ptr<const CMasternodeListSnapshot> GetListSnapshot();
+
+    /// Framed MNBROADCAST message of a seen broadcast, false if it is not known
+    bool GetBroadcastMessage(const uint256& hash, CSharedNetMsg& msg);
+
     /// Find an entry
     CMasternode* Find(const CScript& payee);
     CMasternode* Find(const CTxIn& vin);
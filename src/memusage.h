@@ -6,9 +6,13 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "prevector.h"
+#include "support/allocators/pool.h"
+
 #include <stdlib.h>
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <boost/unordered_map.hpp>
@@ -81,6 +85,15 @@ private:
     X x;
 };
 
+struct stl_shared_counter
+{
+    /* Various platforms use different sized counters here.
+     * Conservatively assume that they won't be larger than size_t. */
+    void* class_type;
+    size_t use_count;
+    size_t weak_count;
+};
+
 template<typename X>
 static inline size_t DynamicUsage(const std::vector<X>& v)
 {
@@ -159,6 +172,13 @@ static inline size_t RecursiveDynamicUsage(const std::pair<X, Y>& v)
     return RecursiveDynamicUsage(v.first) + RecursiveDynamicUsage(v.second);
 }
 
+template<typename X>
+static inline size_t DynamicUsage(const std::shared_ptr<X>& p)
+{
+    // Counted as made by std::make_shared, with the counter and the object in one allocation
+    return p ? MallocUsage(sizeof(stl_shared_counter) + sizeof(X)) : 0;
+}
+
 // Boost data structures
 
 template<typename X>
@@ -180,6 +200,17 @@ static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template<typename X, typename Y, typename Z, typename E, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z, E, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    // Nodes live in the pool chunks, which are counted whole whether in use or free,
+    // plus one std::list node (three pointers) per chunk. Only the bucket array is
+    // allocated on its own.
+    const auto* resource = m.get_allocator().resource();
+    const size_t nChunks = resource->NumAllocatedChunks();
+    return (MallocUsage(resource->ChunkSizeBytes()) + MallocUsage(sizeof(void*) * 3)) * nChunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 // Dispatch to class method as fallback
 
 template<typename X>
@@ -0,0 +1,111 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httprpc.h"
+
+#include "httpserver.h"
+#include "net.h"
+#include "protocol.h"
+#include "rpc/protocol.h"
+#include "tinyformat.h"
+
+#include <map>
+#include <sstream>
+
+/**
+ * Prometheus text exposition of the network message statistics, served on /metrics
+ * when -metrics is set. Per peer counters are summed over the connected peers.
+ */
+
+static const char* METRICS_PREFIX = "/metrics";
+
+static void WriteHistogram(std::ostringstream& ss, const std::string& strName, const std::string& strHelp,
+    const std::map<std::string, CMsgProcStats>& mapStats, const CLatencyHistogram CMsgProcStats::*member)
+{
+    ss << "# HELP " << strName << " " << strHelp << "\n";
+    ss << "# TYPE " << strName << " histogram\n";
+    for (const auto& entry : mapStats) {
+        const CLatencyHistogram& hist = entry.second.*member;
+        uint64_t nCumulative = 0;
+        for (size_t i = 0; i < MSG_LATENCY_BUCKETS_SIZE; i++) {
+            nCumulative += hist.vBuckets[i];
+            ss << strprintf("%s_bucket{command=\"%s\",le=\"%g\"} %u\n", strName, entry.first, MSG_LATENCY_BUCKETS[i] / 1e6, nCumulative);
+        }
+        ss << strprintf("%s_bucket{command=\"%s\",le=\"+Inf\"} %u\n", strName, entry.first, hist.nCount);
+        ss << strprintf("%s_sum{command=\"%s\"} %.6f\n", strName, entry.first, hist.nTotal / 1e6);
+        ss << strprintf("%s_count{command=\"%s\"} %u\n", strName, entry.first, hist.nCount);
+    }
+}
+
+static void WritePeerTotals(std::ostringstream& ss, const std::string& strName, const std::string& strHelp,
+    const std::vector<CNodeStats>& vstats, const mapMsgCmdSize CNodeStats::*sent, const mapMsgCmdSize CNodeStats::*recv, double dScale = 1)
+{
+    std::map<std::string, uint64_t> mapSent, mapRecv;
+    for (const CNodeStats& stats : vstats) {
+        for (const auto& entry : stats.*sent)
+            mapSent[entry.first] += entry.second;
+        if (recv) {
+            for (const auto& entry : stats.*recv)
+                mapRecv[entry.first] += entry.second;
+        }
+    }
+
+    ss << "# HELP " << strName << " " << strHelp << "\n";
+    ss << "# TYPE " << strName << " gauge\n";
+    const bool fDirection = recv != nullptr;
+    for (const auto& entry : mapSent) {
+        if (entry.second > 0)
+            ss << strprintf("%s{command=\"%s\"%s} %g\n", strName, entry.first, fDirection ? ",direction=\"sent\"" : "", entry.second * dScale);
+    }
+    for (const auto& entry : mapRecv) {
+        if (entry.second > 0)
+            ss << strprintf("%s{command=\"%s\",direction=\"recv\"} %g\n", strName, entry.first, entry.second * dScale);
+    }
+}
+
+static bool metrics_get(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\r\n");
+        return false;
+    }
+    if (!g_connman) {
+        req->WriteReply(HTTP_SERVICE_UNAVAILABLE, "Peer-to-peer functionality missing or disabled\r\n");
+        return false;
+    }
+
+    const std::map<std::string, CMsgProcStats> mapStats = g_connman->GetMessageProcessingStats();
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+
+    std::ostringstream ss;
+    WriteHistogram(ss, "owo_net_msg_wait_seconds", "Time network messages waited between receipt and the start of processing.", mapStats, &CMsgProcStats::wait);
+    WriteHistogram(ss, "owo_net_msg_process_seconds", "Time spent handling network messages.", mapStats, &CMsgProcStats::process);
+    WriteHistogram(ss, "owo_net_msg_cs_main_wait_seconds", "Time network message handlers spent blocked on cs_main.", mapStats, &CMsgProcStats::lockWait);
+    WritePeerTotals(ss, "owo_peer_msg_bytes", "Message bytes, summed over the connected peers.", vstats, &CNodeStats::mapSendBytesPerMsgCmd, &CNodeStats::mapRecvBytesPerMsgCmd);
+    WritePeerTotals(ss, "owo_peer_msg_count", "Message count, summed over the connected peers.", vstats, &CNodeStats::mapSendMsgsPerMsgCmd, &CNodeStats::mapRecvMsgsPerMsgCmd);
+    WritePeerTotals(ss, "owo_peer_msg_process_seconds", "Time spent handling messages, summed over the connected peers.", vstats, &CNodeStats::mapProcessTimePerMsgCmd, nullptr, 1e-6);
+    ss << "# HELP owo_peers Number of connected peers.\n";
+    ss << "# TYPE owo_peers gauge\n";
+    ss << "owo_peers " << vstats.size() << "\n";
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, ss.str());
+    return true;
+}
+
+bool StartMetrics()
+{
+    RegisterHTTPHandler(METRICS_PREFIX, true, metrics_get);
+    return true;
+}
+
+void InterruptMetrics()
+{
+}
+
+void StopMetrics()
+{
+    UnregisterHTTPHandler(METRICS_PREFIX, true);
+}
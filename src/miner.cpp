@@ -35,8 +35,10 @@
 #include "policy/policy.h"
 
 
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
 #include <boost/thread.hpp>
-#include <boost/tuple/tuple.hpp>
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -44,53 +46,9 @@
 // Miner
 //
 
-//
-// Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
-//
-class COrphan
-{
-public:
-    const CTransaction* ptx;
-    std::set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double dPriority;
-
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), dPriority(0)
-    {
-    }
-};
-
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockSize = 0;
 
-// We want to sort transactions by priority and fee rate, so:
-typedef boost::tuple<double, CFeeRate, const CTransaction*> TxPriority;
-class TxPriorityCompare
-{
-    bool byFee;
-
-public:
-    TxPriorityCompare(bool _byFee) : byFee(_byFee) {}
-
-    bool operator()(const TxPriority& a, const TxPriority& b)
-    {
-        if (byFee) {
-            if (a.get<1>() == b.get<1>())
-                return a.get<0>() < b.get<0>();
-            return a.get<1>() < b.get<1>();
-        } else {
-            if (a.get<0>() == b.get<0>())
-                return a.get<1>() < b.get<1>();
-            return a.get<0>() < b.get<0>();
-        }
-    }
-};
-
 void UpdateTime(CBlockHeader* pblock, const CBlockIndex* pindexPrev)
 {
     pblock->nTime = std::max(pindexPrev->GetMedianTimePast() + 1, GetAdjustedTime());
@@ -144,44 +102,374 @@ bool SolveProofOfStake(CBlock* pblock, CBlockIndex* pindexPrev, CWallet* pwallet
     return true;
 }
 
-CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool fProofOfStake, std::vector<COutput>* availableCoins)
+//
+// Block assembly works on packages: a memory pool transaction together with its
+// in-mempool ancestors that are not in the block yet, scored by their combined
+// modified fee rate. The mempool keeps that score current in its ancestor_score
+// index; once part of a package is in the block, the remaining descendants are
+// re-scored here in mapModifiedTx without the ancestors already included.
+//
+struct CTxMemPoolModifiedEntry {
+    explicit CTxMemPoolModifiedEntry(CTxMemPool::txiter entry) :
+        iter(entry),
+        nSizeWithAncestors(entry->GetSizeWithAncestors()),
+        nModFeesWithAncestors(entry->GetModFeesWithAncestors()),
+        nSigOpCountWithAncestors(entry->GetSigOpCountWithAncestors())
+    {
+    }
+
+    CTxMemPool::txiter iter;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+    unsigned int nSigOpCountWithAncestors;
+};
+
+// Same order as CompareTxMemPoolEntryByAncestorFee, on the modified package values
+struct CompareModifiedEntry {
+    bool operator()(const CTxMemPoolModifiedEntry& a, const CTxMemPoolModifiedEntry& b) const
+    {
+        double f1 = (double)a.nModFeesWithAncestors * b.nSizeWithAncestors;
+        double f2 = (double)b.nModFeesWithAncestors * a.nSizeWithAncestors;
+        if (f1 == f2) {
+            return CTxMemPool::CompareIteratorByHash()(a.iter, b.iter);
+        }
+        return f1 > f2;
+    }
+};
+
+struct modifiedentry_iter {
+    typedef CTxMemPool::txiter result_type;
+    result_type operator()(const CTxMemPoolModifiedEntry& entry) const
+    {
+        return entry.iter;
+    }
+};
+
+// A package sorted by number of in-mempool ancestors is in a valid block order
+struct CompareTxIterByAncestorCount {
+    bool operator()(const CTxMemPool::txiter& a, const CTxMemPool::txiter& b) const
+    {
+        if (a->GetCountWithAncestors() != b->GetCountWithAncestors())
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        return CTxMemPool::CompareIteratorByHash()(a, b);
+    }
+};
+
+typedef boost::multi_index_container<
+    CTxMemPoolModifiedEntry,
+    boost::multi_index::indexed_by<
+        boost::multi_index::ordered_unique<
+            modifiedentry_iter,
+            CTxMemPool::CompareIteratorByHash
+        >,
+        // sorted by modified ancestor fee rate
+        boost::multi_index::ordered_non_unique<
+            boost::multi_index::tag<ancestor_score>,
+            boost::multi_index::identity<CTxMemPoolModifiedEntry>,
+            CompareModifiedEntry
+        >
+    >
+> indexed_modified_transaction_set;
+
+typedef indexed_modified_transaction_set::nth_index<0>::type::iterator modtxiter;
+typedef indexed_modified_transaction_set::index<ancestor_score>::type::iterator modtxscoreiter;
+
+struct update_for_parent_inclusion {
+    explicit update_for_parent_inclusion(CTxMemPool::txiter it) : iter(it) {}
+
+    void operator()(CTxMemPoolModifiedEntry& e)
+    {
+        e.nModFeesWithAncestors -= iter->GetModifiedFee();
+        e.nSizeWithAncestors -= iter->GetTxSize();
+        e.nSigOpCountWithAncestors -= iter->GetSigOpCount();
+    }
+
+    CTxMemPool::txiter iter;
+};
+
+// Fills a CBlockTxSelection from the memory pool. Besides the block limits and
+// lock time finality, the inputs of every transaction are checked against the
+// coins view given, with the transactions selected before it applied, so that a
+// pool transaction whose inputs went missing never reaches the block.
+class CBlockTxSelector
 {
-    // Create new block
-    std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
-    if (!pblocktemplate.get()) return nullptr;
-    CBlock* pblock = &pblocktemplate->block; // pointer for convenience
+private:
+    const CTxMemPool& pool;
+    const int nHeight;
+    const int64_t nLockTimeCutoff;
+    const unsigned int nBlockMaxSize;
+    const bool fPrintPriority;
+    CBlockTxSelection& selection;
+    CTxMemPool::setEntries inBlock;
+    // the coins view with the selected transactions applied, null when inputs are not checked
+    std::unique_ptr<CCoinsViewCache> pview;
 
-    // Tip
-    CBlockIndex* pindexPrev = GetChainTip();
-    if (!pindexPrev) return nullptr;
-    const int nHeight = pindexPrev->nHeight + 1;
+public:
+    CBlockTxSelector(const CTxMemPool& poolIn, int nHeightIn, int64_t nLockTimeCutoffIn, unsigned int nBlockMaxSizeIn, CBlockTxSelection& selectionIn, CCoinsView* pcoinsIn) :
+        pool(poolIn),
+        nHeight(nHeightIn),
+        nLockTimeCutoff(nLockTimeCutoffIn),
+        nBlockMaxSize(nBlockMaxSizeIn),
+        fPrintPriority(GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY)),
+        selection(selectionIn),
+        pview(pcoinsIn ? new CCoinsViewCache(pcoinsIn) : nullptr)
+    {
+        // Room for the coinbase or coinstake
+        selection.nBlockSize = 1000;
+        selection.nBlockSigOps = 100;
+    }
 
-    // Make sure to create the correct block version
-    const Consensus::Params& consensus = Params().GetConsensus();
+    // Fills the -blockprioritysize area by coin age priority, parents first
+    void AddPriorityTxs(unsigned int nBlockPrioritySize)
+    {
+        if (nBlockPrioritySize == 0)
+            return;
 
-    if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_TIME_PROTOCOL_V2))
-        pblock->nVersion = 7;
-    else if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2))
-        pblock->nVersion = 6;
-    else if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_BIP65))
-        pblock->nVersion = 5;
-    else
-        pblock->nVersion = 3;
+        std::vector<TxCoinAgePriority> vecPriority;
+        std::map<CTxMemPool::txiter, double, CTxMemPool::CompareIteratorByHash> waitPriMap;
+        vecPriority.reserve(pool.mapTx.size());
+        for (CTxMemPool::indexed_transaction_set::const_iterator mi = pool.mapTx.begin(); mi != pool.mapTx.end(); ++mi) {
+            double dPriority = mi->GetPriority(nHeight);
+            CAmount dummy = 0;
+            pool.ApplyDeltas(mi->GetTx().GetHash(), dPriority, dummy);
+            vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
+        }
 
-    // -regtest only: allow overriding block.nVersion with
-    // -blockversion=N to test forking scenarios
-    if (Params().IsRegTestNet()) {
-        pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
+        TxCoinAgePriorityCompare comparer;
+        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        while (!vecPriority.empty()) {
+            CTxMemPool::txiter iter = vecPriority.front().second;
+            const double dPriority = vecPriority.front().first;
+            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            vecPriority.pop_back();
+
+            // Wait for the in-mempool parents
+            if (IsStillDependent(iter)) {
+                waitPriMap.insert(std::make_pair(iter, dPriority));
+                continue;
+            }
+            if (!TestForBlock(iter) || !TestInputs({iter}))
+                continue;
+
+            AddToBlock(iter);
+
+            // The priority area is done when full or once the free threshold is crossed
+            if (selection.nBlockSize >= nBlockPrioritySize || !AllowFree(dPriority))
+                return;
+
+            // Children waiting on this one can be tried again
+            for (const CTxMemPool::txiter& child : pool.GetMemPoolChildren(iter)) {
+                auto wpiter = waitPriMap.find(child);
+                if (wpiter != waitPriMap.end()) {
+                    vecPriority.push_back(TxCoinAgePriority(wpiter->second, child));
+                    std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                    waitPriMap.erase(wpiter);
+                }
+            }
+        }
     }
 
-    // Depending on the tip height, try to find a coinstake who solves the block or create a coinbase tx.
-    if (!(fProofOfStake ? SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins)
-                        : CreateCoinbaseTx(pblock, scriptPubKeyIn, pindexPrev))) {
-        return nullptr;
+    // Fills the rest of the block with packages by ancestor fee rate, so that a
+    // child paying for its parents gets them both in
+    void AddPackageTxs(unsigned int nBlockMinSize)
+    {
+        indexed_modified_transaction_set mapModifiedTx;
+        // Entries that did not fit, so their packages are not built twice
+        CTxMemPool::setEntries failedTx;
+
+        // Descendants of the priority area transactions are scored without them
+        UpdatePackagesForAdded(inBlock, mapModifiedTx);
+
+        const auto& byAncestorScore = pool.mapTx.get<ancestor_score>();
+        auto mi = byAncestorScore.begin();
+        while (mi != byAncestorScore.end() || !mapModifiedTx.empty()) {
+            // Skip mapTx entries that are in the block, re-scored or failed
+            if (mi != byAncestorScore.end() && SkipMapTxEntry(pool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
+                ++mi;
+                continue;
+            }
+
+            // Take the better of the next mapTx entry and the best modified entry
+            bool fUsingModified = false;
+            CTxMemPool::txiter iter;
+            modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
+            if (mi == byAncestorScore.end()) {
+                iter = modit->iter;
+                fUsingModified = true;
+            } else {
+                iter = pool.mapTx.project<0>(mi);
+                if (modit != mapModifiedTx.get<ancestor_score>().end() &&
+                    CompareModifiedEntry()(*modit, CTxMemPoolModifiedEntry(iter))) {
+                    iter = modit->iter;
+                    fUsingModified = true;
+                } else {
+                    ++mi;
+                }
+            }
+            assert(!inBlock.count(iter));
+
+            uint64_t nPackageSize = iter->GetSizeWithAncestors();
+            CAmount nPackageFees = iter->GetModFeesWithAncestors();
+            unsigned int nPackageSigOps = iter->GetSigOpCountWithAncestors();
+            if (fUsingModified) {
+                nPackageSize = modit->nSizeWithAncestors;
+                nPackageFees = modit->nModFeesWithAncestors;
+                nPackageSigOps = modit->nSigOpCountWithAncestors;
+            }
+
+            // Past the minimum block size, everything left pays less than the relay fee
+            if (nPackageFees < ::minRelayTxFee.GetFee(nPackageSize) && selection.nBlockSize >= nBlockMinSize)
+                return;
+
+            CTxMemPool::setEntries ancestors;
+            if (TestPackage(nPackageSize, nPackageSigOps)) {
+                const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+                std::string dummy;
+                pool.CalculateMemPoolAncestors(*iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+                for (const CTxMemPool::txiter& it : inBlock)
+                    ancestors.erase(it);
+                ancestors.insert(iter);
+            }
+            std::vector<CTxMemPool::txiter> vSorted(ancestors.begin(), ancestors.end());
+            std::sort(vSorted.begin(), vSorted.end(), CompareTxIterByAncestorCount());
+            if (ancestors.empty() || !TestPackageFinality(ancestors) || !TestInputs(vSorted)) {
+                // The best modified entry must go, or it would be picked again
+                if (fUsingModified) {
+                    mapModifiedTx.get<ancestor_score>().erase(modit);
+                    failedTx.insert(iter);
+                }
+                continue;
+            }
+
+            for (const CTxMemPool::txiter& it : vSorted) {
+                AddToBlock(it);
+                mapModifiedTx.erase(it);
+            }
+
+            UpdatePackagesForAdded(ancestors, mapModifiedTx);
+        }
     }
 
-    pblocktemplate->vTxFees.push_back(-1);   // updated at end
-    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
+private:
+    bool IsStillDependent(CTxMemPool::txiter iter) const
+    {
+        for (const CTxMemPool::txiter& parent : pool.GetMemPoolParents(iter)) {
+            if (!inBlock.count(parent))
+                return true;
+        }
+        return false;
+    }
+
+    bool TestForBlock(CTxMemPool::txiter iter) const
+    {
+        return TestPackage(iter->GetTxSize(), iter->GetSigOpCount()) &&
+               IsFinalTx(iter->GetTx(), nHeight, nLockTimeCutoff);
+    }
+
+    bool TestPackage(uint64_t nPackageSize, unsigned int nPackageSigOps) const
+    {
+        return selection.nBlockSize + nPackageSize < nBlockMaxSize &&
+               selection.nBlockSigOps + nPackageSigOps < MAX_BLOCK_SIGOPS_CURRENT;
+    }
+
+    bool TestPackageFinality(const CTxMemPool::setEntries& package) const
+    {
+        for (const CTxMemPool::txiter& it : package) {
+            if (!IsFinalTx(it->GetTx(), nHeight, nLockTimeCutoff))
+                return false;
+        }
+        return true;
+    }
+
+    // Whether the package, in block order, spends existing coins with valid scripts, as
+    // ConnectBlock will check. Applies it to the view when it does.
+    bool TestInputs(const std::vector<CTxMemPool::txiter>& package)
+    {
+        if (!pview)
+            return true;
+
+        CCoinsViewCache viewPackage(pview.get());
+        for (const CTxMemPool::txiter& it : package) {
+            const CTransaction& tx = it->GetTx();
+            if (!viewPackage.HaveInputs(tx))
+                return false;
+
+            // Note that flags: we don't want to set mempool/IsStandard()
+            // policy here, but we still have to ensure that the block we
+            // create only contains transactions that are valid in new blocks.
+            CValidationState state;
+            PrecomputedTransactionData precomTxData(tx);
+            if (!CheckInputs(tx, state, viewPackage, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, false, precomTxData)) {
+                LogPrintf("%s : skipping %s, %s\n", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+                return false;
+            }
+            UpdateCoins(tx, viewPackage, nHeight);
+        }
+        viewPackage.Flush();
+        return true;
+    }
+
+    bool SkipMapTxEntry(CTxMemPool::txiter it, const indexed_modified_transaction_set& mapModifiedTx, const CTxMemPool::setEntries& failedTx) const
+    {
+        return mapModifiedTx.count(it) || inBlock.count(it) || failedTx.count(it);
+    }
+
+    void AddToBlock(CTxMemPool::txiter iter)
+    {
+        selection.vtx.push_back(iter->GetTx());
+        selection.vTxFees.push_back(iter->GetFee());
+        selection.vTxSigOps.push_back(iter->GetSigOpCount());
+        selection.nBlockSize += iter->GetTxSize();
+        selection.nBlockSigOps += iter->GetSigOpCount();
+        selection.nFees += iter->GetFee();
+        inBlock.insert(iter);
+
+        if (fPrintPriority) {
+            LogPrintf("priority %.1f fee %s txid %s\n", iter->GetPriority(nHeight),
+                CFeeRate(iter->GetModifiedFee(), iter->GetTxSize()).ToString(), iter->GetTx().GetHash().ToString());
+        }
+    }
+
+    // Re-scores the not yet included descendants of the given, just included, entries
+    void UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx) const
+    {
+        for (const CTxMemPool::txiter& it : alreadyAdded) {
+            CTxMemPool::setEntries descendants;
+            pool.CalculateDescendants(it, descendants);
+            for (const CTxMemPool::txiter& desc : descendants) {
+                if (alreadyAdded.count(desc))
+                    continue;
+                modtxiter mit = mapModifiedTx.find(desc);
+                if (mit == mapModifiedTx.end()) {
+                    CTxMemPoolModifiedEntry modEntry(desc);
+                    modEntry.nSizeWithAncestors -= it->GetTxSize();
+                    modEntry.nModFeesWithAncestors -= it->GetModifiedFee();
+                    modEntry.nSigOpCountWithAncestors -= it->GetSigOpCount();
+                    mapModifiedTx.insert(modEntry);
+                } else {
+                    mapModifiedTx.modify(mit, update_for_parent_inclusion(it));
+                }
+            }
+        }
+    }
+};
+
+void SelectBlockTransactions(const CTxMemPool& pool, int nHeight, int64_t nLockTimeCutoff, unsigned int nBlockMaxSize,
+    unsigned int nBlockPrioritySize, unsigned int nBlockMinSize, CBlockTxSelection& selection, CCoinsView* pcoinsView)
+{
+    AssertLockHeld(pool.cs);
+    CBlockTxSelector selector(pool, nHeight, nLockTimeCutoff, nBlockMaxSize, selection, pcoinsView);
+    selector.AddPriorityTxs(nBlockPrioritySize);
+    selector.AddPackageTxs(nBlockMinSize);
+}
+
+// Selects the memory pool transactions for a block on top of pindexPrev with the
+// configured block size limits
+static void SelectBlockTransactions(const CBlockIndex* pindexPrev, CBlockTxSelection& selection)
+{
+    AssertLockHeld(cs_main);
+
+    const int nHeight = pindexPrev->nHeight + 1;
 
     // Largest block you're willing to create:
     unsigned int nBlockMaxSize = std::min((unsigned int)GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE), MAX_BLOCK_SIZE_CURRENT);
@@ -206,193 +494,178 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
     unsigned int nBlockMinSize = GetArg("-blockminsize", DEFAULT_BLOCK_MIN_SIZE);
     nBlockMinSize = std::min(nBlockMaxSize, nBlockMinSize);
 
-    // Collect memory pool transactions into the block
-    CAmount nFees = 0;
-
-    LOCK(cs_main);
-
-    {
-        LOCK(mempool.cs);
-
-        CCoinsViewCache view(pcoinsTip);
-
-        // Priority order to process transactions
-        std::list<COrphan> vOrphan; // list memory doesn't move
-        std::map<uint256, std::vector<COrphan*> > mapDependers;
-        bool fPrintPriority = GetBoolArg("-printpriority", DEFAULT_PRINTPRIORITY);
-
-        // This vector will be sorted into a priority queue:
-        std::vector<TxPriority> vecPriority;
-        vecPriority.reserve(mempool.mapTx.size());
-        for (CTxMemPool::indexed_transaction_set::iterator mi = mempool.mapTx.begin();
-             mi != mempool.mapTx.end(); ++mi) {
-            const CTransaction& tx = mi->GetTx();
-            if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight)){
-                continue;
-            }
-
-            COrphan* porphan = NULL;
-            double dPriority = 0;
-            CAmount nTotalIn = 0;
-            bool fMissingInputs = false;
-
-            for (const CTxIn& txin : tx.vin) {
-                // Read prev transaction
-                if (!view.HaveCoin(txin.prevout)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    if (!mempool.mapTx.count(txin.prevout.hash)) {
-                        LogPrintf("ERROR: mempool transaction missing input\n");
-                        fMissingInputs = true;
-                        if (porphan)
-                            vOrphan.pop_back();
-                        break;
-                    }
+    LOCK(mempool.cs);
+    SelectBlockTransactions(mempool, nHeight, GetAdjustedTime(), nBlockMaxSize, nBlockPrioritySize, nBlockMinSize, selection, pcoinsTip);
+}
 
-                    // Has to wait for dependencies
-                    if (!porphan) {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
-                    nTotalIn += mempool.mapTx.find(txin.prevout.hash)->GetTx().vout[txin.prevout.n].nValue;
-                    continue;
-                }
+// Transactions pre-selected for the next staked block by ThreadStakeTemplateBuilder
+struct CStakeTemplate {
+    uint256 hashPrevBlock;
+    unsigned int nTransactionsUpdated{0};
+    int64_t nTime{0};
+    CBlockTxSelection selection;
+};
 
-                const Coin& coin = view.AccessCoin(txin.prevout);
-                assert(!coin.IsSpent());
+static Mutex cs_stakeTemplate;
+static CStakeTemplate stakeTemplate GUARDED_BY(cs_stakeTemplate);
+static CStakeTemplateInfo stakeTemplateInfo GUARDED_BY(cs_stakeTemplate);
 
-                CAmount nValueIn = coin.out.nValue;
-                nTotalIn += nValueIn;
+// Re-selects the template transactions when the tip or the memory pool changed since the
+// last selection. The selection is the same work CreateNewBlock does, only off the path
+// between the kernel hit and the broadcast.
+static void RefreshStakeTemplate()
+{
+    CBlockIndex* pindexPrev = GetChainTip();
+    if (!pindexPrev || !Params().GetConsensus().NetworkUpgradeActive(pindexPrev->nHeight + 1, Consensus::UPGRADE_POS))
+        return;
 
-                int nConf = nHeight - coin.nHeight;
+    {
+        LOCK(cs_stakeTemplate);
+        if (stakeTemplate.hashPrevBlock == pindexPrev->GetBlockHash() &&
+            stakeTemplate.nTransactionsUpdated == mempool.GetTransactionsUpdated())
+            return;
+    }
 
-                dPriority = double_safe_addition(dPriority, ((double)nValueIn * nConf));
-            }
-            if (fMissingInputs) continue;
+    CStakeTemplate tmpl;
+    {
+        LOCK(cs_main);
+        if (pindexPrev != chainActive.Tip())
+            return;
+        tmpl.hashPrevBlock = pindexPrev->GetBlockHash();
+        tmpl.nTransactionsUpdated = mempool.GetTransactionsUpdated();
+        SelectBlockTransactions(pindexPrev, tmpl.selection);
+    }
+    tmpl.nTime = GetTime();
 
-            // Priority is sum(valuein * age) / modified_txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            dPriority = tx.ComputePriority(dPriority, nTxSize);
+    LOCK(cs_stakeTemplate);
+    stakeTemplate = std::move(tmpl);
+}
 
-            uint256 hash = tx.GetHash();
-            mempool.ApplyDeltas(hash, dPriority, nTotalIn);
+// Copies the template transactions into a staked block, if they were selected on its tip and
+// still fit it: the coinstake must not spend an input the template spends, and time locks are
+// checked again against the block time.
+static bool UseStakeTemplate(const CBlock* pblock, const CBlockIndex* pindexPrev, CBlockTxSelection& selection)
+{
+    const int nHeight = pindexPrev->nHeight + 1;
 
-            CFeeRate feeRate(nTotalIn - tx.GetValueOut(), nTxSize);
+    LOCK(cs_stakeTemplate);
+    if (stakeTemplate.hashPrevBlock != pindexPrev->GetBlockHash())
+        return false;
 
-            if (porphan) {
-                porphan->dPriority = dPriority;
-                porphan->feeRate = feeRate;
-            } else
-                vecPriority.push_back(TxPriority(dPriority, feeRate, &mi->GetTx()));
+    std::set<COutPoint> setStakeInputs;
+    for (const CTxIn& txin : pblock->vtx[1].vin)
+        setStakeInputs.insert(txin.prevout);
+    for (const CTransaction& tx : stakeTemplate.selection.vtx) {
+        if (!IsFinalTx(tx, nHeight, pblock->GetBlockTime()))
+            return false;
+        for (const CTxIn& txin : tx.vin) {
+            if (setStakeInputs.count(txin.prevout))
+                return false;
         }
+    }
 
-        // Collect transactions into block
-        uint64_t nBlockSize = 1000;
-        uint64_t nBlockTx = 0;
-        int nBlockSigOps = 100;
-        bool fSortedByFee = (nBlockPrioritySize <= 0);
-
-        TxPriorityCompare comparer(fSortedByFee);
-        std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-
-        while (!vecPriority.empty()) {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransaction& tx = *(vecPriority.front().get<2>());
-
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
+    selection = stakeTemplate.selection;
+    return true;
+}
 
-            // Size limits
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
-            if (nBlockSize + nTxSize >= nBlockMaxSize)
-                continue;
+static void InvalidateStakeTemplate()
+{
+    LOCK(cs_stakeTemplate);
+    stakeTemplate = CStakeTemplate();
+}
 
-            // Legacy limits on sigOps:
-            unsigned int nMaxBlockSigOps = MAX_BLOCK_SIGOPS_CURRENT;
-            unsigned int nTxSigOps = GetLegacySigOpCount(tx);
-            if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
+static void RecordStakeLatency(const CBlockTemplate& blocktemplate)
+{
+    const int64_t nLatency = GetTimeMicros() - blocktemplate.nTimeKernelFound;
+    LogPrint(BCLog::STAKING, "%s : kernel to broadcast %.3fms (%s)\n", __func__, nLatency / 1000.0,
+        blocktemplate.fStakeTemplate ? "template" : "full selection");
+
+    LOCK(cs_stakeTemplate);
+    stakeTemplateInfo.nLastLatency = nLatency;
+    stakeTemplateInfo.nTotalLatency += nLatency;
+    stakeTemplateInfo.nBlocks++;
+    if (blocktemplate.fStakeTemplate)
+        stakeTemplateInfo.nTemplateBlocks++;
+    stakeTemplateInfo.fLastFromTemplate = blocktemplate.fStakeTemplate;
+}
 
-            // Skip free transactions if we're past the minimum block size:
-            const uint256& hash = tx.GetHash();
-            double dPriorityDelta = 0;
-            CAmount nFeeDelta = 0;
-            mempool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
-            if (fSortedByFee && (dPriorityDelta <= 0) && (nFeeDelta <= 0) && (feeRate < ::minRelayTxFee) && (nBlockSize + nTxSize >= nBlockMinSize))
-                continue;
+CStakeTemplateInfo GetStakeTemplateInfo()
+{
+    LOCK(cs_stakeTemplate);
+    CStakeTemplateInfo info = stakeTemplateInfo;
+    info.hashTemplateTip = stakeTemplate.hashPrevBlock;
+    info.nTemplateTxs = stakeTemplate.selection.vtx.size();
+    info.nTemplateTime = stakeTemplate.nTime;
+    return info;
+}
 
-            // Prioritise by fee once past the priority size or we run out of high-priority
-            // transactions:
-            if (!fSortedByFee &&
-                ((nBlockSize + nTxSize >= nBlockPrioritySize) || !AllowFree(dPriority))) {
-                fSortedByFee = true;
-                comparer = TxPriorityCompare(fSortedByFee);
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            }
+CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool fProofOfStake, std::vector<COutput>* availableCoins)
+{
+    // Create new block
+    std::unique_ptr<CBlockTemplate> pblocktemplate(new CBlockTemplate());
+    if (!pblocktemplate.get()) return nullptr;
+    CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
-            if (!view.HaveInputs(tx))
-                continue;
+    // Tip
+    CBlockIndex* pindexPrev = GetChainTip();
+    if (!pindexPrev) return nullptr;
+    const int nHeight = pindexPrev->nHeight + 1;
 
-            CAmount nTxFees = view.GetValueIn(tx) - tx.GetValueOut();
+    // Make sure to create the correct block version
+    const Consensus::Params& consensus = Params().GetConsensus();
 
-            nTxSigOps += GetP2SHSigOpCount(tx, view);
-            if (nBlockSigOps + nTxSigOps >= nMaxBlockSigOps)
-                continue;
+    if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_TIME_PROTOCOL_V2))
+        pblock->nVersion = 7;
+    else if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2))
+        pblock->nVersion = 6;
+    else if (consensus.NetworkUpgradeActive(nHeight, Consensus::UPGRADE_BIP65))
+        pblock->nVersion = 5;
+    else
+        pblock->nVersion = 3;
 
-            // Note that flags: we don't want to set mempool/IsStandard()
-            // policy here, but we still have to ensure that the block we
-            // create only contains transactions that are valid in new blocks.
+    // -regtest only: allow overriding block.nVersion with
+    // -blockversion=N to test forking scenarios
+    if (Params().IsRegTestNet()) {
+        pblock->nVersion = GetArg("-blockversion", pblock->nVersion);
+    }
 
-            CValidationState state;
-            PrecomputedTransactionData precomTxData(tx);
-            if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, precomTxData))
-                continue;
+    // Depending on the tip height, try to find a coinstake who solves the block or create a coinbase tx.
+    if (!(fProofOfStake ? SolveProofOfStake(pblock, pindexPrev, pwallet, availableCoins)
+                        : CreateCoinbaseTx(pblock, scriptPubKeyIn, pindexPrev))) {
+        return nullptr;
+    }
 
-            UpdateCoins(tx, view, nHeight);
+    if (fProofOfStake)
+        pblocktemplate->nTimeKernelFound = GetTimeMicros();
 
-            // Added
-            pblock->vtx.push_back(tx);
-            pblocktemplate->vTxFees.push_back(nTxFees);
-            pblocktemplate->vTxSigOps.push_back(nTxSigOps);
-            nBlockSize += nTxSize;
-            ++nBlockTx;
-            nBlockSigOps += nTxSigOps;
-            nFees += nTxFees;
+    pblocktemplate->vTxFees.push_back(-1);   // updated at end
+    pblocktemplate->vTxSigOps.push_back(-1); // updated at end
 
-            if (fPrintPriority) {
-                LogPrintf("priority %.1f fee %s txid %s\n",
-                    dPriority, feeRate.ToString(), tx.GetHash().ToString());
-            }
+    LOCK(cs_main);
 
-            // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash)) {
-                for (COrphan* porphan : mapDependers[hash]) {
-                    if (!porphan->setDependsOn.empty()) {
-                        porphan->setDependsOn.erase(hash);
-                        if (porphan->setDependsOn.empty()) {
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
-                    }
-                }
-            }
-        }
+    {
+        // Collect memory pool transactions into the block. A staker takes the transactions
+        // the template builder selected on this tip, so that the selection is not redone
+        // between the kernel hit and the signature.
+        CBlockTxSelection selection;
+        if (fProofOfStake)
+            pblocktemplate->fStakeTemplate = UseStakeTemplate(pblock, pindexPrev, selection);
+        if (!pblocktemplate->fStakeTemplate)
+            SelectBlockTransactions(pindexPrev, selection);
+
+        pblock->vtx.insert(pblock->vtx.end(), selection.vtx.begin(), selection.vtx.end());
+        pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), selection.vTxFees.begin(), selection.vTxFees.end());
+        pblocktemplate->vTxSigOps.insert(pblocktemplate->vTxSigOps.end(), selection.vTxSigOps.begin(), selection.vTxSigOps.end());
 
         if (!fProofOfStake) {
             // Coinbase can get the fees.
-            pblock->vtx[0].vout[0].nValue += nFees;
-            pblocktemplate->vTxFees[0] = -nFees;
+            pblock->vtx[0].vout[0].nValue += selection.nFees;
+            pblocktemplate->vTxFees[0] = -selection.nFees;
         }
 
-        nLastBlockTx = nBlockTx;
-        nLastBlockSize = nBlockSize;
-        LogPrintf("%s : total size %u\n", __func__, nBlockSize);
+        nLastBlockTx = selection.vtx.size();
+        nLastBlockSize = selection.nBlockSize;
+        LogPrintf("%s : total size %u\n", __func__, selection.nBlockSize);
 
         // Fill in header
         pblock->hashPrevBlock = pindexPrev->GetBlockHash();
@@ -403,6 +676,17 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
 
         pblocktemplate->vTxSigOps[0] = GetLegacySigOpCount(pblock->vtx[0]);
 
+        // Check the block before a staked one is signed: template transactions were
+        // selected before this coinstake, and a signed invalid block must not be relayed.
+        CValidationState state;
+        if (!TestBlockValidity(state, *pblock, pindexPrev, false, false)) {
+            LogPrintf("CreateNewBlock() : TestBlockValidity failed\n");
+            if (pblocktemplate->fStakeTemplate)
+                InvalidateStakeTemplate();
+            mempool.clear();
+            return nullptr;
+        }
+
         if (fProofOfStake) {
             pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
             LogPrintf("CPUMiner : proof-of-stake block found %s \n", pblock->GetHash().GetHex());
@@ -413,13 +697,6 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet,
         }
     }
 
-    CValidationState state;
-    if (!TestBlockValidity(state, *pblock, pindexPrev, false, false)) {
-        LogPrintf("CreateNewBlock() : TestBlockValidity failed\n");
-        mempool.clear();
-        return nullptr;
-    }
-
     return pblocktemplate.release();
 }
 
@@ -658,8 +935,11 @@ void BitcoinMiner(CWallet* pwallet, bool fProofOfStake)
             SetThreadPriority(THREAD_PRIORITY_NORMAL);
             if (!ProcessBlockFound(pblock, *pwallet, opReservekey)) {
                 LogPrintf("%s: New block orphaned\n", __func__);
+                if (pblocktemplate->fStakeTemplate)
+                    InvalidateStakeTemplate();
                 continue;
             }
+            RecordStakeLatency(*pblocktemplate);
             SetThreadPriority(THREAD_PRIORITY_LOWEST);
             continue;
         }
@@ -795,4 +1075,24 @@ void ThreadStakeMinter()
     LogPrintf("ThreadStakeMinter exiting,\n");
 }
 
+void ThreadStakeTemplateBuilder()
+{
+    boost::this_thread::interruption_point();
+    LogPrintf("ThreadStakeTemplateBuilder started\n");
+    util::ThreadRename("pivx-stktmpl");
+    try {
+        while (true) {
+            // Only worth the cs_main time while the staker could use it
+            if (fStakingActive && pwalletMain && !pwalletMain->IsLocked() && !IsInitialBlockDownload())
+                RefreshStakeTemplate();
+            MilliSleep(STAKE_TEMPLATE_REFRESH_INTERVAL);
+        }
+    } catch (const boost::thread_interrupted&) {
+        // shutdown
+    } catch (const std::exception& e) {
+        LogPrintf("ThreadStakeTemplateBuilder() exception: %s\n", e.what());
+    }
+    LogPrintf("ThreadStakeTemplateBuilder exiting\n");
+}
+
 #endif // ENABLE_WALLET
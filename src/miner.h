@@ -15,15 +15,35 @@
 class CBlock;
 class CBlockHeader;
 class CBlockIndex;
+class CCoinsView;
 class COutput;
 class CReserveKey;
 class CScript;
+class CTxMemPool;
 class CWallet;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Milliseconds between checks of the stake template against the tip and the memory pool */
+static const int64_t STAKE_TEMPLATE_REFRESH_INTERVAL = 500;
 
 struct CBlockTemplate;
 
+/** Memory pool transactions selected for a new block, in block order */
+struct CBlockTxSelection {
+    std::vector<CTransaction> vtx;
+    std::vector<CAmount> vTxFees;
+    std::vector<int64_t> vTxSigOps;
+    CAmount nFees{0};
+    uint64_t nBlockSize{0};   // including the room kept for the coinbase or coinstake
+    unsigned int nBlockSigOps{0};
+};
+
+/** Select the transactions for a block at nHeight from pool: the -blockprioritysize area by
+ *  coin age priority, then packages of in-mempool ancestors by ancestor fee rate. Requires pool.cs.
+ *  When pcoinsView is given, transactions whose inputs are missing from it or fail their
+ *  scripts are left out; without it the pool is trusted, as in tests of the selection alone. */
+void SelectBlockTransactions(const CTxMemPool& pool, int nHeight, int64_t nLockTimeCutoff, unsigned int nBlockMaxSize,
+    unsigned int nBlockPrioritySize, unsigned int nBlockMinSize, CBlockTxSelection& selection, CCoinsView* pcoinsView = nullptr);
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn, CWallet* pwallet, bool fProofOfStake, std::vector<COutput>* availableCoins = nullptr);
 /** Modify the extranonce in a block */
@@ -39,6 +59,8 @@ void UpdateTime(CBlockHeader* block, const CBlockIndex* pindexPrev);
 
     void BitcoinMiner(CWallet* pwallet, bool fProofOfStake);
     void ThreadStakeMinter();
+    /** Keep the transactions of the next staked block selected as the memory pool changes */
+    void ThreadStakeTemplateBuilder();
 #endif // ENABLE_WALLET
 
 extern double dHashesPerSec;
@@ -48,8 +70,25 @@ struct CBlockTemplate {
     CBlock block;
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOps;
+    //! Proof of stake: when the kernel was found (micros), and whether the transactions came from the stake template
+    int64_t nTimeKernelFound{0};
+    bool fStakeTemplate{false};
 };
 
+/** Kernel to broadcast latency of the blocks staked since startup, and the current stake template */
+struct CStakeTemplateInfo {
+    int64_t nLastLatency{0};     // microseconds, last staked block
+    int64_t nTotalLatency{0};    // microseconds, all staked blocks
+    uint64_t nBlocks{0};
+    uint64_t nTemplateBlocks{0}; // staked blocks that used the template
+    bool fLastFromTemplate{false};
+    uint256 hashTemplateTip;
+    unsigned int nTemplateTxs{0};
+    int64_t nTemplateTime{0};
+};
+
+CStakeTemplateInfo GetStakeTemplateInfo();
+
 uint64_t GetNetworkHashPS();
 
 #endif // BITCOIN_MINER_H
@@ -90,6 +90,32 @@ static const bool DEFAULT_FORCEDNSSEED = true;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Backends the socket handler thread can use to wait for socket readiness */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0, // level triggered, limited to sockets below FD_SETSIZE
+    SOCKETEVENTS_POLL = 1,   // level triggered, no socket number limit
+    SOCKETEVENTS_EPOLL = 2,  // edge triggered, sockets are registered once
+};
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+/** Maximum time the socket handler waits for socket events before housekeeping (in milliseconds) */
+static const int SELECT_TIMEOUT_MILLISECONDS = 50;
+
+std::string SocketEventsModeToString(SocketEventsMode mode);
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& mode);
+/** Comma separated list of the socket events modes compiled in */
+std::string GetSupportedSocketEventsModes();
+
+/** Default number of message handler workers for masternode, spork, address and ping messages */
+static const int DEFAULT_MSGHANDLER_WORKERS = 2;
+/** Maximum number of message handler workers */
+static const int MAX_MSGHANDLER_WORKERS = 16;
+
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
@@ -109,6 +135,29 @@ class CTransaction;
 class CNodeStats;
 class CClientUIInterface;
 
+/** Upper bounds (in microseconds) of the message latency histogram buckets, followed by an unbounded one */
+static const int64_t MSG_LATENCY_BUCKETS[] = {100, 1000, 10000, 100000, 1000000, 10000000};
+static const size_t MSG_LATENCY_BUCKETS_SIZE = sizeof(MSG_LATENCY_BUCKETS) / sizeof(MSG_LATENCY_BUCKETS[0]);
+
+/** Latency histogram over MSG_LATENCY_BUCKETS */
+struct CLatencyHistogram
+{
+    uint64_t nCount = 0;
+    int64_t nTotal = 0; // microseconds
+    int64_t nMax = 0;
+    uint64_t vBuckets[MSG_LATENCY_BUCKETS_SIZE + 1] = {}; // per bucket, not cumulative
+
+    void Add(int64_t nMicros);
+};
+
+/** Per message type timings of the message handler threads */
+struct CMsgProcStats
+{
+    CLatencyHistogram wait;     // from the message's arrival until the start of its processing
+    CLatencyHistogram process;  // spent in the handler
+    CLatencyHistogram lockWait; // spent in the handler blocked on cs_main
+};
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -122,6 +171,17 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** Immutable, reference-counted chunk of a send queue. The same buffer can be queued for many peers. */
+typedef std::shared_ptr<const std::vector<unsigned char>> CSendBufferRef;
+
+/** A network message framed once (header and payload) that can be pushed to several peers without copying */
+struct CSharedNetMsg
+{
+    std::string command;
+    CSendBufferRef header;
+    CSendBufferRef data;
+};
+
 
 class CConnman
 {
@@ -145,6 +205,8 @@ public:
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
         unsigned int nReceiveFloodSize = 0;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+        int nMessageHandlerWorkers = 0;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -158,6 +220,8 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
+    static CSharedNetMsg MakeSharedMessage(CSerializedNetMsg&& msg);
 
     template<typename Callable>
     bool ForEachNodeContinueIf(Callable&& func)
@@ -277,6 +341,12 @@ public:
     CSipHasher GetDeterministicRandomizer(uint64_t id);
 
     unsigned int GetReceiveFloodSize() const;
+
+    SocketEventsMode GetSocketEventsMode() const { return nSocketEventsMode; }
+
+    int GetMessageHandlerWorkers() const { return nMessageHandlerWorkers; }
+    void RecordMessageProcessed(CNode* pnode, const std::string& strCommand, int64_t nWaitUsec, int64_t nProcessUsec, int64_t nLockWaitUsec);
+    std::map<std::string, CMsgProcStats> GetMessageProcessingStats();
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -289,7 +359,23 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections();
     void ThreadMessageHandler();
+    void ThreadMessageHandlerWorker();
+    bool IsNextMessageConcurrent(CNode* pnode);
     void AcceptConnection(const ListenSocket& hListenSocket);
+    void RegisterNodeSocket(CNode* pnode);
+    void DisconnectNodes();
+    void NotifyNumConnectionsChanged();
+    void InactivityCheck(CNode* pnode);
+    bool GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+    void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+    void SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+    void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -380,13 +466,30 @@ private:
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
+    /** Peers handed to the message handler workers, each one at most once (see CNode::fMsgProcClaimed) */
+    int nMessageHandlerWorkers;
+    std::deque<CNode*> vMsgProcWorkQueue;
+    std::condition_variable condMsgProcWorkers;
+    std::mutex mutexMsgProcWorkers;
+
+    std::map<std::string, CMsgProcStats> mapMsgProcStats;
+    RecursiveMutex cs_mapMsgProcStats;
+
     CThreadInterrupt interruptNet;
 
+    SocketEventsMode nSocketEventsMode;
+    /** epoll instance all sockets are registered with in SOCKETEVENTS_EPOLL mode */
+    int epollfd;
+    /** a node still has edge triggered readiness to act on, don't block waiting for new events */
+    bool fPendingSocketEvents;
+    unsigned int nPrevNodeCount;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlerWorkers;
 
     bool stopping = false;
 };
@@ -490,12 +593,18 @@ public:
     int nStartingHeight;
     uint64_t nSendBytes;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd;
     bool fWhitelisted;
     double dPingTime;
     double dPingWait;
     std::string addrLocal;
+    uint64_t nMNListRequests;
+    uint64_t nMNListRefused;
+    int64_t nLastMNListRequest;
 };
 
 
@@ -551,7 +660,7 @@ public:
     size_t nSendSize;   // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<CSendBufferRef> vSendMsg;
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -600,9 +709,17 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Readiness reported by edge triggered socket events, kept until the socket would block
+    bool fHasRecvData; // only used by the socket handler thread
+    bool fCanSendData; // protected by cs_vSend
+    // Set while a message handler worker owns this peer, the main message handler thread skips it meanwhile
+    std::atomic_bool fMsgProcClaimed;
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
+    mapMsgCmdSize mapSendMsgsPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvMsgsPerMsgCmd;
+    mapMsgCmdSize mapProcessTimePerMsgCmd; // microseconds spent handling, protected by cs_vProcessMsg
 
     std::vector<std::string> vecRequestsFulfilled; //keep track of what client has asked for
 
@@ -610,7 +727,13 @@ public:
     uint256 hashContinue;
     std::atomic<int> nStartingHeight;
 
-    // flood relay
+    // requests of the whole masternode list (dseg), those refused for coming too soon, and the last one
+    std::atomic<uint64_t> nMNListRequests;
+    std::atomic<uint64_t> nMNListRefused;
+    std::atomic<int64_t> nLastMNListRequest;
+
+    // flood relay, vAddrToSend and addrKnown are also written by other peers' handlers
+    RecursiveMutex cs_addrSend;
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -717,6 +840,7 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -725,6 +849,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrSend);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -90,6 +90,8 @@ public:
 
     // memory only
     mutable bool fChecked;
+    mutable bool fCheckedContextFree;
+    mutable bool fCheckedSignature;
 
     CBlock()
     {
@@ -117,6 +119,8 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        fCheckedContextFree = false;
+        fCheckedSignature = false;
         vchBlockSig.clear();
     }
 
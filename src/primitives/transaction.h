@@ -15,6 +15,7 @@
 #include "uint256.h"
 
 #include <list>
+#include <memory>
 
 class CTransaction;
 
@@ -342,4 +343,8 @@ struct CMutableTransaction
     std::string ToString() const;
 };
 
+/** Shared reference to an immutable transaction, for holders that would otherwise each keep a copy */
+typedef std::shared_ptr<const CTransaction> CTransactionRef;
+template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
@@ -120,6 +120,20 @@ const static std::string allNetMessageTypes[] = {
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes + ARRAYLEN(allNetMessageTypes));
 
+/** Message types whose handlers don't touch consensus state and take their own locks
+ *  (masternode list, sporks, addresses, pings) */
+const static std::string concurrentNetMessageTypes[] = {
+    NetMsgType::ADDR,
+    NetMsgType::GETADDR,
+    NetMsgType::PING,
+    NetMsgType::PONG,
+    NetMsgType::SPORK,
+    NetMsgType::GETSPORKS,
+    NetMsgType::MNBROADCAST,
+    NetMsgType::MNPING,
+    NetMsgType::GETMNLIST
+};
+
 CMessageHeader::CMessageHeader(const MessageStartChars& pchMessageStartIn)
 {
     memcpy(pchMessageStart, pchMessageStartIn, MESSAGE_START_SIZE);
@@ -245,3 +259,12 @@ const std::vector<std::string>& getAllNetMessageTypes()
 {
     return allNetMessageTypesVec;
 }
+
+bool IsConcurrentNetMessageType(const std::string& strCommand)
+{
+    for (const std::string& strType : concurrentNetMessageTypes) {
+        if (strType == strCommand)
+            return true;
+    }
+    return false;
+}
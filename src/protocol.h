@@ -280,6 +280,10 @@ extern const char* SYNCSTATUSCOUNT;
 /* Get a vector of all valid message types (see above) */
 const std::vector<std::string>& getAllNetMessageTypes();
 
+/* Whether a message type does not need the main (validation) message handler thread and
+ * may be handled by a message handler worker, see CConnman::ThreadMessageHandlerWorker */
+bool IsConcurrentNetMessageType(const std::string& strCommand);
+
 /** nServices flags */
 enum ServiceFlags : uint64_t {
     // Nothing
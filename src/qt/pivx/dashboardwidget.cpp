@@ -13,6 +13,7 @@
 #include "clientmodel.h"
 #include "optionsmodel.h"
 #include "utiltime.h"
+#include <limits>
 #include <vector>
 #include <QPainter>
 #include <QPainter>
@@ -217,12 +218,7 @@ void DashboardWidget::loadWalletModel()
         // Notification pop-up for new transaction
         connect(txModel, &TransactionTableModel::rowsInserted, this, &DashboardWidget::processNewTransaction);
 #ifdef USE_QTCHARTS
-        // chart filter
-        stakesFilter = new TransactionFilterProxy();
-        stakesFilter->setDynamicSortFilter(true);
-        stakesFilter->setOnlyStakesandMN(true);
-        stakesFilter->setSourceModel(txModel);
-        hasStakes = stakesFilter->rowCount() > 0;
+        hasStakes = walletModel->getStakeRewardCount() > 0;
 
         onHideChartsChanged(walletModel->getOptionsModel()->isHideCharts());
         connect(walletModel->getOptionsModel(), &OptionsModel::hideChartsChanged, this, &DashboardWidget::onHideChartsChanged);
@@ -239,7 +235,7 @@ void DashboardWidget::onTxArrived(const QString& hash, const bool& isCoinStake)
     if (isCoinStake) {
         // Update value if this is our first stake
         if (!hasStakes)
-            hasStakes = stakesFilter->rowCount() > 0;
+            hasStakes = walletModel->getStakeRewardCount() > 0;
         tryChartRefresh();
     }
 #endif
@@ -412,7 +408,7 @@ void DashboardWidget::loadChart()
 
 void DashboardWidget::showHideEmptyChart(bool showEmpty, bool loading, bool forceView)
 {
-    if (stakesFilter->rowCount() > SHOW_EMPTY_CHART_VIEW_THRESHOLD || forceView) {
+    if (walletModel->getStakeRewardCount() > SHOW_EMPTY_CHART_VIEW_THRESHOLD || forceView) {
         ui->layoutChart->setVisible(!showEmpty);
         ui->emptyContainerChart->setVisible(showEmpty);
     }
@@ -497,55 +493,36 @@ void DashboardWidget::changeChartColors()
     if (set1) set1->setBorderColor(backgroundColor);
 }
 
-void DashboardWidget::updateStakeFilter()
+// Local time range of the rewards shown in the chart, in seconds
+std::pair<int64_t, int64_t> DashboardWidget::getStakeRange() const
 {
-    if (chartShow != ALL) {
-        bool filterByMonth = false;
-        if (monthFilter != 0 && chartShow == MONTH) {
-            filterByMonth = true;
-        }
-        if (yearFilter != 0) {
-            if (filterByMonth) {
-                QDate monthFirst = QDate(yearFilter, monthFilter, 1);
-                stakesFilter->setDateRange(
-                        QDateTime(monthFirst),
-                        QDateTime(QDate(yearFilter, monthFilter, monthFirst.daysInMonth())).addDays(1).addMSecs(-1)
-                );
-            } else {
-                stakesFilter->setDateRange(
-                        QDateTime(QDate(yearFilter, 1, 1)),
-                        QDateTime(QDate(yearFilter, 12, 31)).addDays(1).addMSecs(-1)
-                );
-            }
-        } else if (filterByMonth) {
-            QDate currentDate = QDate::currentDate();
-            QDate monthFirst = QDate(currentDate.year(), monthFilter, 1);
-            stakesFilter->setDateRange(
-                    QDateTime(monthFirst),
-                    QDateTime(QDate(currentDate.year(), monthFilter, monthFirst.daysInMonth())).addDays(1).addMSecs(-1)
-            );
-            ui->comboBoxYears->setCurrentText(QString::number(currentDate.year()));
-        } else {
-            stakesFilter->clearDateRange();
-        }
+    if (chartShow == ALL)
+        return {0, std::numeric_limits<int64_t>::max()};
+
+    const bool filterByMonth = monthFilter != 0 && chartShow == MONTH;
+    if (yearFilter == 0 && !filterByMonth)
+        return {0, std::numeric_limits<int64_t>::max()};
+
+    const int year = yearFilter != 0 ? yearFilter : QDate::currentDate().year();
+    QDate first, end;
+    if (filterByMonth) {
+        first = QDate(year, monthFilter, 1);
+        end = first.addMonths(1);
     } else {
-        stakesFilter->clearDateRange();
+        first = QDate(year, 1, 1);
+        end = first.addYears(1);
     }
+    return {QDateTime(first).toMSecsSinceEpoch() / 1000, QDateTime(end).toMSecsSinceEpoch() / 1000};
 }
 
 // pair OWO
 const QMap<int, QMap<QString, qint64>> DashboardWidget::getAmountBy()
 {
-    updateStakeFilter();
-    const int size = stakesFilter->rowCount();
+    const std::pair<int64_t, int64_t> range = getStakeRange();
     QMap<int, QMap<QString, qint64>> amountBy;
-    // Get all of the stakes
-    for (int i = 0; i < size; ++i) {
-        QModelIndex modelIndex = stakesFilter->index(i, TransactionTableModel::ToAddress);
-        qint64 amount = llabs(modelIndex.data(TransactionTableModel::AmountRole).toLongLong());
-        QDate date = modelIndex.data(TransactionTableModel::DateRole).toDateTime().date();
-        bool isPiv = modelIndex.data(TransactionTableModel::TypeRole).toInt() == TransactionRecord::StakeMint;
-		bool isMN = modelIndex.data(TransactionTableModel::TypeRole).toInt() == TransactionRecord::MNReward;
+    // The wallet keeps the rewards summed in 15 minute buckets, add them up by local date
+    for (const CStakeRewardBucket& bucket : walletModel->getStakeRewardBuckets(range.first, range.second)) {
+        QDate date = QDateTime::fromMSecsSinceEpoch(bucket.nTime * 1000).date();
 
         int time = 0;
         switch (chartShow) {
@@ -565,23 +542,14 @@ const QMap<int, QMap<QString, qint64>> DashboardWidget::getAmountBy()
                 inform(tr("Error loading chart, invalid show option"));
                 return amountBy;
         }
-        if (amountBy.contains(time)) {
-            if (isPiv) {
-                amountBy[time]["piv"] += amount;
-            } else if (isMN) {
-                amountBy[time]["mn"] += amount;
-                hasMNRewards = true;
-            }
-        } else {
-            if (isPiv) {
-                amountBy[time]["piv"] = amount;
-                amountBy[time]["mn"] = 0;
-            } else if (isMN) {
-                amountBy[time]["piv"] = 0;
-                amountBy[time]["mn"] = amount;
-                hasMNRewards = true;
-            }
+        if (!amountBy.contains(time)) {
+            amountBy[time]["piv"] = 0;
+            amountBy[time]["mn"] = 0;
         }
+        amountBy[time]["piv"] += bucket.nStake;
+        amountBy[time]["mn"] += bucket.nMasternode;
+        if (bucket.nMasternode != 0)
+            hasMNRewards = true;
     }
     return amountBy;
 }
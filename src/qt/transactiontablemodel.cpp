@@ -21,6 +21,7 @@
 #include "wallet/wallet.h"
 
 #include <algorithm>
+#include <set>
 
 #include <QColor>
 #include <QDateTime>
@@ -86,10 +87,15 @@ public:
 
     /**
      * Time of the oldest transaction loaded into the model.
-     * It can or not be the first tx in the wallet, the model only loads the last 20k txs.
+     * It can or not be the first tx in the wallet, the model starts with the last 20k txs.
      */
     qint64 nFirstLoadedTxTime{0};
 
+    /* Older transactions not loaded into the model yet, by time and hash. fetchMore()
+     * loads them newest first.
+     */
+    std::set<std::pair<int64_t, uint256>> pendingTxes;
+
     /* Query entire wallet anew from core.
      */
     void refreshWallet()
@@ -103,25 +109,28 @@ public:
 
         std::vector<CWalletTx> walletTxes = wallet->getWalletTxs();
 
+        // Only decompose the latest ones, the rest are loaded page by page when the view
+        // scrolls down to them.
+        if (walletTxes.size() > (std::size_t)wallet->nLoadedRecordsMaxCount) {
+            // Sort the txs by date, the wallet map is ordered by hash.
+            sort(walletTxes.begin(), walletTxes.end(),
+                    [](const CWalletTx & a, const CWalletTx & b) -> bool {
+                     return a.GetTxTime() > b.GetTxTime();
+                 });
+
+            {
+                LOCK(cs_cachedWallet);
+                pendingTxes.clear();
+                for (auto it = walletTxes.begin() + wallet->nLoadedRecordsMaxCount; it != walletTxes.end(); ++it)
+                    pendingTxes.emplace(it->GetTxTime(), it->GetHash());
+            }
+            walletTxes.erase(walletTxes.begin() + wallet->nLoadedRecordsMaxCount, walletTxes.end());
+        }
+
         // Divide the work between multiple threads to speedup the process if the vector is larger than 4k txes
         std::size_t txesSize = walletTxes.size();
         if (txesSize > SINGLE_THREAD_MAX_TXES_SIZE) {
 
-            // First check if the amount of txs exceeds the UI limit
-            if (txesSize > wallet->nLoadedRecordsMaxCount) {
-                // Sort the txs by date just to be really really sure that them are ordered.
-                // (this extra calculation should be removed in the future if can ensure that
-                // txs are stored in order in the db, which is what should be happening)
-                sort(walletTxes.begin(), walletTxes.end(),
-                        [](const CWalletTx & a, const CWalletTx & b) -> bool {
-                         return a.GetTxTime() > b.GetTxTime();
-                     });
-
-                // Only latest ones.
-                walletTxes = std::vector<CWalletTx>(walletTxes.begin(), walletTxes.begin() + wallet->nLoadedRecordsMaxCount);
-                txesSize = walletTxes.size();
-            };
-
             // Simple way to get the processors count
             std::size_t threadsCount = (QThreadPool::globalInstance()->maxThreadCount() / 2 ) + 1;
 
@@ -262,10 +271,11 @@ public:
 
                     {
                         LOCK(cs_cachedWallet);
-                           
-                        // As old transactions are still getting updated (+20k range),
-                        // do not add them if we deliberately didn't load them at startup.
-                        if (cachedWallet.size() >= wallet->nLoadedRecordsMaxCount && wtx.GetTxTime() < nFirstLoadedTxTime) {
+
+                        // Transactions older than the loaded ones wait with the other pending
+                        // ones until the view scrolls down to them.
+                        if (!pendingTxes.empty() && wtx.GetTxTime() < nFirstLoadedTxTime) {
+                            pendingTxes.emplace(wtx.GetTxTime(), hash);
                             return;
                         }
                     }
@@ -316,6 +326,51 @@ public:
         return cachedWallet.size();
     }
 
+    bool canFetchMore()
+    {
+        LOCK(cs_cachedWallet);
+
+        return !pendingTxes.empty();
+    }
+
+    /* Load the next page of pending transactions into the model */
+    void fetchMore()
+    {
+        std::vector<std::pair<int64_t, uint256>> vPage;
+        {
+            LOCK(cs_cachedWallet);
+            while (!pendingTxes.empty() && vPage.size() < (std::size_t)TX_FETCH_PAGE_SIZE) {
+                auto it = std::prev(pendingTxes.end());
+                vPage.push_back(*it);
+                pendingTxes.erase(it);
+            }
+        }
+        if (vPage.empty())
+            return;
+
+        QList<TransactionRecord> toInsert;
+        {
+            LOCK2(cs_main, wallet->cs_wallet);
+            for (const auto& pending : vPage) {
+                auto mi = wallet->mapWallet.find(pending.second);
+                // erased since the model was loaded
+                if (mi == wallet->mapWallet.end())
+                    continue;
+                toInsert.append(TransactionRecord::decomposeTransaction(wallet, mi->second));
+            }
+        }
+
+        LOCK(cs_cachedWallet);
+        nFirstLoadedTxTime = vPage.back().first;
+        for (const TransactionRecord& rec : toInsert) {
+            // keep the records of one transaction in decomposition order
+            int insertIdx = std::upper_bound(cachedWallet.begin(), cachedWallet.end(), rec.hash, TxLessThan()) - cachedWallet.begin();
+            parent->beginInsertRows(QModelIndex(), insertIdx, insertIdx);
+            cachedWallet.insert(insertIdx, rec);
+            parent->endInsertRows();
+        }
+    }
+
 
     TransactionRecord* index(int idx)
     {
@@ -408,6 +463,17 @@ int TransactionTableModel::rowCount(const QModelIndex& parent) const
     return priv->size();
 }
 
+bool TransactionTableModel::canFetchMore(const QModelIndex& parent) const
+{
+    return !parent.isValid() && priv->canFetchMore();
+}
+
+void TransactionTableModel::fetchMore(const QModelIndex& parent)
+{
+    if (!parent.isValid())
+        priv->fetchMore();
+}
+
 int TransactionTableModel::columnCount(const QModelIndex& parent) const
 {
     Q_UNUSED(parent);
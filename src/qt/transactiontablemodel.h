@@ -13,6 +13,8 @@
 #include <QStringList>
 
 #define SINGLE_THREAD_MAX_TXES_SIZE 4000
+/* Transactions loaded at a time once the view scrolls past the ones loaded at startup */
+#define TX_FETCH_PAGE_SIZE 1000
 
 class TransactionRecord;
 class TransactionTablePriv;
@@ -72,6 +74,9 @@ public:
     };
 
     int rowCount(const QModelIndex& parent) const;
+    /** Older transactions are loaded a page at a time as the view scrolls down */
+    bool canFetchMore(const QModelIndex& parent) const;
+    void fetchMore(const QModelIndex& parent);
     int columnCount(const QModelIndex& parent) const;
     int size() const;
     QVariant data(const QModelIndex& index, int role) const;
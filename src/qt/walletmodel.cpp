@@ -685,6 +685,16 @@ int64_t WalletModel::getCreationTime() const {
     return wallet->nTimeFirstKey;
 }
 
+std::vector<CStakeRewardBucket> WalletModel::getStakeRewardBuckets(int64_t nTimeFrom, int64_t nTimeTo) const
+{
+    return wallet->stakeRewards.GetBuckets(nTimeFrom, nTimeTo);
+}
+
+size_t WalletModel::getStakeRewardCount() const
+{
+    return wallet->stakeRewards.Size();
+}
+
 int64_t WalletModel::getKeyCreationTime(const CPubKey& key)
 {
     return pwalletMain->GetKeyCreationTime(key);
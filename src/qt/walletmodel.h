@@ -224,6 +224,9 @@ public:
 
     bool getPubKey(const CKeyID& address, CPubKey& vchPubKeyOut) const;
     int64_t getCreationTime() const;
+    /** Stake and masternode reward totals of the 15 minute buckets starting in [nTimeFrom, nTimeTo) */
+    std::vector<CStakeRewardBucket> getStakeRewardBuckets(int64_t nTimeFrom, int64_t nTimeTo) const;
+    size_t getStakeRewardCount() const;
     int64_t getKeyCreationTime(const CPubKey& key);
     int64_t getKeyCreationTime(const CTxDestination& address);
     PairResult getNewAddress(Destination& ret, std::string label = "") const;
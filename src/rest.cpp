@@ -6,9 +6,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "chainsnapshot.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
+#include "httprpc.h"
 #include "httpserver.h"
 #include "rpc/server.h"
 #include "streams.h"
@@ -24,6 +26,7 @@
 
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const long MAX_REST_BLOCK_RANGE = 1000; //allow a max of 1000 blocks to be fetched at once
 
 enum RetFormat {
     RF_UNDEF,
@@ -63,8 +66,8 @@ struct CCoin {
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern void blockToJSON(JSONStreamWriter& stream, const CBlock& block, const CBlockIndex* blockindex, bool txDetails);
 extern UniValue mempoolInfoToJSON();
-extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
@@ -120,6 +123,14 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/** Add the block stored at pos to the reply, sent from the block file as it is */
+static bool AddStoredBlockToReply(HTTPRequest* req, const CDiskBlockPos& pos)
+{
+    unsigned int nSize;
+    return ReadBlockSizeFromDisk(nSize, pos) &&
+           req->AddReplyFile(GetBlockPosFilename(pos, "blk"), pos.nPos, nSize);
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -208,44 +219,144 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
     CBlockIndex* pblockindex = NULL;
+    CDiskBlockPos pos;
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
-        pblockindex = mapBlockIndex[hash];
         if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
+        pos = pblockindex->GetBlockPos();
+    }
+
+    // The block files hold blocks in their network serialization, the binary and hex
+    // formats are served from the stored bytes
+    switch (rf) {
+    case RF_BINARY: {
+        if (!AddStoredBlockToReply(req, pos))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK);
+        return true;
+    }
+
+    case RF_HEX: {
+        std::vector<unsigned char> vchBlock;
+        if (!ReadRawBlockFromDisk(vchBlock, pos))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        std::string strHex = HexStr(vchBlock) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
 
+    case RF_JSON: {
+        CBlock block;
         if (!ReadBlockFromDisk(block, pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        HTTPJSONReply reply(req);
+        blockToJSON(reply.Stream(), block, pblockindex, showTxDetails);
+        reply.Stream().Raw("\n");
+        reply.Finish();
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_blocks(HTTPRequest* req,
+                        const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::vector<std::string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/blocks/<count>/<height>.<ext>.");
+
+    long count = strtol(path[0].c_str(), NULL, 10);
+    if (count < 1 || count > MAX_REST_BLOCK_RANGE)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + path[0]);
+
+    int nHeight;
+    if (!ParseInt32(path[1], &nHeight) || nHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + path[1]);
+
+    // The blocks of the published chain are stored for good, their positions don't change
+    const CChainSnapshotRef chain = GetChainSnapshot();
+    if (nHeight > chain->Height())
+        return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range: " + path[1]);
+
+    std::vector<const CBlockIndex*> blocks;
+    for (int h = nHeight; h <= chain->Height() && (long)blocks.size() < count; h++) {
+        const CBlockIndex* pindex = (*chain)[h];
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nTx > 0)
+            return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+        blocks.push_back(pindex);
+    }
 
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        for (const CBlockIndex* pindex : blocks) {
+            if (!AddStoredBlockToReply(req, pindex->GetBlockPos()))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+        }
         req->WriteHeader("Content-Type", "application/octet-stream");
-        req->WriteReply(HTTP_OK, binaryBlock);
+        req->WriteReply(HTTP_OK);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
-        req->WriteHeader("Content-Type", "text/plain");
-        req->WriteReply(HTTP_OK, strHex);
+        // One chunk per block, so only one block is held here at a time
+        std::vector<unsigned char> vchBlock;
+        for (const CBlockIndex* pindex : blocks) {
+            if (!ReadRawBlockFromDisk(vchBlock, pindex->GetBlockPos())) {
+                if (req->IsChunked()) {
+                    LogPrintf("%s: reply to %s cut short\n", __func__, req->GetURI());
+                    req->EndChunkedReply();
+                    return false;
+                }
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            }
+            if (!req->IsChunked()) {
+                req->WriteHeader("Content-Type", "text/plain");
+                req->StartChunkedReply(HTTP_OK);
+            }
+            req->WriteReplyChunk(HexStr(vchBlock) + "\n");
+        }
+        req->EndChunkedReply();
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPJSONReply reply(req);
+        reply.Stream().BeginArray();
+        for (const CBlockIndex* pindex : blocks) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex)) {
+                if (reply.Started()) {
+                    reply.Abort();
+                    return false;
+                }
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not found");
+            }
+            blockToJSON(reply.Stream(), block, pindex, false);
+        }
+        reply.Stream().EndArray();
+        reply.Stream().Raw("\n");
+        reply.Finish();
         return true;
     }
 
@@ -328,11 +439,10 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        std::string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPJSONReply reply(req);
+        mempoolToJSON(true, &reply.Stream());
+        reply.Stream().Raw("\n");
+        reply.Finish();
         return true;
     }
     default: {
@@ -358,11 +468,22 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
 
     CTransaction tx;
     uint256 hashBlock = uint256();
-    if (!GetTransaction(hash, tx, hashBlock, true))
-        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
-
     CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
-    ssTx << tx;
+    if (rf == RF_BINARY || rf == RF_HEX) {
+        std::vector<unsigned char> vchTx;
+        if (mempool.lookup(hash, tx)) {
+            ssTx << tx;
+        } else if (ReadRawTransactionFromDisk(hash, vchTx, hashBlock)) {
+            // the transactions of the index are served as stored in the block files
+            ssTx.write((const char*)vchTx.data(), vchTx.size());
+        } else if (GetTransaction(hash, tx, hashBlock, true)) {
+            ssTx << tx;
+        } else {
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
+    } else if (!GetTransaction(hash, tx, hashBlock, true)) {
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+    }
 
     switch (rf) {
     case RF_BINARY: {
@@ -590,6 +711,7 @@ static const struct {
       {"/rest/tx/", rest_tx},
       {"/rest/block/notxdetails/", rest_block_notxdetails},
       {"/rest/block/", rest_block_extended},
+      {"/rest/blocks/", rest_blocks},
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
@@ -277,7 +277,7 @@ bool CRewards::ConnectBlock(const CBlockIndex* pindex, CAmount nSubsidy)
 
             // calculate the current circulating supply
             CAmount nCirculatingSupply = 0;
-            FlushStateToDisk();
+            FlushStateToDiskAsync();
             std::unique_ptr<CCoinsViewCursor> pcursor(pcoinsTip->Cursor());
 
             while (pcursor->Valid()) {
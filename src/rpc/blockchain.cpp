@@ -7,6 +7,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "chainsnapshot.h"
 #include "checkpoints.h"
 #include "clientversion.h"
 #include "consensus/upgrades.h"
@@ -15,6 +16,7 @@
 #include "masternode-sync.h"
 #include "policy/policy.h"
 #include "rpc/server.h"
+#include "spentindex.h"
 #include "sync.h"
 #include "txdb.h"
 #include "util.h"
@@ -77,12 +79,13 @@ double GetDifficulty(const CBlockIndex* blockindex)
 
 UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 {
+    const CChainSnapshotRef chain = GetChainSnapshot();
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain->Contains(blockindex))
+        confirmations = chain->Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", blockindex->nVersion));
@@ -97,67 +100,97 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain->Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+/** The fields of blockToJSON that come before its transaction list (head) and after it (tail) */
+static void BlockToJSONFields(const CBlock& block, const CBlockIndex* blockindex, UniValue& head, UniValue& tail)
 {
-    UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", block.GetHash().GetHex()));
+    const CChainSnapshotRef chain = GetChainSnapshot();
+    head.setObject();
+    head.push_back(Pair("hash", block.GetHash().GetHex()));
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.push_back(Pair("confirmations", confirmations));
-    result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
-    result.push_back(Pair("height", blockindex->nHeight));
-    result.push_back(Pair("version", block.nVersion));
-    result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("acc_checkpoint", block.nAccumulatorCheckpoint.GetHex()));
-    UniValue txs(UniValue::VARR);
-    for (const CTransaction& tx : block.vtx) {
-        if (txDetails) {
-            UniValue objTx(UniValue::VOBJ);
-            TxToJSON(tx, UINT256_ZERO, objTx);
-            txs.push_back(objTx);
-        } else
-            txs.push_back(tx.GetHash().GetHex());
-    }
-    result.push_back(Pair("tx", txs));
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
+    if (chain->Contains(blockindex))
+        confirmations = chain->Height() - blockindex->nHeight + 1;
+    head.push_back(Pair("confirmations", confirmations));
+    head.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
+    head.push_back(Pair("height", blockindex->nHeight));
+    head.push_back(Pair("version", block.nVersion));
+    head.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
+    head.push_back(Pair("acc_checkpoint", block.nAccumulatorCheckpoint.GetHex()));
+
+    tail.setObject();
+    tail.push_back(Pair("time", block.GetBlockTime()));
+    tail.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
+    tail.push_back(Pair("nonce", (uint64_t)block.nNonce));
+    tail.push_back(Pair("bits", strprintf("%08x", block.nBits)));
+    tail.push_back(Pair("difficulty", GetDifficulty(blockindex)));
+    tail.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
 
     if (blockindex->pprev)
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex* pnext = chainActive.Next(blockindex);
+        tail.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
+    CBlockIndex* pnext = chain->Next(blockindex);
     if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
+        tail.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
 
     //////////
     ////////// Coin stake data ////////////////
     /////////
     if (block.IsProofOfStake()) {
         uint256 hashProofOfStakeRet;
-        if (!GetStakeKernelHash(hashProofOfStakeRet, block, blockindex->pprev))
+        // the stake input is located through the active chain
+        if (!WITH_LOCK(cs_main, return GetStakeKernelHash(hashProofOfStakeRet, block, blockindex->pprev)))
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Cannot get proof of stake hash");
 
         std::string stakeModifier = (Params().GetConsensus().NetworkUpgradeActive(blockindex->nHeight, Consensus::UPGRADE_STAKE_MODIFIER_V2) ?
                                      blockindex->GetStakeModifierV2().GetHex() :
                                      strprintf("%016x", blockindex->GetStakeModifierV1()));
-        result.push_back(Pair("stakeModifier", stakeModifier));
-        result.push_back(Pair("hashProofOfStake", hashProofOfStakeRet.GetHex()));
+        tail.push_back(Pair("stakeModifier", stakeModifier));
+        tail.push_back(Pair("hashProofOfStake", hashProofOfStakeRet.GetHex()));
     }
+}
+
+static UniValue BlockTxToJSON(const CTransaction& tx, bool txDetails)
+{
+    if (!txDetails)
+        return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToJSON(tx, UINT256_ZERO, objTx);
+    return objTx;
+}
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+{
+    UniValue result, tail;
+    BlockToJSONFields(block, blockindex, result, tail);
+    UniValue txs(UniValue::VARR);
+    for (const CTransaction& tx : block.vtx)
+        txs.push_back(BlockTxToJSON(tx, txDetails));
+    result.push_back(Pair("tx", txs));
+    result.pushKVs(tail);
     return result;
 }
 
+/** Write blockToJSON(block, blockindex, txDetails) to stream, one transaction at a time */
+void blockToJSON(JSONStreamWriter& stream, const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+{
+    UniValue head, tail;
+    BlockToJSONFields(block, blockindex, head, tail);
+    stream.BeginObject();
+    stream.KeyValues(head);
+    stream.Key("tx");
+    stream.BeginArray();
+    for (const CTransaction& tx : block.vtx)
+        stream.Value(BlockTxToJSON(tx, txDetails));
+    stream.EndArray();
+    stream.KeyValues(tail);
+    stream.EndObject();
+}
+
 UniValue getblockcount(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -171,8 +204,7 @@ UniValue getblockcount(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockcount", "") + HelpExampleRpc("getblockcount", ""));
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot()->Height();
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -188,8 +220,7 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             "\nExamples\n" +
             HelpExampleCli("getbestblockhash", "") + HelpExampleRpc("getbestblockhash", ""));
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainSnapshot()->Tip()->GetBlockHash().GetHex();
 }
 
 void RPCNotifyBlockChange(bool fInitialDownload, const CBlockIndex* pindex)
@@ -351,11 +382,11 @@ UniValue getdifficulty(const JSONRPCRequest& request)
 }
 
 
-UniValue mempoolToJSON(bool fVerbose = false)
+UniValue mempoolToJSON(bool fVerbose, JSONStreamWriter* pstream)
 {
     if (fVerbose) {
         LOCK(mempool.cs);
-        UniValue o(UniValue::VOBJ);
+        JSONResultStream o(pstream, UniValue::VOBJ);
         for (const CTxMemPoolEntry& e : mempool.mapTx) {
             const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
@@ -382,18 +413,18 @@ UniValue mempoolToJSON(bool fVerbose = false)
             }
 
             info.push_back(Pair("depends", depends));
-            o.push_back(Pair(hash.ToString(), info));
+            o.pushKV(hash.ToString(), info);
         }
-        return o;
+        return o.Finish();
     } else {
         std::vector<uint256> vtxid;
         mempool.queryHashes(vtxid);
 
-        UniValue a(UniValue::VARR);
+        JSONResultStream a(pstream, UniValue::VARR);
         for (const uint256& hash : vtxid)
             a.push_back(hash.ToString());
 
-        return a;
+        return a.Finish();
     }
 }
 
@@ -441,7 +472,7 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     if (request.params.size() > 0)
         fVerbose = request.params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    return mempoolToJSON(fVerbose, request.pstream);
 }
 
 UniValue getblockhash(const JSONRPCRequest& request)
@@ -460,13 +491,13 @@ UniValue getblockhash(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("getblockhash", "1000") + HelpExampleRpc("getblockhash", "1000"));
 
-    LOCK(cs_main);
+    const CChainSnapshotRef chain = GetChainSnapshot();
 
     int nHeight = request.params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > chain->Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    CBlockIndex* pblockindex = (*chain)[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -513,8 +544,6 @@ UniValue getblock(const JSONRPCRequest& request)
             HelpExampleCli("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\"") +
             HelpExampleRpc("getblock", "\"00000000000fd08c2fb661d2fcb0d49abb3a91e5f27082ce64feed3b4dede2e2\""));
 
-    LOCK(cs_main);
-
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -522,12 +551,15 @@ UniValue getblock(const JSONRPCRequest& request)
     if (request.params.size() > 1)
         fVerbose = request.params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // A block of the published chain is stored and settled. One off it may still be in the
+    // middle of being received or validated, so read it under cs_main.
+    LOCK(GetChainSnapshot()->Contains(pblockindex) ? nullptr : &cs_main);
 
+    CBlock block;
     if (!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
@@ -578,10 +610,11 @@ UniValue getblockheader(const JSONRPCRequest& request)
     if (request.params.size() > 1)
         fVerbose = request.params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
+    CBlockIndex* pblockindex = LookupBlockIndex(hash);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    LOCK(GetChainSnapshot()->Contains(pblockindex) ? nullptr : &cs_main);
 
     if (!fVerbose) {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
@@ -737,7 +770,7 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     UniValue ret(UniValue::VOBJ);
 
     CCoinsStats stats;
-    FlushStateToDisk();
+    FlushStateToDiskAsync();
     if (GetUTXOStats(pcoinsTip, stats)) {
         ret.push_back(Pair("height", (int64_t)stats.nHeight));
         ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
@@ -750,6 +783,118 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue DBStatsToJSON(const CDBWrapper& db)
+{
+    const CDBStats stats = db.GetStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("reads", stats.nReads));
+    obj.push_back(Pair("read_bytes", stats.nReadBytes));
+    obj.push_back(Pair("write_batches", stats.nWriteBatches));
+    obj.push_back(Pair("write_bytes", stats.nWriteBytes));
+    obj.push_back(Pair("compacting", stats.fCompacting));
+    if (stats.fCompacting)
+        obj.push_back(Pair("compaction_elapsed_ms", GetTimeMillis() - stats.nCompactionStart));
+    if (stats.nLastCompactionEnd > 0) {
+        obj.push_back(Pair("last_compaction_time", stats.nLastCompactionEnd / 1000));
+        obj.push_back(Pair("last_compaction_ms", stats.nLastCompactionDuration));
+    }
+    UniValue levels(UniValue::VARR);
+    for (const CDBLevelStats& level : stats.vLevels) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("level", level.nLevel));
+        entry.push_back(Pair("files", level.nFiles));
+        entry.push_back(Pair("size_mb", UniValue(level.dSizeMB)));
+        entry.push_back(Pair("compaction_sec", UniValue(level.dTimeSec)));
+        entry.push_back(Pair("compaction_read_mb", UniValue(level.dReadMB)));
+        entry.push_back(Pair("compaction_write_mb", UniValue(level.dWriteMB)));
+        levels.push_back(entry);
+    }
+    obj.push_back(Pair("levels", levels));
+    return obj;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getdbstats ( \"name\" )\n"
+            "\nReturns LevelDB activity and compaction statistics of the open databases.\n"
+
+            "\nArguments:\n"
+            "1. \"name\"     (string, optional) Only this database: blockindex, chainstate or sporks\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": {                      (json object) one entry per database\n"
+            "    \"reads\": n,                  (numeric) Point reads since startup\n"
+            "    \"read_bytes\": n,             (numeric) Bytes returned by point reads\n"
+            "    \"write_batches\": n,          (numeric) Write batches since startup\n"
+            "    \"write_bytes\": n,            (numeric) Approximate bytes written\n"
+            "    \"compacting\": true|false,    (boolean) Whether a manual compaction is running\n"
+            "    \"compaction_elapsed_ms\": n,  (numeric, optional) Time spent in the running compaction\n"
+            "    \"last_compaction_time\": n,   (numeric, optional) End of the last manual compaction, in seconds since epoch\n"
+            "    \"last_compaction_ms\": n,     (numeric, optional) Duration of the last manual compaction\n"
+            "    \"levels\": [                  (array) LevelDB levels that hold data\n"
+            "      {\n"
+            "        \"level\": n,              (numeric) Level number\n"
+            "        \"files\": n,              (numeric) Table files in the level\n"
+            "        \"size_mb\": x.xxx,        (numeric) Size of the level\n"
+            "        \"compaction_sec\": x.xxx, (numeric) Time spent compacting into the level\n"
+            "        \"compaction_read_mb\": x.xxx,  (numeric) Data read by those compactions\n"
+            "        \"compaction_write_mb\": x.xxx  (numeric) Data written by those compactions\n"
+            "      }, ...\n"
+            "    ]\n"
+            "  }, ...\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getdbstats", "") + HelpExampleCli("getdbstats", "\"chainstate\"") + HelpExampleRpc("getdbstats", "\"chainstate\""));
+
+    std::vector<std::string> vNames;
+    if (request.params.size() > 0)
+        vNames.push_back(request.params[0].get_str());
+    else
+        vNames = ListDBWrappers();
+
+    UniValue ret(UniValue::VOBJ);
+    for (const std::string& strName : vNames) {
+        const CDBWrapper* pdb = FindDBWrapper(strName);
+        if (!pdb)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown database: " + strName);
+        ret.push_back(Pair(strName, DBStatsToJSON(*pdb)));
+    }
+    return ret;
+}
+
+UniValue compactdatabase(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "compactdatabase \"name\"\n"
+            "\nCompacts the whole key range of a database and returns when LevelDB is done.\n"
+            "Reads and writes continue meanwhile; use getdbstats from another connection to follow progress.\n"
+            "Note this call may take some time.\n"
+
+            "\nArguments:\n"
+            "1. \"name\"     (string, required) The database: blockindex, chainstate or sporks\n"
+
+            "\nResult:\n"
+            "{ ... }          (json object) The database statistics after the compaction, as in getdbstats\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("compactdatabase", "\"chainstate\"") + HelpExampleRpc("compactdatabase", "\"chainstate\""));
+
+    const std::string strName = request.params[0].get_str();
+    CDBWrapper* pdb = FindDBWrapper(strName);
+    if (!pdb)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown database: " + strName);
+    if (strName == "chainstate")
+        FlushStateToDisk();
+    if (!pdb->Compact())
+        throw JSONRPCError(RPC_MISC_ERROR, "A compaction of " + strName + " is already running");
+    return DBStatsToJSON(*pdb);
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -788,8 +933,6 @@ UniValue gettxout(const JSONRPCRequest& request)
             "\nAs a json rpc call\n" +
             HelpExampleRpc("gettxout", "\"txid\", 1"));
 
-    LOCK(cs_main);
-
     UniValue ret(UniValue::VOBJ);
 
     std::string strHash = request.params[0].get_str();
@@ -800,21 +943,25 @@ UniValue gettxout(const JSONRPCRequest& request)
     if (request.params.size() > 2)
         fMempool = request.params[2].get_bool();
 
+    // The coins cache is only consistent under cs_main, hold it for the lookup alone
     Coin coin;
-    if (fMempool) {
-        LOCK(mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoin(out, coin) || mempool.isSpent(out)) {// TODO: filtering spent coins should be done by the CCoinsViewMemPool
-            return NullUniValue;
-        }
-    } else {
-        if (!pcoinsTip->GetCoin(out, coin)) {
-            return NullUniValue;
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        if (fMempool) {
+            LOCK(mempool.cs);
+            CCoinsViewMemPool view(pcoinsTip, mempool);
+            if (!view.GetCoin(out, coin) || mempool.isSpent(out)) {// TODO: filtering spent coins should be done by the CCoinsViewMemPool
+                return NullUniValue;
+            }
+        } else {
+            if (!pcoinsTip->GetCoin(out, coin)) {
+                return NullUniValue;
+            }
         }
+        pindex = mapBlockIndex.at(pcoinsTip->GetBestBlock());
     }
 
-    BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
-    CBlockIndex* pindex = it->second;
     ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
     if (coin.nHeight == MEMPOOL_HEIGHT) {
         ret.push_back(Pair("confirmations", 0));
@@ -859,7 +1006,7 @@ UniValue getburnaddresses(const JSONRPCRequest& request)
     int nHeight = WITH_LOCK(cs_main, return chainActive.Height());
     if (nHeight < 0) return "[]";
 
-    if (fWithValues) FlushStateToDisk();
+    if (fWithValues) FlushStateToDiskAsync();
     CAmount nSum = 0;
 
     for (const auto& kv : GetBurnStats(pcoinsTip, fWithValues, nHeight)) {
@@ -1005,6 +1152,20 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "        \"status\": \"xxxx\",      (string) status of upgrade\n"
             "        \"info\": \"xxxx\",        (string) additional information about upgrade\n"
             "     }, ...\n"
+            "  },\n"
+            "  \"import\": {                  (object, only while -reindex, bootstrap.dat or -loadblock is importing) import progress\n"
+            "     \"source\": \"xxxx\",          (string) reindex, bootstrap or loadblock\n"
+            "     \"file\": n,                 (numeric) index of the file being read\n"
+            "     \"files\": n,                (numeric) number of files to read\n"
+            "     \"fileprogress\": x.xxx,     (numeric) part of the current file read [0..1]\n"
+            "     \"bytesread\": n,            (numeric) bytes read from all files\n"
+            "     \"blocksparsed\": n,         (numeric) blocks deserialized and checked by the parser threads\n"
+            "     \"blocksloaded\": n,         (numeric) blocks connected or stored\n"
+            "     \"threads\": n,              (numeric) parser threads\n"
+            "     \"elapsed\": n,              (numeric) seconds since the import started\n"
+            "     \"blockspersecond\": x.xx,   (numeric) average blocks loaded per second\n"
+            "     \"mbpersecond\": x.xx        (numeric) average megabytes read per second\n"
+            "  }\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -1034,6 +1195,24 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
 
     obj.push_back(Pair("upgrades", upgrades));
 
+    const CImportProgress progress = GetImportProgress();
+    if (progress.fActive) {
+        const double dElapsed = std::max<int64_t>(GetTimeMillis() - progress.nTimeStart, 1) / 1000.0;
+        UniValue import(UniValue::VOBJ);
+        import.push_back(Pair("source", progress.strSource));
+        import.push_back(Pair("file", progress.nFile));
+        import.push_back(Pair("files", progress.nFiles));
+        import.push_back(Pair("fileprogress", UniValue(progress.nFileSize ? std::min(1.0, (double)progress.nFilePos / progress.nFileSize) : 0.0)));
+        import.push_back(Pair("bytesread", progress.nBytesRead));
+        import.push_back(Pair("blocksparsed", progress.nBlocksParsed));
+        import.push_back(Pair("blocksloaded", progress.nBlocksLoaded));
+        import.push_back(Pair("threads", progress.nThreads));
+        import.push_back(Pair("elapsed", (int64_t)dElapsed));
+        import.push_back(Pair("blockspersecond", UniValue(progress.nBlocksLoaded / dElapsed)));
+        import.push_back(Pair("mbpersecond", UniValue(progress.nBytesRead / dElapsed / (1024 * 1024))));
+        obj.push_back(Pair("import", import));
+    }
+
     return obj;
 }
 
@@ -1188,6 +1367,10 @@ UniValue mempoolInfoToJSON()
     ret.push_back(Pair("size", (int64_t) mempool.size()));
     ret.push_back(Pair("bytes", (int64_t) mempool.GetTotalTxSize()));
     ret.push_back(Pair("usage", (int64_t) mempool.DynamicMemoryUsage()));
+    const ScriptExecutionCacheStats scriptCacheStats = GetScriptExecutionCacheStats();
+    ret.push_back(Pair("scriptcachelookups", (int64_t) scriptCacheStats.nLookups));
+    ret.push_back(Pair("scriptcachehits", (int64_t) scriptCacheStats.nHits));
+    ret.push_back(Pair("scriptcachehitratio", scriptCacheStats.nLookups ? (double) scriptCacheStats.nHits / scriptCacheStats.nLookups : 0.0));
 
     return ret;
 }
@@ -1204,6 +1387,9 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) Total memory usage for the mempool\n"
+            "  \"scriptcachelookups\": xxxxx  (numeric) Transactions of connected blocks looked up in the script execution cache\n"
+            "  \"scriptcachehits\": xxxxx     (numeric) Lookups whose scripts were already verified on mempool acceptance\n"
+            "  \"scriptcachehitratio\": x.xxx (numeric) Share of those whose scripts were already verified on mempool acceptance\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -1231,10 +1417,10 @@ UniValue invalidateblock(const JSONRPCRequest& request)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         InvalidateBlock(state, pblockindex);
     }
 
@@ -1269,10 +1455,10 @@ UniValue reconsiderblock(const JSONRPCRequest& request)
 
     {
         LOCK(cs_main);
-        if (mapBlockIndex.count(hash) == 0)
+        CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-        CBlockIndex* pblockindex = mapBlockIndex[hash];
         ReconsiderBlock(state, pblockindex);
     }
 
@@ -1320,17 +1506,49 @@ void validaterange(const UniValue& params, int& heightStart, int& heightEnd, int
     }
 }
 
+/** Fee record of a block without the spent index: the block, and the transaction of every input */
+static CBlockFeeRecord BlockFeeRecordFromDisk(const CBlockIndex* pindex)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read block from disk");
+    }
+
+    CBlockFeeRecord record;
+    record.nTxAll = block.vtx.size();
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase() || tx.IsCoinStake())
+            continue;
+
+        // fetch input value from prevouts
+        CAmount nValueIn = 0;
+        for (const CTxIn& txin : tx.vin) {
+            CTransaction txPrev;
+            uint256 hashBlock;
+            if (!GetTransaction(txin.prevout.hash, txPrev, hashBlock, true))
+                throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read tx from disk");
+            nValueIn += txPrev.vout[txin.prevout.n].nValue;
+        }
+
+        record.nFees += nValueIn - tx.GetValueOut();
+        record.nTxBytes += GetSerializeSize(tx, SER_NETWORK, CLIENT_VERSION);
+        record.nTx++;
+    }
+    return record;
+}
+
 UniValue getblockindexstats(const JSONRPCRequest& request) {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
         throw std::runtime_error(
                 "getblockindexstats height range ( fFeeOnly )\n"
                 "\nReturns aggregated BlockIndex data for blocks "
                 "\n[height, height+1, height+2, ..., height+range-1]\n"
+                "\nWith -spentindex the sums come from the block fee records, otherwise every block is read.\n"
 
                 "\nArguments:\n"
                 "1. height             (numeric, required) block height where the search starts.\n"
                 "2. range              (numeric, required) number of blocks to include.\n"
-                "3. fFeeOnly           (boolean, optional, default=False) return only fee info.\n"
+                "3. fFeeOnly           (boolean, optional, default=False) return only fee info, without txcount_all.\n"
 
                 "\nResult:\n"
                 "{\n"
@@ -1364,60 +1582,20 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
     int64_t nTxCount = 0;
     int64_t nTxCount_all = 0;
 
-    CBlockIndex* pindex = nullptr;
-    {
-        LOCK(cs_main);
-        pindex = chainActive[heightStart];
-    }
-
-    if (!pindex)
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid block height");
-
-    while (true) {
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex)) {
-            throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read block from disk");
-        }
-
-        CAmount nValueIn = 0;
-        CAmount nValueOut = 0;
-        const int ntx = block.vtx.size();
-        nTxCount_all += ntx;
-        nTxCount = block.IsProofOfStake() ? nTxCount + ntx - 2 : nTxCount + ntx - 1;
-
-        // loop through each tx in block and save size and fee
-        for (const CTransaction& tx : block.vtx) {
-            if (tx.IsCoinBase() || tx.IsCoinStake())
-                continue;
-
-            // fetch input value from prevouts and count spends
-            for (unsigned int j = 0; j < tx.vin.size(); j++) {
-
-                COutPoint prevout = tx.vin[j].prevout;
-                CTransaction txPrev;
-                uint256 hashBlock;
-                if(!GetTransaction(prevout.hash, txPrev, hashBlock, true))
-                    throw JSONRPCError(RPC_DATABASE_ERROR, "failed to read tx from disk");
-                nValueIn += txPrev.vout[prevout.n].nValue;
-            }
-
-            // sum output values in nValueOut
-            for (unsigned int j = 0; j < tx.vout.size(); j++) {
-                nValueOut += tx.vout[j].nValue;
-            }
-
-            // update sums
-            nFees += nValueIn - nValueOut;
-            nBytes += GetSerializeSize(tx, SER_NETWORK, CLIENT_VERSION);
+    const CChainSnapshotRef chain = GetChainSnapshot();
+    for (int nHeight = heightStart; nHeight <= heightEnd; nHeight++) {
+        const CBlockIndex* pindex = (*chain)[nHeight];
+        if (!pindex)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid block height");
 
-        }
+        CBlockFeeRecord record;
+        if (!fSpentIndex || !ReadBlockFeeRecord(pindex->GetBlockHash(), record))
+            record = BlockFeeRecordFromDisk(pindex);
 
-        if (pindex->nHeight < heightEnd) {
-            LOCK(cs_main);
-            pindex = chainActive.Next(pindex);
-        } else {
-            break;
-        }
+        nTxCount_all += record.nTxAll;
+        nTxCount += record.nTx;
+        nFees += record.nFees;
+        nBytes += record.nTxBytes;
     }
 
     // get fee rate
@@ -1425,7 +1603,8 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
 
     // return UniValue object
     ret.push_back(Pair("txcount", (int64_t)nTxCount));
-    ret.push_back(Pair("txcount_all", (int64_t)nTxCount_all));
+    if (!fFeeOnly)
+        ret.push_back(Pair("txcount_all", (int64_t)nTxCount_all));
     ret.push_back(Pair("txbytes", (int64_t)nBytes));
     ret.push_back(Pair("ttlfee", FormatMoney(nFees)));
     ret.push_back(Pair("feeperkb", FormatMoney(nFeeRate.GetFeePerK())));
@@ -1434,6 +1613,52 @@ UniValue getblockindexstats(const JSONRPCRequest& request) {
 
 }
 
+UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getspentinfo {\"txid\": \"hash\", \"index\": n}\n"
+            "\nReturns the input spending an output in the active chain, from the spent index (requires -spentindex).\n"
+
+            "\nArguments:\n"
+            "1. {\n"
+            "     \"txid\" : \"hash\",   (string, required) The id of the transaction of the output\n"
+            "     \"index\" : n,       (numeric, required) The index of the output\n"
+            "   }\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\" : \"hash\",      (string) The id of the spending transaction\n"
+            "  \"index\" : n,          (numeric) The index of the spending input\n"
+            "  \"height\" : n,         (numeric) The height of the block of the spending transaction\n"
+            "  \"value\" : x.xxx       (numeric) The value of the output in OWO\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'") +
+            HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}"));
+
+    if (!fSpentIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled, restart with -spentindex");
+
+    const UniValue& output = request.params[0].get_obj();
+    const uint256 txid = ParseHashO(output, "txid");
+    const UniValue& index = find_value(output, "index");
+    if (!index.isNum() || index.get_int() < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid or missing output index");
+
+    CSpentIndexValue value;
+    if (!ReadSpentIndex(COutPoint(txid, index.get_int()), value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("txid", value.txid.GetHex()));
+    result.push_back(Pair("index", (int)value.inputIndex));
+    result.push_back(Pair("height", value.blockHeight));
+    result.push_back(Pair("value", ValueFromAmount(value.satoshis)));
+    return result;
+}
+
 UniValue rewindblockindex(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -97,6 +97,11 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"logging", 0},
         {"logging", 1},
         {"getblock", 1},
+        {"getaddressbalance", 0},
+        {"getaddressutxos", 0},
+        {"getaddresstxids", 0},
+        {"getaddresstxids", 1},
+        {"getaddresstxids", 2},
         {"getblockheader", 1},
         {"gettransaction", 1},
         {"getrawtransaction", 1},
@@ -141,6 +146,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"getblockindexstats", 0},
         {"getblockindexstats", 1},
         {"getblockindexstats", 2},
+        {"getspentinfo", 0},
         {"getserials", 0},
         {"getserials", 1},
         {"getserials", 2},
@@ -0,0 +1,148 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn) : sink(sinkIn),
+                                                                              nFlushSize(nFlushSizeIn),
+                                                                              nFlushed(0),
+                                                                              fAfterKey(false)
+{
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vFirst.empty()) {
+        if (!vFirst.back())
+            strBuffer += ',';
+        vFirst.back() = false;
+    }
+}
+
+void JSONStreamWriter::Written()
+{
+    if (strBuffer.size() >= nFlushSize)
+        Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    strBuffer += '{';
+    vFirst.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    strBuffer += '}';
+    Written();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    strBuffer += '[';
+    vFirst.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    strBuffer += ']';
+    Written();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    Separate();
+    // a string value serializes with the quoting and escaping of a key
+    strBuffer += UniValue(key).write();
+    strBuffer += ':';
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& val)
+{
+    Separate();
+    strBuffer += val.write();
+    Written();
+}
+
+void JSONStreamWriter::KeyValue(const std::string& key, const UniValue& val)
+{
+    Key(key);
+    Value(val);
+}
+
+void JSONStreamWriter::KeyValues(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); i++)
+        KeyValue(keys[i], values[i]);
+}
+
+void JSONStreamWriter::Raw(const std::string& str)
+{
+    strBuffer += str;
+    Written();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (strBuffer.empty())
+        return;
+    sink(strBuffer);
+    nFlushed += strBuffer.size();
+    strBuffer.clear();
+}
+
+JSONResultStream::JSONResultStream(JSONStreamWriter* pstreamIn, UniValue::VType type) : pstream(pstreamIn),
+                                                                                        result(type)
+{
+    assert(type == UniValue::VARR || type == UniValue::VOBJ);
+    if (!pstream)
+        return;
+    if (type == UniValue::VARR)
+        pstream->BeginArray();
+    else
+        pstream->BeginObject();
+}
+
+void JSONResultStream::push_back(const UniValue& val)
+{
+    if (pstream)
+        pstream->Value(val);
+    else
+        result.push_back(val);
+}
+
+void JSONResultStream::pushKV(const std::string& key, const UniValue& val)
+{
+    if (pstream)
+        pstream->KeyValue(key, val);
+    else
+        result.pushKV(key, val);
+}
+
+UniValue JSONResultStream::Finish()
+{
+    if (!pstream)
+        return result;
+    if (result.isArray())
+        pstream->EndArray();
+    else
+        pstream->EndObject();
+    return NullUniValue;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+/** Output a JSONStreamWriter collects before handing it to its sink */
+static const size_t JSONSTREAM_FLUSH_SIZE = 64 * 1024;
+
+/**
+ * Writes a JSON document piece by piece, the same text UniValue::write() would produce
+ * for it. Containers are opened and closed explicitly while the values inside them are
+ * passed as UniValue, so a long list never exists as a whole in memory: the output is
+ * handed to the sink every JSONSTREAM_FLUSH_SIZE bytes.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+private:
+    Sink sink;
+    size_t nFlushSize;
+    std::string strBuffer;
+    size_t nFlushed;
+    //! one entry per open container, whether nothing was written into it yet
+    std::vector<bool> vFirst;
+    bool fAfterKey;
+
+    void Separate();
+    void Written();
+
+public:
+    JSONStreamWriter(const Sink& sinkIn, size_t nFlushSizeIn = JSONSTREAM_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void Key(const std::string& key);
+    void Value(const UniValue& val);
+    void KeyValue(const std::string& key, const UniValue& val);
+    /** Write the members of the object obj into the current object */
+    void KeyValues(const UniValue& obj);
+    /** Append text as is, for the newline closing a reply */
+    void Raw(const std::string& str);
+
+    /** Hand the buffered output to the sink */
+    void Flush();
+    /** Output still buffered */
+    const std::string& GetBuffer() const { return strBuffer; }
+    /** Whether output was handed to the sink already */
+    bool Flushed() const { return nFlushed > 0; }
+    /** Whether a key was written that has no value yet */
+    bool AwaitingValue() const { return fAfterKey; }
+};
+
+/**
+ * Array or object result of an RPC call listing many entries. When the reply is streamed
+ * (JSONRPCRequest::pstream) every entry is written out as soon as it is added, otherwise
+ * the entries are collected into the UniValue the call returns.
+ */
+class JSONResultStream
+{
+private:
+    JSONStreamWriter* pstream;
+    UniValue result;
+
+public:
+    JSONResultStream(JSONStreamWriter* pstreamIn, UniValue::VType type);
+
+    void push_back(const UniValue& val);
+    void pushKV(const std::string& key, const UniValue& val);
+
+    /** The value for the call to return: the collected entries, or null when they were streamed */
+    UniValue Finish();
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -6,6 +6,7 @@
 
 #include "activemasternode.h"
 #include "activemasternodeman.h"
+#include "chainsnapshot.h"
 #include "db.h"
 #include "init.h"
 #include "main.h"
@@ -95,10 +96,10 @@ UniValue listmasternodes(const JSONRPCRequest& request)
             "\nExamples:\n" +
             HelpExampleCli("listmasternodes", "") + HelpExampleRpc("listmasternodes", ""));
 
-    UniValue ret(UniValue::VARR);
-    const auto pIndex = WITH_LOCK(cs_main, return chainActive.Tip());
-    const auto nHeight = pIndex->nHeight;
-    if (nHeight < 0) return "[]";
+    const auto pIndex = GetChainSnapshot()->Tip();
+    if (!pIndex) return "[]";
+
+    JSONResultStream ret(request.pstream, UniValue::VARR);
 
     for (auto& mn : mnodeman.GetFullMasternodeVector()) {
         UniValue obj(UniValue::VOBJ);
@@ -134,7 +135,7 @@ UniValue listmasternodes(const JSONRPCRequest& request)
         ret.push_back(obj);
     }
 
-    return ret;
+    return ret.Finish();
 }
 
 UniValue getmasternodecount (const JSONRPCRequest& request)
@@ -158,9 +159,8 @@ UniValue getmasternodecount (const JSONRPCRequest& request)
     UniValue obj(UniValue::VOBJ);
     int ipv4 = 0, ipv6 = 0, onion = 0;
 
-    const auto tipIndex = WITH_LOCK(cs_main, return chainActive.Tip());
-    const auto nChainHeight = tipIndex->nHeight;
-    if (nChainHeight < 0) return "unknown";
+    const auto tipIndex = GetChainSnapshot()->Tip();
+    if (!tipIndex) return "unknown";
 
     mnodeman.CountNetworks(ipv4, ipv6, onion);
 
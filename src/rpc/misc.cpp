@@ -15,12 +15,14 @@
 #include "masternodeconfig.h"
 #include "masternodeman.h"
 #include "masternode-sync.h"
+#include "miner.h"
 #include "net.h"
 #include "netbase.h"
 #include "rewards.h"
 #include "rpc/server.h"
 #include "spork.h"
 #include "timedata.h"
+#include "txdb.h"
 #include "util.h"
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -28,6 +30,7 @@
 #endif
 
 #include <stdint.h>
+#include <tuple>
 
 #include <boost/assign/list_of.hpp>
 
@@ -578,6 +581,163 @@ UniValue verifymessage(const JSONRPCRequest& request)
     return (pubkey.GetID() == *keyID);
 }
 
+/** An address of an address index query, with the key its entries are indexed under */
+struct CAddressQuery {
+    std::string strAddress;
+    uint8_t type;
+    uint160 hashBytes;
+};
+
+static std::vector<CAddressQuery> ParseAddressQuery(const UniValue& addresses)
+{
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled, restart with -addressindex");
+
+    std::vector<CAddressQuery> vQuery;
+    for (const UniValue& address : addresses.get_array().getValues()) {
+        CAddressQuery query;
+        query.strAddress = address.get_str();
+        if (!GetAddressIndexKey(DecodeDestination(query.strAddress), query.type, query.hashBytes))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address: " + query.strAddress);
+        vQuery.push_back(query);
+    }
+    return vQuery;
+}
+
+UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance [\"address\",...]\n"
+            "\nReturns the balance of addresses, from the address index (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. [\"address\",...]     (array of strings, required) The OWO addresses\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\" : x.xxx,     (numeric) The current balance in OWO\n"
+            "  \"received\" : x.xxx,    (numeric) The total amount received in OWO, change included\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressbalance", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]'") +
+            HelpExampleRpc("getaddressbalance", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]"));
+
+    CAmount nBalance = 0;
+    CAmount nReceived = 0;
+    for (const CAddressQuery& query : ParseAddressQuery(request.params[0])) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+        if (!pblocktree->ReadAddressIndex(query.type, query.hashBytes, vEntries))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const std::pair<CAddressIndexKey, CAmount>& entry : vEntries) {
+            nBalance += entry.second;
+            if (entry.second > 0)
+                nReceived += entry.second;
+        }
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("balance", ValueFromAmount(nBalance)));
+    result.push_back(Pair("received", ValueFromAmount(nReceived)));
+    return result;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressutxos [\"address\",...]\n"
+            "\nReturns the unspent outputs of addresses, from the address index (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. [\"address\",...]     (array of strings, required) The OWO addresses\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\" : \"address\",  (string) The address paid\n"
+            "    \"txid\" : \"hash\",        (string) The id of the transaction\n"
+            "    \"outputIndex\" : n,      (numeric) The index of the output\n"
+            "    \"script\" : \"hex\",       (string) The script of the output\n"
+            "    \"amount\" : x.xxx,       (numeric) The value of the output in OWO\n"
+            "    \"height\" : n            (numeric) The height of the block of the transaction\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddressutxos", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]'") +
+            HelpExampleRpc("getaddressutxos", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]"));
+
+    const std::vector<CAddressQuery> vQuery = ParseAddressQuery(request.params[0]);
+
+    JSONResultStream result(request.pstream, UniValue::VARR);
+    for (const CAddressQuery& query : vQuery) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+        if (!pblocktree->ReadAddressUnspentIndex(query.type, query.hashBytes, vUnspent))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const std::pair<CAddressUnspentKey, CAddressUnspentValue>& unspent : vUnspent) {
+            UniValue output(UniValue::VOBJ);
+            output.push_back(Pair("address", query.strAddress));
+            output.push_back(Pair("txid", unspent.first.txhash.GetHex()));
+            output.push_back(Pair("outputIndex", (int)unspent.first.index));
+            output.push_back(Pair("script", HexStr(unspent.second.script.begin(), unspent.second.script.end())));
+            output.push_back(Pair("amount", ValueFromAmount(unspent.second.satoshis)));
+            output.push_back(Pair("height", unspent.second.blockHeight));
+            result.push_back(output);
+        }
+    }
+    return result.Finish();
+}
+
+UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "getaddresstxids [\"address\",...] ( start end )\n"
+            "\nReturns the ids of the transactions paying to or spending from addresses, in chain order,\n"
+            "from the address index (requires -addressindex).\n"
+
+            "\nArguments:\n"
+            "1. [\"address\",...]     (array of strings, required) The OWO addresses\n"
+            "2. start               (numeric, optional) The first block height to include\n"
+            "3. end                 (numeric, optional) The last block height to include\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  \"txid\"                (string) The id of a transaction\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getaddresstxids", "'[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"]' 1000 2000") +
+            HelpExampleRpc("getaddresstxids", "[\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"], 1000, 2000"));
+
+    const std::vector<CAddressQuery> vQuery = ParseAddressQuery(request.params[0]);
+    const int nStart = request.params.size() > 1 ? request.params[1].get_int() : 0;
+    const int nEnd = request.params.size() > 2 ? request.params[2].get_int() : 0;
+    if (nStart < 0 || nEnd < 0 || (nEnd > 0 && nEnd < nStart))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height range");
+
+    // (height, position in the block, txid) of every entry, sorted into chain order
+    std::vector<std::tuple<int, unsigned int, uint256> > vTxs;
+    for (const CAddressQuery& query : vQuery) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+        if (!pblocktree->ReadAddressIndex(query.type, query.hashBytes, vEntries, nStart, nEnd))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+        for (const std::pair<CAddressIndexKey, CAmount>& entry : vEntries)
+            vTxs.emplace_back(entry.first.blockHeight, entry.first.txindex, entry.first.txhash);
+    }
+    std::sort(vTxs.begin(), vTxs.end());
+    vTxs.erase(std::unique(vTxs.begin(), vTxs.end()), vTxs.end());
+
+    JSONResultStream result(request.pstream, UniValue::VARR);
+    for (const std::tuple<int, unsigned int, uint256>& tx : vTxs)
+        result.push_back(std::get<2>(tx).GetHex());
+    return result.Finish();
+}
+
 UniValue setmocktime(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -702,6 +862,12 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
             "  \"lastattempt_hash\": xxx            (hex string) hash of the block on top of which the last stake attempt was made\n"
             "  \"lastattempt_coins\": n             (numeric) number of stakeable coins available during last stake attempt\n"
             "  \"lastattempt_tries\": n             (numeric) number of stakeable coins checked during last stake attempt\n"
+            "  \"template_txs\": n                  (numeric) number of transactions pre-selected for the next staked block\n"
+            "  \"template_age\": n                  (numeric) seconds since the transaction selection was last refreshed\n"
+            "  \"stakedblocks\": n                  (numeric) number of blocks staked since startup\n"
+            "  \"stakedblocks_template\": n         (numeric) number of those built from the pre-selected transactions\n"
+            "  \"lastblock_latency_ms\": n          (numeric) milliseconds from kernel found to broadcast for the last staked block\n"
+            "  \"avgblock_latency_ms\": n           (numeric) average of the above over the blocks staked since startup\n"
             "}\n"
 
             "\nExamples:\n" +
@@ -733,6 +899,17 @@ UniValue getstakingstatus(const JSONRPCRequest& request)
             obj.push_back(Pair("lastattempt_coins", ss->GetLastCoins()));
             obj.push_back(Pair("lastattempt_tries", ss->GetLastTries()));
         }
+        const CStakeTemplateInfo info = GetStakeTemplateInfo();
+        if (info.hashTemplateTip == chainActive.Tip()->GetBlockHash()) {
+            obj.push_back(Pair("template_txs", (int)info.nTemplateTxs));
+            obj.push_back(Pair("template_age", GetTime() - info.nTemplateTime));
+        }
+        obj.push_back(Pair("stakedblocks", info.nBlocks));
+        obj.push_back(Pair("stakedblocks_template", info.nTemplateBlocks));
+        if (info.nBlocks > 0) {
+            obj.push_back(Pair("lastblock_latency_ms", UniValue(info.nLastLatency / 1000.0)));
+            obj.push_back(Pair("avgblock_latency_ms", UniValue(info.nTotalLatency / 1000.0 / info.nBlocks)));
+        }
         return obj;
     }
 }
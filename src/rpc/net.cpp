@@ -128,6 +128,9 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ]\n"
+            "    \"mnlistrequests\": n,      (numeric) The requests of the whole masternode list from the peer\n"
+            "    \"mnlistrefused\": n,       (numeric) The requests of the list refused for coming too soon\n"
+            "    \"mnlistlastrequest\": ttt, (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last request of the list\n"
             "    \"bytessent_per_msg\": {\n"
             "       \"addr\": n,             (numeric) The total bytes sent aggregated by message type\n"
             "       ...\n"
@@ -187,6 +190,9 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             obj.push_back(Pair("inflight", heights));
         }
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
+        obj.push_back(Pair("mnlistrequests", stats.nMNListRequests));
+        obj.push_back(Pair("mnlistrefused", stats.nMNListRefused));
+        obj.push_back(Pair("mnlistlastrequest", stats.nLastMNListRequest));
 
         UniValue sendPerMsgCmd(UniValue::VOBJ);
         for (const mapMsgCmdSize::value_type &i : stats.mapSendBytesPerMsgCmd) {
@@ -375,6 +381,124 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue LatencyHistogramToJSON(const CLatencyHistogram& hist)
+{
+    UniValue buckets(UniValue::VARR);
+    for (uint64_t nBucket : hist.vBuckets)
+        buckets.push_back(nBucket);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("count", hist.nCount));
+    obj.push_back(Pair("total", ((double)hist.nTotal) / 1e6));
+    obj.push_back(Pair("max", ((double)hist.nMax) / 1e6));
+    obj.push_back(Pair("histogram", buckets));
+    return obj;
+}
+
+UniValue getnetmsgstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "getnetmsgstats\n"
+            "\nReturns per message type latency histograms of the message handlers, and\n"
+            "per peer message counters. Times are in seconds.\n"
+            "Message types marked concurrent are handled by the message handler workers\n"
+            "(see -msghandlerworkers) alongside block and transaction processing.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"workers\": n,              (numeric) Number of message handler workers\n"
+            "  \"buckets\": [ x, ... ],    (array) Upper bounds of the histogram buckets, followed by an unbounded bucket\n"
+            "  \"messages\": {\n"
+            "    \"command\": {             (object) Message type\n"
+            "      \"concurrent\": true|false, (boolean) Whether the message type can be handled by a worker\n"
+            "      \"wait\": {              (object) Time between receipt and the start of processing\n"
+            "        \"count\": n,          (numeric) Number of messages\n"
+            "        \"total\": x,          (numeric) Total time\n"
+            "        \"max\": x,            (numeric) Maximum time\n"
+            "        \"histogram\": [ n, ... ] (array) Number of messages per bucket\n"
+            "      },\n"
+            "      \"time\": { ... },       (object) Time spent in the handler, same layout as wait\n"
+            "      \"cs_main_wait\": { ... } (object) Time the handler was blocked on cs_main, same layout as wait\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"peers\": [\n"
+            "    {\n"
+            "      \"id\": n,               (numeric) Peer index\n"
+            "      \"addr\": \"host:port\",   (string) The ip address and port of the peer\n"
+            "      \"messages\": {\n"
+            "        \"command\": {\n"
+            "          \"sent\": n,         (numeric) Messages sent\n"
+            "          \"bytessent\": n,    (numeric) Bytes sent\n"
+            "          \"recv\": n,         (numeric) Messages received\n"
+            "          \"bytesrecv\": n,    (numeric) Bytes received\n"
+            "          \"time\": x          (numeric) Time spent handling the received messages\n"
+            "        }, ...\n"
+            "      }\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getnetmsgstats", "") + HelpExampleRpc("getnetmsgstats", ""));
+
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue buckets(UniValue::VARR);
+    for (int64_t nBound : MSG_LATENCY_BUCKETS)
+        buckets.push_back(UniValue(((double)nBound) / 1e6));
+
+    UniValue messages(UniValue::VOBJ);
+    for (const auto& entry : g_connman->GetMessageProcessingStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("concurrent", IsConcurrentNetMessageType(entry.first)));
+        obj.push_back(Pair("wait", LatencyHistogramToJSON(entry.second.wait)));
+        obj.push_back(Pair("time", LatencyHistogramToJSON(entry.second.process)));
+        obj.push_back(Pair("cs_main_wait", LatencyHistogramToJSON(entry.second.lockWait)));
+        messages.push_back(Pair(entry.first, obj));
+    }
+
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+    UniValue peers(UniValue::VARR);
+    for (const CNodeStats& stats : vstats) {
+        std::set<std::string> setCommands;
+        for (const mapMsgCmdSize::value_type& i : stats.mapSendMsgsPerMsgCmd)
+            if (i.second > 0) setCommands.insert(i.first);
+        for (const mapMsgCmdSize::value_type& i : stats.mapRecvMsgsPerMsgCmd)
+            if (i.second > 0) setCommands.insert(i.first);
+
+        UniValue peerMessages(UniValue::VOBJ);
+        for (const std::string& strCommand : setCommands) {
+            auto get = [&strCommand](const mapMsgCmdSize& map) -> uint64_t {
+                auto it = map.find(strCommand);
+                return it == map.end() ? 0 : it->second;
+            };
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("sent", get(stats.mapSendMsgsPerMsgCmd)));
+            obj.push_back(Pair("bytessent", get(stats.mapSendBytesPerMsgCmd)));
+            obj.push_back(Pair("recv", get(stats.mapRecvMsgsPerMsgCmd)));
+            obj.push_back(Pair("bytesrecv", get(stats.mapRecvBytesPerMsgCmd)));
+            obj.push_back(Pair("time", ((double)get(stats.mapProcessTimePerMsgCmd)) / 1e6));
+            peerMessages.push_back(Pair(strCommand, obj));
+        }
+
+        UniValue peer(UniValue::VOBJ);
+        peer.push_back(Pair("id", stats.nodeid));
+        peer.push_back(Pair("addr", stats.addrName));
+        peer.push_back(Pair("messages", peerMessages));
+        peers.push_back(peer);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("workers", g_connman->GetMessageHandlerWorkers()));
+    obj.push_back(Pair("buckets", buckets));
+    obj.push_back(Pair("messages", messages));
+    obj.push_back(Pair("peers", peers));
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
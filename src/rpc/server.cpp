@@ -294,6 +294,7 @@ static const CRPCCommand vRPCCommands[] =
         {"network", "getaddednodeinfo", &getaddednodeinfo, true },
         {"network", "getconnectioncount", &getconnectioncount, true },
         {"network", "getnettotals", &getnettotals, true },
+        {"network", "getnetmsgstats", &getnetmsgstats, true },
         {"network", "getpeerinfo", &getpeerinfo, true },
         {"network", "ping", &ping, true },
         {"network", "setban", &setban, true },
@@ -312,16 +313,24 @@ static const CRPCCommand vRPCCommands[] =
         {"blockchain", "getchaintips", &getchaintips, true },
         {"blockchain", "getdifficulty", &getdifficulty, true },
         {"blockchain", "getfeeinfo", &getfeeinfo, true },
+        {"blockchain", "getspentinfo", &getspentinfo, true },
         {"blockchain", "getmempoolinfo", &getmempoolinfo, true },
         {"blockchain", "getrawmempool", &getrawmempool, true },
         {"blockchain", "gettxout", &gettxout, true },
         {"blockchain", "gettxoutsetinfo", &gettxoutsetinfo, true },
+        {"blockchain", "getdbstats", &getdbstats, true },
+        {"blockchain", "compactdatabase", &compactdatabase, true },
         {"blockchain", "invalidateblock", &invalidateblock, true },
         {"blockchain", "reconsiderblock", &reconsiderblock, true },
         {"blockchain", "verifychain", &verifychain, true },
         {"blockchain", "getburnaddresses", &getburnaddresses, true },
         {"blockchain", "rewindblockindex", &rewindblockindex, true },
 
+        /* Address index */
+        {"addressindex", "getaddressbalance", &getaddressbalance, true },
+        {"addressindex", "getaddressutxos", &getaddressutxos, true },
+        {"addressindex", "getaddresstxids", &getaddresstxids, true },
+
         /* Mining */
         {"mining", "getblocktemplate", &getblocktemplate, true },
         {"mining", "getmininginfo", &getmininginfo, true },
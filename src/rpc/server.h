@@ -9,6 +9,7 @@
 #define BITCOIN_RPCSERVER_H
 
 #include "amount.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "uint256.h"
 
@@ -41,8 +42,10 @@ public:
     bool fHelp;
     std::string URI;
     std::string authUser;
+    //! Where the reply is being written when it is streamed to the client, see JSONResultStream
+    JSONStreamWriter* pstream;
 
-    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; }
+    JSONRPCRequest() { id = NullUniValue; params = NullUniValue; fHelp = false; pstream = nullptr; }
     void parse(const UniValue& valRequest);
 };
 
@@ -181,6 +184,8 @@ extern int64_t nWalletUnlockTime;
 extern CAmount AmountFromValue(const UniValue& value);
 extern UniValue ValueFromAmount(const CAmount& amount);
 extern double GetDifficulty(const CBlockIndex* blockindex = NULL);
+/** The mempool as getrawmempool returns it, written to pstream instead when it is given */
+extern UniValue mempoolToJSON(bool fVerbose = false, JSONStreamWriter* pstream = nullptr); // in rpc/blockchain.cpp
 extern std::string HelpRequiringPassphrase();
 extern std::string HelpExampleCli(std::string methodname, std::string args);
 extern std::string HelpExampleRpc(std::string methodname, std::string args);
@@ -196,6 +201,7 @@ extern UniValue addnode(const JSONRPCRequest& request);
 extern UniValue disconnectnode(const JSONRPCRequest& request);
 extern UniValue getaddednodeinfo(const JSONRPCRequest& request);
 extern UniValue getnettotals(const JSONRPCRequest& request);
+extern UniValue getnetmsgstats(const JSONRPCRequest& request);
 extern UniValue setban(const JSONRPCRequest& request);
 extern UniValue listbanned(const JSONRPCRequest& request);
 extern UniValue clearbanned(const JSONRPCRequest& request);
@@ -241,12 +247,15 @@ extern UniValue getblock(const JSONRPCRequest& request);
 extern UniValue getblockheader(const JSONRPCRequest& request);
 extern UniValue getfeeinfo(const JSONRPCRequest& request);
 extern UniValue gettxoutsetinfo(const JSONRPCRequest& request);
+extern UniValue getdbstats(const JSONRPCRequest& request);
+extern UniValue compactdatabase(const JSONRPCRequest& request);
 extern UniValue gettxout(const JSONRPCRequest& request);
 extern UniValue verifychain(const JSONRPCRequest& request);
 extern UniValue getchaintips(const JSONRPCRequest& request);
 extern UniValue invalidateblock(const JSONRPCRequest& request);
 extern UniValue reconsiderblock(const JSONRPCRequest& request);
 extern UniValue getblockindexstats(const JSONRPCRequest& request);
+extern UniValue getspentinfo(const JSONRPCRequest& request);
 extern UniValue getburnaddresses(const JSONRPCRequest& request);
 extern UniValue rewindblockindex(const JSONRPCRequest& request);
 extern void validaterange(const UniValue& params, int& heightStart, int& heightEnd, int minHeightStart=1);
@@ -275,6 +284,9 @@ extern UniValue validateaddress(const JSONRPCRequest& request);
 extern UniValue createmultisig(const JSONRPCRequest& request);
 extern UniValue verifymessage(const JSONRPCRequest& request);
 extern UniValue setmocktime(const JSONRPCRequest& request);
+extern UniValue getaddressbalance(const JSONRPCRequest& request);
+extern UniValue getaddressutxos(const JSONRPCRequest& request);
+extern UniValue getaddresstxids(const JSONRPCRequest& request);
 extern UniValue getstakingstatus(const JSONRPCRequest& request);
 extern UniValue getrewardsinfo(const JSONRPCRequest& request);
 
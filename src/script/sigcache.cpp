@@ -7,6 +7,7 @@
 
 #include "sigcache.h"
 
+#include "crypto/common.h"
 #include "memusage.h"
 #include "pubkey.h"
 #include "random.h"
@@ -14,6 +15,7 @@
 #include "util.h"
 
 #include "cuckoocache.h"
+#include <atomic>
 #include <boost/thread.hpp>
 
 namespace {
@@ -61,6 +63,65 @@ public:
     }
 };
 
+/**
+ * Transactions whose scripts all passed under some set of verification flags,
+ * so that ConnectBlock can skip the CScriptCheck's of what the mempool accepted
+ */
+class CScriptExecutionCache
+{
+private:
+    //! Entries are SHA256(nonce || txid || flags):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_scriptcache;
+    std::atomic<uint64_t> nLookups;
+    std::atomic<uint64_t> nHits;
+
+public:
+    CScriptExecutionCache() : nLookups(0), nHits(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& txid, unsigned int flags)
+    {
+        unsigned char vchFlags[4];
+        WriteLE32(vchFlags, flags);
+        CSHA256().Write(nonce.begin(), 32).Write(txid.begin(), 32).Write(vchFlags, sizeof(vchFlags)).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry, const bool erase, const bool fCount)
+    {
+        bool fHit;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_scriptcache);
+            fHit = setValid.contains(entry, erase);
+        }
+        if (fCount) {
+            nLookups++;
+            if (fHit) nHits++;
+        }
+        return fHit;
+    }
+
+    void Set(const uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_scriptcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+
+    ScriptExecutionCacheStats GetStats() const
+    {
+        return ScriptExecutionCacheStats{nLookups.load(), nHits.load()};
+    }
+};
+
 /* In previous versions of this code, signatureCache was a local static variable
  * in CachingTransactionSignatureChecker::VerifySignature.  We initialize
  * signatureCache outside of VerifySignature to avoid the atomic operation per
@@ -68,6 +129,7 @@ public:
  * signatureCache could be made local to VerifySignature.
 */
 static CSignatureCache signatureCache;
+static CScriptExecutionCache scriptExecutionCache;
 }
 
 // To be called once in AppInitMain/BasicTestingSetup to initialize the
@@ -76,10 +138,36 @@ void InitSignatureCache()
 {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
-    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    // Half of it goes to each cache.
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20) / 2;
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    nElems = scriptExecutionCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+}
+
+uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 entry;
+    scriptExecutionCache.ComputeEntry(entry, tx.GetHash(), flags);
+    return entry;
+}
+
+bool ScriptExecutionCacheGet(const uint256& entry, bool erase, bool fCount)
+{
+    return scriptExecutionCache.Get(entry, erase, fCount);
+}
+
+void ScriptExecutionCacheSet(const uint256& entry)
+{
+    scriptExecutionCache.Set(entry);
+}
+
+ScriptExecutionCacheStats GetScriptExecutionCacheStats()
+{
+    return scriptExecutionCache.GetStats();
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -52,6 +52,28 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 };
 
+/** Lookups block connection made in the script execution cache, and how many of them hit */
+struct ScriptExecutionCacheStats
+{
+    uint64_t nLookups;
+    uint64_t nHits;
+};
+
+/** Size the signature cache and the script execution cache, which share -maxsigcachesize */
 void InitSignatureCache();
 
+/**
+ * The script execution cache holds transactions whose input scripts all passed
+ * under a set of verification flags, so connecting a block can skip the script
+ * checks of transactions the mempool already validated with the block's flags.
+ * Entries are salted hashes of the txid (there is no witness data, so that is
+ * also the wtxid) and the flags.
+ */
+uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags);
+/** Whether the entry is cached, erasing it on a hit if erase is set. Only the
+ *  lookups of connected blocks pass fCount, those are the ones in the stats. */
+bool ScriptExecutionCacheGet(const uint256& entry, bool erase, bool fCount = false);
+void ScriptExecutionCacheSet(const uint256& entry);
+ScriptExecutionCacheStats GetScriptExecutionCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -0,0 +1,39 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spentindex.h"
+
+#include "coins.h"
+#include "primitives/block.h"
+#include "undo.h"
+#include "version.h"
+
+void GetSpentIndexChanges(const CBlock& block, const CBlockUndo& blockundo, int nHeight, std::vector<std::pair<COutPoint, CSpentIndexValue> >& vSpent)
+{
+    // the coinbase spends nothing, and has no undo entry
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+        for (unsigned int j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+            vSpent.emplace_back(tx.vin[j].prevout, CSpentIndexValue(tx.GetHash(), j, nHeight, txundo.vprevout[j].out.nValue));
+    }
+}
+
+CBlockFeeRecord GetBlockFeeRecord(const CBlock& block, const CBlockUndo& blockundo)
+{
+    CBlockFeeRecord record;
+    record.nTxAll = block.vtx.size();
+    for (unsigned int i = 1; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        if (tx.IsCoinStake())
+            continue;
+        CAmount nValueIn = 0;
+        for (const Coin& coin : blockundo.vtxundo[i - 1].vprevout)
+            nValueIn += coin.out.nValue;
+        record.nFees += nValueIn - tx.GetValueOut();
+        record.nTxBytes += ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+        record.nTx++;
+    }
+    return record;
+}
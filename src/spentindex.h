@@ -0,0 +1,82 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SPENTINDEX_H
+#define BITCOIN_SPENTINDEX_H
+
+#include "amount.h"
+#include "primitives/transaction.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/** The input spending an output, keyed in the spent index by the output */
+struct CSpentIndexValue {
+    uint256 txid;
+    unsigned int inputIndex;
+    int blockHeight;
+    CAmount satoshis;
+
+    CSpentIndexValue() { SetNull(); }
+
+    CSpentIndexValue(const uint256& txidIn, unsigned int inputIndexIn, int blockHeightIn, CAmount satoshisIn) : txid(txidIn),
+                                                                                                              inputIndex(inputIndexIn),
+                                                                                                              blockHeight(blockHeightIn),
+                                                                                                              satoshis(satoshisIn) {}
+
+    void SetNull()
+    {
+        txid.SetNull();
+        inputIndex = 0;
+        blockHeight = 0;
+        satoshis = 0;
+    }
+
+    bool IsNull() const { return txid.IsNull(); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txid);
+        READWRITE(inputIndex);
+        READWRITE(blockHeight);
+        READWRITE(satoshis);
+    }
+};
+
+/** Fees and size of the transactions of a block other than its coinbase and coinstake */
+struct CBlockFeeRecord {
+    CAmount nFees;
+    uint64_t nTxBytes;
+    unsigned int nTx;
+    //! all transactions of the block, coinbase and coinstake included
+    unsigned int nTxAll;
+
+    CBlockFeeRecord() : nFees(0), nTxBytes(0), nTx(0), nTxAll(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nFees);
+        READWRITE(VARINT(nTxBytes));
+        READWRITE(VARINT(nTx));
+        READWRITE(VARINT(nTxAll));
+    }
+};
+
+/** Collect the spent index entries of a block at height nHeight, its undo data giving the coins its transactions spend */
+void GetSpentIndexChanges(const CBlock& block, const CBlockUndo& blockundo, int nHeight, std::vector<std::pair<COutPoint, CSpentIndexValue> >& vSpent);
+
+/** Fee record of a block, from its undo data */
+CBlockFeeRecord GetBlockFeeRecord(const CBlock& block, const CBlockUndo& blockundo);
+
+#endif // BITCOIN_SPENTINDEX_H
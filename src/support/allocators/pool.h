@@ -0,0 +1,191 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <new>
+
+/**
+ * Memory resource for node based containers, like the coins cache map, whose nodes all
+ * have the same small size.
+ *
+ * Allocations of up to MAX_BLOCK_SIZE_BYTES are carved out of large chunks, one after the
+ * other, and freed blocks go to a free list per size to be handed out again. Compared to
+ * one malloc per node this saves the per allocation overhead of the system allocator and
+ * keeps nodes allocated together close together in memory. Chunks are only given back when
+ * the resource is destroyed. Bigger allocations, like the bucket array, go to operator new.
+ *
+ * Not thread safe; it shares the locking of the container that uses it.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+    /** In-place free list link, stored in the freed block itself */
+    struct ListNode {
+        ListNode* m_next;
+        explicit ListNode(ListNode* next) : m_next(next) {}
+    };
+
+    static_assert((ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+
+    /** Blocks are multiples of this, large and aligned enough to hold a ListNode */
+    static constexpr std::size_t ELEM_ALIGN_BYTES = ALIGN_BYTES > alignof(ListNode) ? ALIGN_BYTES : alignof(ListNode);
+    static_assert(ELEM_ALIGN_BYTES >= sizeof(ListNode), "blocks must be able to hold a free list link");
+    static_assert(ELEM_ALIGN_BYTES <= alignof(std::max_align_t), "chunks come from operator new, which only guarantees max_align_t");
+
+    /** Number of ELEM_ALIGN_BYTES units needed for an allocation; zero byte allocations take one unit */
+    static constexpr std::size_t NumElemAlignBytes(std::size_t bytes)
+    {
+        return (bytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (bytes == 0);
+    }
+
+    static constexpr bool IsFreeListUsable(std::size_t bytes, std::size_t alignment)
+    {
+        return alignment <= ELEM_ALIGN_BYTES && bytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    const std::size_t m_chunk_size_bytes;
+
+    //! all chunks, released in the destructor
+    std::list<char*> m_allocated_chunks;
+
+    //! free list heads, indexed by block size in ELEM_ALIGN_BYTES units
+    std::array<ListNode*, NumElemAlignBytes(MAX_BLOCK_SIZE_BYTES) + 1> m_free_lists;
+
+    //! not yet handed out part of the newest chunk
+    char* m_available_memory_it{nullptr};
+    char* m_available_memory_end{nullptr};
+
+    void PlacementAddToList(void* p, ListNode*& node)
+    {
+        node = new (p) ListNode(node);
+    }
+
+    void AllocateChunk()
+    {
+        // the tail of the current chunk is too small for the request, keep it as a free block
+        if (m_available_memory_it != m_available_memory_end) {
+            const std::size_t nRemaining = m_available_memory_end - m_available_memory_it;
+            PlacementAddToList(m_available_memory_it, m_free_lists[nRemaining / ELEM_ALIGN_BYTES]);
+        }
+        char* pchunk = static_cast<char*>(::operator new(m_chunk_size_bytes));
+        m_allocated_chunks.push_back(pchunk);
+        m_available_memory_it = pchunk;
+        m_available_memory_end = pchunk + m_chunk_size_bytes;
+    }
+
+public:
+    /**
+     * @param[in] chunk_size_bytes  Bytes requested from operator new at a time, rounded up to whole
+     *                              blocks. No memory is allocated until the first Allocate().
+     */
+    explicit PoolResource(std::size_t chunk_size_bytes)
+        : m_chunk_size_bytes(NumElemAlignBytes(chunk_size_bytes) * ELEM_ALIGN_BYTES)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+        m_free_lists.fill(nullptr);
+    }
+
+    PoolResource() : PoolResource(262144) {}
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    ~PoolResource()
+    {
+        for (char* pchunk : m_allocated_chunks)
+            ::operator delete(pchunk);
+    }
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (!IsFreeListUsable(bytes, alignment))
+            return ::operator new(bytes);
+
+        const std::size_t nUnits = NumElemAlignBytes(bytes);
+        if (m_free_lists[nUnits] != nullptr) {
+            ListNode* pnode = m_free_lists[nUnits];
+            m_free_lists[nUnits] = pnode->m_next;
+            return pnode;
+        }
+
+        const std::size_t nBytes = nUnits * ELEM_ALIGN_BYTES;
+        if (nBytes > static_cast<std::size_t>(m_available_memory_end - m_available_memory_it))
+            AllocateChunk();
+        void* p = m_available_memory_it;
+        m_available_memory_it += nBytes;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            PlacementAddToList(p, m_free_lists[NumElemAlignBytes(bytes)]);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    std::size_t NumAllocatedChunks() const { return m_allocated_chunks.size(); }
+    std::size_t ChunkSizeBytes() const { return m_chunk_size_bytes; }
+};
+
+/**
+ * Allocator that takes its memory from a PoolResource. Containers using it must be
+ * constructed with a pointer to the resource, which has to outlive them.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class PoolAllocator
+{
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* m_resource;
+
+    template <typename U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+public:
+    typedef T value_type;
+    typedef PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> ResourceType;
+
+    PoolAllocator(ResourceType* resource) noexcept : m_resource(resource) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : m_resource(other.m_resource) {}
+
+    // the non-type template parameters keep allocator_traits from rebinding on its own
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType* resource() const noexcept { return m_resource; }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const noexcept
+    {
+        return m_resource == other.m_resource;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const noexcept
+    {
+        return m_resource != other.m_resource;
+    }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
@@ -26,6 +26,23 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+static thread_local CLockWaitTracker* g_lock_wait_tracker = nullptr;
+
+CLockWaitTracker::CLockWaitTracker(const void* csIn) : cs(csIn), nWaitMicros(0), nWaits(0), prev(g_lock_wait_tracker)
+{
+    g_lock_wait_tracker = this;
+}
+
+CLockWaitTracker::~CLockWaitTracker()
+{
+    g_lock_wait_tracker = prev;
+}
+
+CLockWaitTracker* CLockWaitTracker::Current()
+{
+    return g_lock_wait_tracker;
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -11,6 +11,8 @@
 #include "threadsafety.h"
 #include "util/macros.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <thread>
 #include <mutex>
@@ -116,6 +118,29 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * While in scope, adds up the time the current thread spends blocked acquiring
+ * one particular mutex (e.g. cs_main while handling a network message).
+ * An inner tracker suspends the outer one until it goes out of scope.
+ */
+class CLockWaitTracker
+{
+public:
+    explicit CLockWaitTracker(const void* csIn);
+    ~CLockWaitTracker();
+
+    /** Tracker of the current thread, if any */
+    static CLockWaitTracker* Current();
+
+    const void* const cs;
+    int64_t nWaitMicros;
+    //! acquisitions that had to wait, counted before blocking
+    std::atomic<int> nWaits;
+
+private:
+    CLockWaitTracker* const prev;
+};
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock  : public Base
@@ -124,14 +149,29 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
-#ifdef DEBUG_LOCKCONTENTION
-        if (!Base::try_lock()) {
-            PrintLockContention(pszName, pszFile, nLine);
+        // Only a tracked mutex, or lock contention debugging, tries the lock first
+        CLockWaitTracker* tracker = CLockWaitTracker::Current();
+        if (tracker && tracker->cs != (const void*)(Base::mutex()))
+            tracker = nullptr;
+#ifndef DEBUG_LOCKCONTENTION
+        if (!tracker) {
+            Base::lock();
+            return;
+        }
 #endif
-        Base::lock();
+        if (Base::try_lock())
+            return;
 #ifdef DEBUG_LOCKCONTENTION
-        }
+        PrintLockContention(pszName, pszFile, nLine);
 #endif
+        if (tracker) {
+            const auto start = std::chrono::steady_clock::now();
+            tracker->nWaits++;
+            Base::lock();
+            tracker->nWaitMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        } else {
+            Base::lock();
+        }
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
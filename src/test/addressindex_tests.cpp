@@ -0,0 +1,118 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "txdb.h"
+#include "undo.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+static CScript ScriptForKey(uint64_t n)
+{
+    return GetScriptForDestination(CKeyID(uint160(n)));
+}
+
+static CTransaction MakeTx(const std::vector<COutPoint>& vPrevouts, const std::vector<CTxOut>& vOut)
+{
+    CMutableTransaction tx;
+    for (const COutPoint& prevout : vPrevouts)
+        tx.vin.emplace_back(prevout);
+    if (tx.vin.empty())
+        tx.vin.emplace_back(); // a coinbase
+    tx.vout = vOut;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_key_order)
+{
+    // the entries of an address are ordered by height, then by position in the block
+    CDataStream ss1(SER_DISK, CLIENT_VERSION), ss2(SER_DISK, CLIENT_VERSION), ss3(SER_DISK, CLIENT_VERSION);
+    ss1 << CAddressIndexKey(ADDRESS_INDEX_KEY, uint160(1), 255, 7, uint256(9), 0, false);
+    ss2 << CAddressIndexKey(ADDRESS_INDEX_KEY, uint160(1), 256, 1, uint256(1), 0, false);
+    ss3 << CAddressIndexKey(ADDRESS_INDEX_KEY, uint160(1), 256, 2, uint256(1), 0, false);
+    BOOST_CHECK(ss1.str() < ss2.str());
+    BOOST_CHECK(ss2.str() < ss3.str());
+
+    CAddressIndexKey key;
+    ss3 >> key;
+    BOOST_CHECK_EQUAL(key.blockHeight, 256);
+    BOOST_CHECK_EQUAL(key.txindex, 2U);
+    BOOST_CHECK(!key.spending);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_connect_disconnect)
+{
+    CBlockTreeDB db(1 << 20, true);
+
+    // block 1 pays key 1 twice and key 2 once
+    CBlock block1;
+    block1.vtx.push_back(MakeTx({}, {CTxOut(10 * COIN, ScriptForKey(1)), CTxOut(5 * COIN, ScriptForKey(2))}));
+    block1.vtx.push_back(MakeTx({COutPoint(uint256(100), 0)}, {CTxOut(3 * COIN, ScriptForKey(1))}));
+    CBlockUndo undo1;
+    undo1.vtxundo.emplace_back();
+    undo1.vtxundo.back().vprevout.emplace_back(CTxOut(3 * COIN, CScript() << OP_TRUE), 0, false, false);
+
+    // block 2 spends the first output of key 1 into an output of key 2, which it spends again
+    CBlock block2;
+    block2.vtx.push_back(MakeTx({}, {}));
+    block2.vtx.push_back(MakeTx({COutPoint(block1.vtx[0].GetHash(), 0)}, {CTxOut(9 * COIN, ScriptForKey(2))}));
+    block2.vtx.push_back(MakeTx({COutPoint(block2.vtx[1].GetHash(), 0)}, {CTxOut(8 * COIN, ScriptForKey(3))}));
+    CBlockUndo undo2;
+    undo2.vtxundo.resize(2);
+    undo2.vtxundo[0].vprevout.emplace_back(block1.vtx[0].vout[0], 1, true, false);
+    undo2.vtxundo[1].vprevout.emplace_back(block2.vtx[1].vout[0], 2, false, false);
+
+    CAddressIndexBlock changes1, changes2;
+    GetAddressIndexChanges(block1, undo1, 1, changes1);
+    GetAddressIndexChanges(block2, undo2, 2, changes2);
+    BOOST_CHECK(db.WriteAddressIndex(changes1));
+    BOOST_CHECK(db.WriteAddressIndex(changes2));
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    BOOST_CHECK(db.ReadAddressIndex(ADDRESS_INDEX_KEY, uint160(1), vEntries));
+    BOOST_CHECK_EQUAL(vEntries.size(), 3U);
+    CAmount nBalance = 0;
+    for (const auto& entry : vEntries)
+        nBalance += entry.second;
+    BOOST_CHECK_EQUAL(nBalance, 3 * COIN);
+    BOOST_CHECK_EQUAL(vEntries.back().first.blockHeight, 2);
+    BOOST_CHECK(vEntries.back().first.spending);
+
+    // the range of a single height
+    vEntries.clear();
+    BOOST_CHECK(db.ReadAddressIndex(ADDRESS_INDEX_KEY, uint160(2), vEntries, 2, 2));
+    BOOST_CHECK_EQUAL(vEntries.size(), 2U);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(ADDRESS_INDEX_KEY, uint160(1), vUnspent));
+    BOOST_CHECK_EQUAL(vUnspent.size(), 1U);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.satoshis, 3 * COIN);
+    // the output of key 2 created and spent in block 2 is not left behind
+    vUnspent.clear();
+    BOOST_CHECK(db.ReadAddressUnspentIndex(ADDRESS_INDEX_KEY, uint160(2), vUnspent));
+    BOOST_CHECK_EQUAL(vUnspent.size(), 1U);
+    BOOST_CHECK(vUnspent[0].first.txhash == block1.vtx[0].GetHash());
+
+    // disconnecting block 2 restores the state after block 1
+    BOOST_CHECK(db.EraseAddressIndex(changes2));
+    vUnspent.clear();
+    BOOST_CHECK(db.ReadAddressUnspentIndex(ADDRESS_INDEX_KEY, uint160(1), vUnspent));
+    BOOST_CHECK_EQUAL(vUnspent.size(), 2U);
+    BOOST_CHECK_EQUAL(vUnspent[0].second.blockHeight, 1);
+    vEntries.clear();
+    BOOST_CHECK(db.ReadAddressIndex(ADDRESS_INDEX_KEY, uint160(3), vEntries));
+    BOOST_CHECK(vEntries.empty());
+
+    BOOST_CHECK(db.WipeAddressIndex());
+    vEntries.clear();
+    BOOST_CHECK(db.ReadAddressIndex(ADDRESS_INDEX_KEY, uint160(1), vEntries));
+    BOOST_CHECK(vEntries.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
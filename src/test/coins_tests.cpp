@@ -7,6 +7,7 @@
 #include "coins.h"
 #include "main.h"
 #include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
 #include "undo.h"
 #include "utilstrencodings.h"
@@ -550,7 +551,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -812,4 +814,140 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+static std::vector<std::pair<COutPoint, CAmount> > ReadCursor(const CCoinsView& view)
+{
+    std::vector<std::pair<COutPoint, CAmount> > vCoins;
+    std::unique_ptr<CCoinsViewCursor> pcursor(view.Cursor());
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        BOOST_CHECK(pcursor->GetKey(key));
+        BOOST_CHECK(pcursor->GetValue(coin));
+        vCoins.emplace_back(key, coin.out.nValue);
+    }
+    return vCoins;
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_async_flush)
+{
+    // the same changes written synchronously and through the writer thread
+    CCoinsViewDB dbSync(1 << 20, true, true);
+    CCoinsViewDB dbAsync(1 << 20, true, true);
+    const uint256 hash1 = GetRandHash(), hash2 = GetRandHash();
+    const uint256 block1 = GetRandHash(), block2 = GetRandHash();
+
+    for (CCoinsViewDB* db : {&dbSync, &dbAsync}) {
+        CCoinsViewCache cache(db);
+        // indexes on both sides of the VARINT length changes, which do not sort numerically
+        for (uint32_t n : {0U, 1U, 127U, 128U, 16511U, 16512U, 70000U})
+            cache.AddCoin(COutPoint(hash1, n), Coin(CTxOut(n + 1, CScript() << OP_TRUE), 1, false, false), false);
+        cache.AddCoin(COutPoint(hash2, 5), Coin(CTxOut(5, CScript() << OP_TRUE), 1, false, false), false);
+        cache.SetBestBlock(block1);
+        BOOST_CHECK(cache.Flush());
+    }
+
+    for (CCoinsViewDB* db : {&dbSync, &dbAsync}) {
+        CCoinsViewCache cache(db);
+        cache.SpendCoin(COutPoint(hash1, 128));
+        cache.SpendCoin(COutPoint(hash2, 5));
+        cache.AddCoin(COutPoint(hash2, 16512), Coin(CTxOut(7, CScript() << OP_TRUE), 2, false, false), false);
+        cache.SetBestBlock(block2);
+        BOOST_CHECK(cache.Flush(db == &dbAsync));
+    }
+
+    // reads through the async view see the second flush whether or not it is committed yet
+    std::vector<std::pair<COutPoint, CAmount> > vExpected = ReadCursor(dbSync);
+    BOOST_CHECK_EQUAL(vExpected.size(), 7U);
+    BOOST_CHECK(ReadCursor(dbAsync) == vExpected);
+    BOOST_CHECK(dbAsync.GetBestBlock() == block2);
+    BOOST_CHECK(!dbAsync.HaveCoin(COutPoint(hash1, 128)));
+    Coin coin;
+    BOOST_CHECK(dbAsync.GetCoin(COutPoint(hash2, 16512), coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 7);
+
+    dbAsync.WaitForFlush();
+    BOOST_CHECK_EQUAL(dbAsync.PendingWriteUsage(), 0U);
+    BOOST_CHECK(ReadCursor(dbAsync) == vExpected);
+    BOOST_CHECK(dbAsync.GetBestBlock() == block2);
+}
+
+// A coins database with access to its raw records
+class CCoinsViewDBRaw : public CCoinsViewDB
+{
+public:
+    CCoinsViewDBRaw() : CCoinsViewDB(1 << 20, true, true) {}
+    CDBWrapper& Raw() { return db; }
+};
+
+// Key of a per-txout coin before the compact format
+struct LegacyCoinKey
+{
+    COutPoint outpoint;
+    explicit LegacyCoinKey(const COutPoint& outpointIn) : outpoint(outpointIn) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << 'C' << outpoint.hash << VARINT(outpoint.n);
+    }
+};
+
+static size_t CountLegacyCoins(CCoinsViewDBRaw& db)
+{
+    size_t count = 0;
+    std::unique_ptr<CDBIterator> pcursor(db.Raw().NewIterator());
+    for (pcursor->Seek('C'); pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != 'C')
+            break;
+        count++;
+    }
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_upgrade_legacy)
+{
+    CCoinsViewDBRaw db;
+    std::vector<std::pair<COutPoint, Coin> > vLegacy;
+    CDBBatch batch;
+    for (int i = 0; i < 50; i++) {
+        const COutPoint outpoint(GetRandHash(), i % 3 == 0 ? 200 + i : i);
+        const Coin coin(CTxOut(i * COIN + 1, CScript() << OP_TRUE), 1000 + i, i % 4 == 0, i % 5 == 0);
+        batch.Write(LegacyCoinKey(outpoint), coin);
+        vLegacy.emplace_back(outpoint, coin);
+    }
+    BOOST_CHECK(db.Raw().WriteBatch(batch));
+    BOOST_CHECK_EQUAL(CountLegacyCoins(db), 50U);
+
+    // one coin per batch, stopped after ten of them
+    int nBatches = 0;
+    BOOST_CHECK(db.Upgrade(1, [&nBatches]() { return ++nBatches == 10; }));
+    BOOST_CHECK_EQUAL(CountLegacyCoins(db), 40U);
+    size_t nMoved = 0;
+    for (const auto& entry : vLegacy)
+        nMoved += db.HaveCoin(entry.first);
+    BOOST_CHECK_EQUAL(nMoved, 10U);
+
+    // the next start carries on where it stopped
+    BOOST_CHECK(db.Upgrade(1, []() { return false; }));
+    BOOST_CHECK_EQUAL(CountLegacyCoins(db), 0U);
+    for (const auto& entry : vLegacy) {
+        Coin coin;
+        BOOST_CHECK(db.GetCoin(entry.first, coin));
+        BOOST_CHECK(coin.out == entry.second.out);
+        BOOST_CHECK_EQUAL(coin.nHeight, entry.second.nHeight);
+        BOOST_CHECK_EQUAL(coin.fCoinBase, entry.second.fCoinBase);
+        BOOST_CHECK_EQUAL(coin.fCoinStake, entry.second.fCoinStake);
+    }
+    BOOST_CHECK_EQUAL(ReadCursor(db).size(), 50U);
+
+    // the format is marked, and a newer one is refused
+    const std::pair<char, uint256> formatKey('c', uint256());
+    unsigned char nFormat = 0;
+    BOOST_CHECK(db.Raw().Read(formatKey, nFormat));
+    BOOST_CHECK_EQUAL(nFormat, 1);
+    BOOST_CHECK(db.Raw().Write(formatKey, (unsigned char)(nFormat + 1)));
+    BOOST_CHECK(!db.Upgrade());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
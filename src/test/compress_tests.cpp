@@ -3,7 +3,11 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "coins.h"
 #include "compressor.h"
+#include "key.h"
+#include "script/standard.h"
+#include "streams.h"
 #include "util.h"
 #include "test/test_pivx.h"
 
@@ -63,4 +67,58 @@ BOOST_AUTO_TEST_CASE(compress_amounts)
         BOOST_CHECK(TestDecode(i));
 }
 
+static size_t CompactCoinRoundTrip(const Coin& coin)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CCoinCompressor(REF(coin));
+    const size_t nSize = ss.size();
+
+    Coin decoded;
+    CCoinCompressor compact(decoded);
+    ss >> compact;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK(decoded.out == coin.out);
+    BOOST_CHECK_EQUAL(decoded.nHeight, coin.nHeight);
+    BOOST_CHECK_EQUAL(decoded.fCoinBase, coin.fCoinBase);
+    BOOST_CHECK_EQUAL(decoded.fCoinStake, coin.fCoinStake);
+    return nSize;
+}
+
+static size_t LegacyCoinSize(const Coin& coin)
+{
+    return ::GetSerializeSize(coin, SER_DISK, CLIENT_VERSION);
+}
+
+BOOST_AUTO_TEST_CASE(compress_coins)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CKey keyUncompressed;
+    keyUncompressed.MakeNewKey(false);
+
+    std::vector<CScript> scripts;
+    scripts.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+    scripts.push_back(GetScriptForDestination(CScriptID(CScript() << OP_TRUE)));
+    scripts.push_back(GetScriptForRawPubKey(key.GetPubKey()));
+    scripts.push_back(GetScriptForRawPubKey(keyUncompressed.GetPubKey()));
+    scripts.push_back(GetScriptForMultisig(1, {key.GetPubKey(), keyUncompressed.GetPubKey()}));
+    scripts.push_back(CScript());
+
+    for (uint32_t nHeight : {0U, 1U, 7U, 8U, 1234567U, 0x3fffffffU}) {
+        for (const CScript& script : scripts) {
+            for (CAmount nValue : {(CAmount)0, (CAmount)1, 50 * COIN, (CAmount)123456789}) {
+                CompactCoinRoundTrip(Coin(CTxOut(nValue, script), nHeight, nHeight % 2, nHeight % 3 == 0));
+            }
+        }
+    }
+
+    // a byte less than the Coin format for special scripts past height 528416, two for the
+    // empty output that starts a coinstake
+    const Coin p2pkh(CTxOut(50 * COIN, scripts[0]), 1000000, false, true);
+    BOOST_CHECK_EQUAL(CompactCoinRoundTrip(p2pkh) + 1, LegacyCoinSize(p2pkh));
+    const Coin marker(CTxOut(0, CScript()), 1000000, false, true);
+    BOOST_CHECK_EQUAL(CompactCoinRoundTrip(marker), 4U);
+    BOOST_CHECK_EQUAL(LegacyCoinSize(marker), 6U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
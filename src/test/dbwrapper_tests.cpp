@@ -114,4 +114,52 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profile)
+{
+    CDBProfile profile;
+    std::string strError;
+    BOOST_CHECK(ParseDBProfile("nvme,compression=1,cache=40", profile, strError));
+    BOOST_CHECK_EQUAL(profile.nMaxOpenFiles, 1000);
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 16 * 1024);
+    BOOST_CHECK(profile.fCompression);
+    BOOST_CHECK_EQUAL(profile.nCachePercent, 40);
+
+    // a preset resets earlier settings
+    BOOST_CHECK(ParseDBProfile("blocksize=64,default", profile, strError));
+    BOOST_CHECK_EQUAL(profile.nBlockSize, 4096);
+    BOOST_CHECK_EQUAL(profile.nCachePercent, -1);
+
+    BOOST_CHECK(!ParseDBProfile("fast", profile, strError));
+    BOOST_CHECK(!ParseDBProfile("cache=101", profile, strError));
+    BOOST_CHECK(!ParseDBProfile("maxopenfiles=x", profile, strError));
+    BOOST_CHECK(!ParseDBProfile("blocksize=0", profile, strError));
+    BOOST_CHECK(!ParseDBProfile("readahead=1", profile, strError));
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compact_stats)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    {
+        CDBWrapper dbw(ph, (1 << 20), true, false, "dbwrapper_test");
+        BOOST_CHECK_EQUAL(FindDBWrapper("dbwrapper_test"), &dbw);
+
+        for (int i = 0; i < 1000; i++)
+            BOOST_CHECK(dbw.Write(i, GetRandHash()));
+        uint256 res;
+        BOOST_CHECK(dbw.Read(1, res));
+        BOOST_CHECK(!dbw.Read(1000, res));
+
+        BOOST_CHECK(dbw.Compact());
+        CDBStats stats = dbw.GetStats();
+        BOOST_CHECK_EQUAL(stats.nReads, 2U);
+        BOOST_CHECK_EQUAL(stats.nReadBytes, 32U);
+        BOOST_CHECK_EQUAL(stats.nWriteBatches, 1000U);
+        BOOST_CHECK(!stats.fCompacting);
+        BOOST_CHECK(stats.nLastCompactionEnd > 0);
+        // everything has been pushed out of the memtable into table files
+        BOOST_CHECK(!stats.vLevels.empty());
+    }
+    BOOST_CHECK(FindDBWrapper("dbwrapper_test") == NULL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
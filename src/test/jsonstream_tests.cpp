@@ -0,0 +1,104 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+#include "test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+static UniValue MakeEntry(int n)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("n", n);
+    entry.pushKV("name", "entry \"" + std::to_string(n) + "\"\n");
+    UniValue list(UniValue::VARR);
+    for (int i = 0; i < n % 4; i++)
+        list.push_back(i);
+    entry.pushKV("list", list);
+    return entry;
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_matches_univalue)
+{
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("first", NullUniValue);
+    UniValue entries(UniValue::VARR);
+    for (int n = 0; n < 200; n++)
+        entries.push_back(MakeEntry(n));
+    expected.pushKV("entries", entries);
+    expected.pushKV("empty", UniValue(UniValue::VARR));
+    expected.pushKV("last", UniValue(true));
+
+    // a small flush size, so that the document reaches the sink in many pieces
+    std::vector<std::string> vChunks;
+    JSONStreamWriter stream([&vChunks](const std::string& strChunk) { vChunks.push_back(strChunk); }, 100);
+    stream.BeginObject();
+    stream.KeyValue("first", NullUniValue);
+    stream.Key("entries");
+    stream.BeginArray();
+    for (int n = 0; n < 200; n++)
+        stream.Value(MakeEntry(n));
+    stream.EndArray();
+    stream.Key("empty");
+    stream.BeginArray();
+    stream.EndArray();
+    stream.Key("last");
+    BOOST_CHECK(stream.AwaitingValue());
+    stream.Value(true);
+    BOOST_CHECK(!stream.AwaitingValue());
+    stream.EndObject();
+    BOOST_CHECK(stream.Flushed());
+    stream.Flush();
+
+    BOOST_CHECK(vChunks.size() > 10);
+    std::string strStreamed;
+    for (const std::string& strChunk : vChunks)
+        strStreamed += strChunk;
+    BOOST_CHECK_EQUAL(strStreamed, expected.write());
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_small_document_stays_buffered)
+{
+    bool fSunk = false;
+    JSONStreamWriter stream([&fSunk](const std::string&) { fSunk = true; });
+    stream.BeginObject();
+    stream.KeyValues(MakeEntry(3));
+    stream.EndObject();
+    BOOST_CHECK(!fSunk);
+    BOOST_CHECK(!stream.Flushed());
+    BOOST_CHECK_EQUAL(stream.GetBuffer(), MakeEntry(3).write());
+}
+
+BOOST_AUTO_TEST_CASE(jsonresultstream)
+{
+    // collected into the returned value without a stream
+    JSONResultStream collected(nullptr, UniValue::VOBJ);
+    collected.pushKV("a", MakeEntry(1));
+    collected.pushKV("b", MakeEntry(2));
+    const UniValue result = collected.Finish();
+    BOOST_CHECK_EQUAL(result.size(), 2U);
+
+    // written out in the result position of a reply with one
+    std::string strStreamed;
+    JSONStreamWriter stream([&strStreamed](const std::string& strChunk) { strStreamed += strChunk; }, 16);
+    stream.BeginObject();
+    stream.Key("result");
+    JSONResultStream streamed(&stream, UniValue::VOBJ);
+    streamed.pushKV("a", MakeEntry(1));
+    streamed.pushKV("b", MakeEntry(2));
+    BOOST_CHECK(streamed.Finish().isNull());
+    BOOST_CHECK(!stream.AwaitingValue());
+    stream.KeyValue("error", NullUniValue);
+    stream.EndObject();
+    stream.Flush();
+
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("result", result);
+    expected.pushKV("error", NullUniValue);
+    BOOST_CHECK_EQUAL(strStreamed, expected.write());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
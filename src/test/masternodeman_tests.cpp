@@ -0,0 +1,72 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternodeman.h"
+#include "netbase.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, BasicTestingSetup)
+
+static CMasternode MakeMasternode(uint64_t n)
+{
+    CMasternode mn;
+    CKey key;
+    key.MakeNewKey(true);
+    mn.vin = CTxIn(COutPoint(uint256(n), 0));
+    mn.addr = LookupNumeric("8.8.8.8", 51472 + (int)n);
+    mn.pubKeyCollateralAddress = key.GetPubKey();
+    mn.pubKeyMasternode = key.GetPubKey();
+    return mn;
+}
+
+BOOST_AUTO_TEST_CASE(masternode_list_snapshot)
+{
+    mnodeman.Clear();
+
+    std::shared_ptr<const CMasternodeListSnapshot> snapshot1 = mnodeman.GetListSnapshot();
+    BOOST_CHECK_EQUAL(snapshot1->nCount, 0);
+    BOOST_CHECK(snapshot1->vInvMessages.empty());
+    // as long as the list does not change, every request gets the same reply
+    BOOST_CHECK(mnodeman.GetListSnapshot() == snapshot1);
+
+    CMasternode mn1 = MakeMasternode(1);
+    CMasternode mn2 = MakeMasternode(2);
+    BOOST_CHECK(mnodeman.Add(mn1));
+    BOOST_CHECK(mnodeman.Add(mn2));
+    std::shared_ptr<const CMasternodeListSnapshot> snapshot2 = mnodeman.GetListSnapshot();
+    BOOST_CHECK(snapshot2 != snapshot1);
+    BOOST_CHECK(snapshot2->nVersion > snapshot1->nVersion);
+    BOOST_CHECK_EQUAL(snapshot2->nCount, 2);
+    BOOST_CHECK_EQUAL(snapshot2->vInvMessages.size(), 1U);
+    BOOST_CHECK(mnodeman.GetListSnapshot() == snapshot2);
+
+    const uint256 hash1 = CMasternodeBroadcast(mn1).GetHash();
+    BOOST_CHECK(mnodeman.HaveSeenBroadcast(hash1));
+
+    mnodeman.Remove(mn2.vin);
+    std::shared_ptr<const CMasternodeListSnapshot> snapshot3 = mnodeman.GetListSnapshot();
+    BOOST_CHECK(snapshot3->nVersion > snapshot2->nVersion);
+    BOOST_CHECK_EQUAL(snapshot3->nCount, 1);
+
+    // the broadcast is framed once for all the getdata, and again after a newer ping
+    CSharedNetMsg msg1, msg2, msg3;
+    BOOST_CHECK(mnodeman.GetBroadcastMessage(hash1, msg1));
+    BOOST_CHECK(mnodeman.GetBroadcastMessage(hash1, msg2));
+    BOOST_CHECK(msg1.data == msg2.data);
+
+    CMasternodePing mnp(mn1.vin);
+    mnp.sigTime = GetAdjustedTime() + 60;
+    mnodeman.UpdateSeenBroadcastPing(hash1, mnp);
+    BOOST_CHECK(mnodeman.GetBroadcastMessage(hash1, msg3));
+    BOOST_CHECK(msg3.data != msg1.data);
+    BOOST_CHECK(*msg3.data != *msg1.data);
+
+    BOOST_CHECK(!mnodeman.GetBroadcastMessage(uint256(3), msg3));
+
+    mnodeman.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
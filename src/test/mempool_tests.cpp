@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "miner.h"
+#include "policy/policy.h"
 #include "test_pivx.h"
 #include "txmempool.h"
 #include "util.h"
@@ -318,6 +320,112 @@ BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
     CheckSort<3>(pool, sortedOrder);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAncestorStateTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // A low fee parent with a high fee child, and an unrelated transaction in between
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(1);
+    txParent.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txParent.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(1000).SigOps(1).FromTx(txParent));
+
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 9 * COIN;
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(50000).SigOps(2).FromTx(txChild));
+
+    CMutableTransaction txOther;
+    txOther.vin.resize(1);
+    txOther.vin[0].scriptSig = CScript() << OP_12;
+    txOther.vout.resize(1);
+    txOther.vout[0].scriptPubKey = CScript() << OP_12 << OP_EQUAL;
+    txOther.vout[0].nValue = 10 * COIN;
+    pool.addUnchecked(txOther.GetHash(), entry.Fee(20000).SigOps(1).FromTx(txOther));
+
+    const uint64_t nParentSize = ::GetSerializeSize(txParent, SER_NETWORK, PROTOCOL_VERSION);
+    const uint64_t nChildSize = ::GetSerializeSize(txChild, SER_NETWORK, PROTOCOL_VERSION);
+    CTxMemPool::txiter childIt = pool.mapTx.find(txChild.GetHash());
+    BOOST_CHECK_EQUAL(childIt->GetCountWithAncestors(), 2);
+    BOOST_CHECK_EQUAL(childIt->GetSizeWithAncestors(), nParentSize + nChildSize);
+    BOOST_CHECK_EQUAL(childIt->GetModFeesWithAncestors(), 51000);
+    BOOST_CHECK_EQUAL(childIt->GetSigOpCountWithAncestors(), 3);
+
+    // Prioritising the parent carries over to the child's package
+    pool.PrioritiseTransaction(txParent.GetHash(), txParent.GetHash().ToString(), 0, 500);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txChild.GetHash())->GetModFeesWithAncestors(), 51500);
+
+    // The child pays for its parent: the package goes in ahead of the unrelated transaction
+    {
+        LOCK(pool.cs);
+        CBlockTxSelection selection;
+        SelectBlockTransactions(pool, 1, 0, DEFAULT_BLOCK_MAX_SIZE, 0, 0, selection);
+        BOOST_CHECK_EQUAL(selection.vtx.size(), 3);
+        BOOST_CHECK(selection.vtx[0].GetHash() == txParent.GetHash());
+        BOOST_CHECK(selection.vtx[1].GetHash() == txChild.GetHash());
+        BOOST_CHECK(selection.vtx[2].GetHash() == txOther.GetHash());
+        BOOST_CHECK_EQUAL(selection.nFees, 71000);
+    }
+
+    // Once the parent is mined, the child is a package on its own
+    std::list<CTransaction> removed;
+    pool.remove(txParent, removed, false);
+    childIt = pool.mapTx.find(txChild.GetHash());
+    BOOST_CHECK_EQUAL(childIt->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(childIt->GetSizeWithAncestors(), nChildSize);
+    BOOST_CHECK_EQUAL(childIt->GetModFeesWithAncestors(), 50000);
+    BOOST_CHECK_EQUAL(childIt->GetSigOpCountWithAncestors(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSelectionInputsTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // A transaction spending a confirmed coin, its child, and one whose input is gone
+    CCoinsViewCache view(pcoinsTip);
+    const COutPoint outpointConfirmed(uint256(1), 0);
+    view.AddCoin(outpointConfirmed, Coin(CTxOut(10 * COIN, CScript() << OP_TRUE), 1, false, false), false);
+
+    CMutableTransaction txParent;
+    txParent.vin.emplace_back(outpointConfirmed);
+    txParent.vout.emplace_back(9 * COIN, CScript() << OP_TRUE);
+    pool.addUnchecked(txParent.GetHash(), entry.Fee(COIN).FromTx(txParent));
+
+    CMutableTransaction txChild;
+    txChild.vin.emplace_back(COutPoint(txParent.GetHash(), 0));
+    txChild.vout.emplace_back(8 * COIN, CScript() << OP_TRUE);
+    pool.addUnchecked(txChild.GetHash(), entry.Fee(COIN).FromTx(txChild));
+
+    CMutableTransaction txMissing;
+    txMissing.vin.emplace_back(COutPoint(uint256(2), 0));
+    txMissing.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    pool.addUnchecked(txMissing.GetHash(), entry.Fee(2 * COIN).FromTx(txMissing));
+
+    LOCK2(cs_main, pool.cs);
+    CBlockTxSelection selection;
+    SelectBlockTransactions(pool, 2, 0, DEFAULT_BLOCK_MAX_SIZE, 0, 0, selection);
+    BOOST_CHECK_EQUAL(selection.vtx.size(), 3);
+
+    // checked against the coins, the transaction with the missing input is left out
+    // while the child spends the output of the parent selected before it
+    CBlockTxSelection selectionChecked;
+    SelectBlockTransactions(pool, 2, 0, DEFAULT_BLOCK_MAX_SIZE, 0, 0, selectionChecked, &view);
+    BOOST_CHECK_EQUAL(selectionChecked.vtx.size(), 2);
+    BOOST_CHECK(selectionChecked.vtx[0].GetHash() == txParent.GetHash());
+    BOOST_CHECK(selectionChecked.vtx[1].GetHash() == txChild.GetHash());
+    BOOST_CHECK_EQUAL(selectionChecked.nFees, 2 * COIN);
+    // the view given is left as it was
+    BOOST_CHECK(!view.HaveCoin(COutPoint(txParent.GetHash(), 0)));
+}
 
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
@@ -177,4 +177,100 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(concurrent_message_types)
+{
+    // Masternode list, spork, address and ping traffic may bypass the main message handler thread
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::MNBROADCAST));
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::MNPING));
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::GETMNLIST));
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::SPORK));
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::ADDR));
+    BOOST_CHECK(IsConcurrentNetMessageType(NetMsgType::PING));
+    // anything touching consensus state may not
+    BOOST_CHECK(!IsConcurrentNetMessageType(NetMsgType::VERSION));
+    BOOST_CHECK(!IsConcurrentNetMessageType(NetMsgType::BLOCK));
+    BOOST_CHECK(!IsConcurrentNetMessageType(NetMsgType::TX));
+    BOOST_CHECK(!IsConcurrentNetMessageType(NetMsgType::GETDATA));
+    BOOST_CHECK(!IsConcurrentNetMessageType(NetMsgType::MNWINNER));
+    BOOST_CHECK(!IsConcurrentNetMessageType("unknown"));
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram)
+{
+    CLatencyHistogram hist;
+    hist.Add(0);
+    hist.Add(MSG_LATENCY_BUCKETS[0]);     // bounds are inclusive
+    hist.Add(MSG_LATENCY_BUCKETS[0] + 1);
+    hist.Add(MSG_LATENCY_BUCKETS[MSG_LATENCY_BUCKETS_SIZE - 1] + 1);
+    BOOST_CHECK_EQUAL(hist.nCount, 4U);
+    BOOST_CHECK_EQUAL(hist.vBuckets[0], 2U);
+    BOOST_CHECK_EQUAL(hist.vBuckets[1], 1U);
+    BOOST_CHECK_EQUAL(hist.vBuckets[MSG_LATENCY_BUCKETS_SIZE], 1U);
+    BOOST_CHECK_EQUAL(hist.nMax, MSG_LATENCY_BUCKETS[MSG_LATENCY_BUCKETS_SIZE - 1] + 1);
+    BOOST_CHECK_EQUAL(hist.nTotal, 2 * MSG_LATENCY_BUCKETS[0] + 1 + hist.nMax);
+}
+
+#ifndef WIN32
+static std::vector<unsigned char> ReadAvailable(int fd)
+{
+    std::vector<unsigned char> vRead;
+    unsigned char buf[4096];
+    ssize_t nRead;
+    while ((nRead = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        vRead.insert(vRead.end(), buf, buf + nRead);
+    return vRead;
+}
+
+BOOST_AUTO_TEST_CASE(shared_message_send)
+{
+    CConnman connman(0x1337, 0x1337);
+
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+
+    int fds1[2], fds2[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds1) == 0);
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds2) == 0);
+    CNode node1(0, NODE_NETWORK, 0, fds1[0], addr, 0, 0, "", true);
+    CNode node2(1, NODE_NETWORK, 0, fds2[0], addr, 1, 1, "", true);
+
+    CSerializedNetMsg msg;
+    msg.command = "block";
+    msg.data.assign(1000, 0x42);
+    std::vector<unsigned char> vPayload = msg.data;
+    CSharedNetMsg shared = CConnman::MakeSharedMessage(std::move(msg));
+    BOOST_CHECK_EQUAL(shared.header->size(), CMessageHeader::HEADER_SIZE);
+    BOOST_CHECK(*shared.data == vPayload);
+
+    // The same buffers end up on both wires, header first
+    connman.PushMessage(&node1, shared);
+    connman.PushMessage(&node2, shared);
+    std::vector<unsigned char> vExpected(*shared.header);
+    vExpected.insert(vExpected.end(), vPayload.begin(), vPayload.end());
+    BOOST_CHECK(ReadAvailable(fds1[1]) == vExpected);
+    BOOST_CHECK(ReadAvailable(fds2[1]) == vExpected);
+    BOOST_CHECK(node1.vSendMsg.empty());
+    BOOST_CHECK_EQUAL(node1.nSendSize, 0U);
+    BOOST_CHECK_EQUAL(node1.nSendBytes, vExpected.size());
+
+    // A message built from a CSerializedNetMsg goes out identically
+    CSerializedNetMsg msg2;
+    msg2.command = "block";
+    msg2.data = vPayload;
+    connman.PushMessage(&node1, std::move(msg2));
+    connman.PushMessage(&node1, shared);
+    std::vector<unsigned char> vTwice(vExpected);
+    vTwice.insert(vTwice.end(), vExpected.begin(), vExpected.end());
+    BOOST_CHECK(ReadAvailable(fds1[1]) == vTwice);
+    BOOST_CHECK(node1.vSendMsg.empty());
+    CNodeStats stats;
+    node1.copyStats(stats);
+    BOOST_CHECK_EQUAL(stats.mapSendBytesPerMsgCmd["block"], 3 * vExpected.size());
+
+    close(fds1[1]);
+    close(fds2[1]);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
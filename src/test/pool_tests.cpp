@@ -0,0 +1,69 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memusage.h"
+#include "support/allocators/pool.h"
+#include "test/test_pivx.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/unordered_map.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<64, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // blocks are handed out back to back from one chunk
+    void* a = resource.Allocate(24, 8);
+    void* b = resource.Allocate(24, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK_EQUAL(static_cast<char*>(b) - static_cast<char*>(a), 24);
+
+    // a freed block is reused for the same size, but not for another one
+    resource.Deallocate(a, 24, 8);
+    void* c = resource.Allocate(32, 8);
+    BOOST_CHECK(c != a);
+    BOOST_CHECK_EQUAL(resource.Allocate(20, 8), a);
+
+    // too big for the pool
+    void* big = resource.Allocate(65, 8);
+    resource.Deallocate(big, 65, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // running out of a chunk gets a new one
+    for (int i = 0; i < 32; i++)
+        resource.Allocate(64, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 3U);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_allocator_unordered_map)
+{
+    typedef PoolAllocator<std::pair<const int, int64_t>, sizeof(std::pair<const int, int64_t>) + sizeof(void*) * 4, alignof(void*)> Allocator;
+    typedef boost::unordered_map<int, int64_t, boost::hash<int>, std::equal_to<int>, Allocator> Map;
+
+    Allocator::ResourceType resource;
+    {
+        Map map(0, Map::hasher(), Map::key_equal(), &resource);
+        for (int i = 0; i < 100000; i++)
+            map[i] = i * 3;
+        for (int i = 0; i < 100000; i += 2)
+            map.erase(i);
+        const size_t nChunks = resource.NumAllocatedChunks();
+        // erased nodes are reused rather than taking more chunks
+        for (int i = 0; i < 100000; i += 2)
+            map[i] = i;
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), nChunks);
+        BOOST_CHECK_EQUAL(map.size(), 100000U);
+        BOOST_CHECK_EQUAL(map[7], 21);
+
+        BOOST_CHECK(memusage::DynamicUsage(map) >= nChunks * resource.ChunkSizeBytes());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,71 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "spentindex.h"
+#include "primitives/block.h"
+#include "txdb.h"
+#include "undo.h"
+#include "test/test_pivx.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spentindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(spentindex_block_records)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back();
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(coinbase);
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(uint256(1), 0));
+    spend.vin.emplace_back(COutPoint(uint256(2), 3));
+    spend.vout.emplace_back(7 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(spend);
+
+    CBlockUndo blockundo;
+    blockundo.vtxundo.emplace_back();
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(5 * COIN, CScript() << OP_TRUE), 10, false, false);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(3 * COIN, CScript() << OP_TRUE), 11, false, false);
+
+    std::vector<std::pair<COutPoint, CSpentIndexValue> > vSpent;
+    GetSpentIndexChanges(block, blockundo, 20, vSpent);
+    BOOST_CHECK_EQUAL(vSpent.size(), 2U);
+    BOOST_CHECK(vSpent[1].first == COutPoint(uint256(2), 3));
+    BOOST_CHECK(vSpent[1].second.txid == block.vtx[1].GetHash());
+    BOOST_CHECK_EQUAL(vSpent[1].second.inputIndex, 1U);
+    BOOST_CHECK_EQUAL(vSpent[1].second.blockHeight, 20);
+    BOOST_CHECK_EQUAL(vSpent[1].second.satoshis, 3 * COIN);
+
+    const CBlockFeeRecord record = GetBlockFeeRecord(block, blockundo);
+    BOOST_CHECK_EQUAL(record.nFees, 1 * COIN);
+    BOOST_CHECK_EQUAL(record.nTx, 1U);
+    BOOST_CHECK_EQUAL(record.nTxAll, 2U);
+    BOOST_CHECK_EQUAL(record.nTxBytes, ::GetSerializeSize(block.vtx[1], SER_NETWORK, PROTOCOL_VERSION));
+
+    // written with the block index, a null value erasing the entry
+    CBlockTreeDB db(1 << 20, true);
+    std::map<COutPoint, CSpentIndexValue> mapSpentIndex(vSpent.begin(), vSpent.end());
+    std::map<uint256, CBlockFeeRecord> mapBlockFees;
+    mapBlockFees[block.GetHash()] = record;
+    BOOST_CHECK(db.WriteBatchSync({}, 0, {}, mapSpentIndex, mapBlockFees));
+
+    CSpentIndexValue value;
+    BOOST_CHECK(db.ReadSpentIndex(COutPoint(uint256(1), 0), value));
+    BOOST_CHECK(value.txid == block.vtx[1].GetHash());
+    CBlockFeeRecord recordRead;
+    BOOST_CHECK(db.ReadBlockFeeRecord(block.GetHash(), recordRead));
+    BOOST_CHECK_EQUAL(recordRead.nFees, record.nFees);
+
+    mapSpentIndex[COutPoint(uint256(1), 0)].SetNull();
+    BOOST_CHECK(db.WriteBatchSync({}, 0, {}, mapSpentIndex, {}));
+    BOOST_CHECK(!db.ReadSpentIndex(COutPoint(uint256(1), 0), value));
+    BOOST_CHECK(db.ReadSpentIndex(COutPoint(uint256(2), 3), value));
+
+    BOOST_CHECK(db.WipeSpentIndex());
+    BOOST_CHECK(!db.ReadSpentIndex(COutPoint(uint256(2), 3), value));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,9 @@
 #include "sync.h"
 #include "test/test_pivx.h"
 
+#include <atomic>
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 namespace {
@@ -50,4 +53,50 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_wait_tracker)
+{
+    RecursiveMutex tracked, untracked;
+    CLockWaitTracker tracker(&tracked);
+    BOOST_CHECK(CLockWaitTracker::Current() == &tracker);
+
+    std::atomic<bool> fLocked{false};
+    std::atomic<bool> fUntrackedWanted{false};
+    std::thread holder([&] {
+        LOCK(untracked);
+        {
+            LOCK(tracked);
+            fLocked = true;
+            // let go once the main thread is waiting for it
+            while (tracker.nWaits == 0)
+                std::this_thread::yield();
+        }
+        while (!fUntrackedWanted)
+            std::this_thread::yield();
+    });
+    while (!fLocked)
+        std::this_thread::yield();
+
+    {
+        LOCK(tracked);
+    }
+    BOOST_CHECK_EQUAL(tracker.nWaits.load(), 1);
+    const int64_t nWait = tracker.nWaitMicros;
+
+    // Only the wait for the tracked mutex counts
+    fUntrackedWanted = true;
+    {
+        LOCK(untracked);
+    }
+    BOOST_CHECK_EQUAL(tracker.nWaits.load(), 1);
+    BOOST_CHECK_EQUAL(tracker.nWaitMicros, nWait);
+
+    // uncontended locking adds nothing
+    {
+        LOCK(tracked);
+    }
+    BOOST_CHECK_EQUAL(tracker.nWaits.load(), 1);
+    BOOST_CHECK_EQUAL(tracker.nWaitMicros, nWait);
+    holder.join();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
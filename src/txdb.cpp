@@ -7,18 +7,27 @@
 
 #include "txdb.h"
 
+#include "guiinterface.h"
+#include "init.h"
 #include "main.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
 
-static const char DB_COIN = 'C';
+static const char DB_COIN = 'K';
+static const char DB_COIN_LEGACY = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
+static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'p';
+static const char DB_BLOCK_FEES = 'e';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -26,13 +35,21 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+/**
+ * Format of the coins records. It is kept under the first per-tx coins key, where the
+ * per-tx upgrade of versions before the compact format fails to parse it, so they refuse
+ * to start on a chainstate they cannot read instead of seeing it empty.
+ */
+static const unsigned char COINS_FORMAT_VERSION = 1;
+static const std::pair<char, uint256> COINS_FORMAT_KEY(DB_COINS, uint256());
+
 namespace {
 
 struct CoinEntry
 {
     COutPoint* outpoint;
     char key;
-    explicit CoinEntry(const COutPoint* ptr) : outpoint(const_cast<COutPoint*>(ptr)), key(DB_COIN)  {}
+    explicit CoinEntry(const COutPoint* ptr, char keyIn = DB_COIN) : outpoint(const_cast<COutPoint*>(ptr)), key(keyIn)  {}
 
     template<typename Stream>
     void Serialize(Stream &s) const {
@@ -52,45 +69,130 @@ struct CoinEntry
 }
 
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+/**
+ * Order of outpoints in the database: the hash bytes, then the VARINT encoding of the
+ * index, which for large indexes is not the numeric order.
+ */
+static bool CoinKeyLess(const COutPoint& a, const COutPoint& b)
 {
+    const int cmp = memcmp(a.hash.begin(), b.hash.begin(), a.hash.size());
+    if (cmp != 0)
+        return cmp < 0;
+    if (a.n < 0x80 && b.n < 0x80)
+        return a.n < b.n;
+    CDataStream ssA(SER_DISK, CLIENT_VERSION), ssB(SER_DISK, CLIENT_VERSION);
+    ssA << VARINT(a.n);
+    ssB << VARINT(b.n);
+    return std::lexicographical_compare(ssA.begin(), ssA.end(), ssB.begin(), ssB.end(),
+        [](char x, char y) { return (unsigned char)x < (unsigned char)y; });
+}
+
+/**
+ * The dirty entries of mapCoins in database key order, so the memtable inserts and the
+ * level 0 table written from them are one ascending run. Clean entries are erased.
+ */
+static std::vector<CCoinsMap::iterator> SortDirtyCoins(CCoinsMap& mapCoins)
+{
+    std::vector<CCoinsMap::iterator> vDirty;
+    vDirty.reserve(mapCoins.size());
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            vDirty.push_back(it++);
+        else
+            it = mapCoins.erase(it);
+    }
+    std::sort(vDirty.begin(), vDirty.end(), [](const CCoinsMap::iterator& a, const CCoinsMap::iterator& b) {
+        return CoinKeyLess(a->first, b->first);
+    });
+    return vDirty;
+}
+
+static uint256 ReadBestBlock(const CDBWrapper& db)
+{
+    uint256 hashBestChain;
+    if (!db.Read(DB_BEST_BLOCK, hashBestChain))
+        return UINT256_ZERO;
+    return hashBestChain;
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, "chainstate")
+{
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    {
+        LOCK(cs_flush);
+        fStopFlushThread = true;
+    }
+    cvFlush.notify_all();
+    // a queued flush is still written before the thread exits
+    if (flushThread.joinable())
+        flushThread.join();
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint& outpoint, Coin& coin) const
 {
-    return db.Read(CoinEntry(&outpoint), coin);
+    {
+        LOCK(cs_flush);
+        if (pendingFlush) {
+            const std::vector<std::pair<COutPoint, Coin> >& vCoins = pendingFlush->vCoins;
+            auto it = std::lower_bound(vCoins.begin(), vCoins.end(), outpoint, [](const std::pair<COutPoint, Coin>& entry, const COutPoint& key) {
+                return CoinKeyLess(entry.first, key);
+            });
+            if (it != vCoins.end() && it->first == outpoint) {
+                if (it->second.IsSpent())
+                    return false;
+                coin = it->second;
+                return true;
+            }
+        }
+    }
+    CCoinCompressor compact(coin);
+    return db.Read(CoinEntry(&outpoint), compact);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint& outpoint) const
 {
+    {
+        LOCK(cs_flush);
+        if (pendingFlush) {
+            const std::vector<std::pair<COutPoint, Coin> >& vCoins = pendingFlush->vCoins;
+            auto it = std::lower_bound(vCoins.begin(), vCoins.end(), outpoint, [](const std::pair<COutPoint, Coin>& entry, const COutPoint& key) {
+                return CoinKeyLess(entry.first, key);
+            });
+            if (it != vCoins.end() && it->first == outpoint)
+                return !it->second.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const
 {
-    uint256 hashBestChain;
-    if (!db.Read(DB_BEST_BLOCK, hashBestChain))
-        return UINT256_ZERO;
-    return hashBestChain;
+    LOCK(cs_flush);
+    if (pendingFlush)
+        return pendingFlush->hashBlock;
+    return ReadBestBlock(db);
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
 {
+    WAIT_LOCK(cs_flush, lock);
+    if (!WaitForFlushLocked(lock))
+        return false;
+
     CDBBatch batch;
-    size_t count = 0;
+    size_t count = mapCoins.size();
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent())
-                batch.Erase(entry);
-            else
-                batch.Write(entry, it->second.coin);
-            changed++;
-        }
-        count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+    for (const CCoinsMap::iterator& it : SortDirtyCoins(mapCoins)) {
+        CoinEntry entry(&it->first);
+        if (it->second.coin.IsSpent())
+            batch.Erase(entry);
+        else
+            batch.Write(entry, CCoinCompressor(it->second.coin));
+        changed++;
+        mapCoins.erase(it);
     }
     if (!hashBlock.IsNull())
         batch.Write(DB_BEST_BLOCK, hashBlock);
@@ -100,12 +202,112 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     return ret;
 }
 
+bool CCoinsViewDB::BatchWriteAsync(CCoinsMap& mapCoins, const uint256& hashBlock)
+{
+    size_t count = mapCoins.size();
+    std::shared_ptr<CCoinsFlushSnapshot> snapshot = std::make_shared<CCoinsFlushSnapshot>();
+    const std::vector<CCoinsMap::iterator> vDirty = SortDirtyCoins(mapCoins);
+    snapshot->vCoins.reserve(vDirty.size());
+    for (const CCoinsMap::iterator& it : vDirty) {
+        snapshot->nUsage += it->second.coin.DynamicMemoryUsage();
+        snapshot->vCoins.emplace_back(it->first, std::move(it->second.coin));
+        mapCoins.erase(it);
+    }
+    snapshot->nUsage += memusage::DynamicUsage(snapshot->vCoins);
+    snapshot->hashBlock = hashBlock;
+
+    {
+        // one flush in flight at a time, so they reach the database in order
+        WAIT_LOCK(cs_flush, lock);
+        if (!WaitForFlushLocked(lock))
+            return false;
+        if (snapshot->hashBlock.IsNull())
+            snapshot->hashBlock = ReadBestBlock(db);
+        if (!flushThread.joinable())
+            flushThread = std::thread(&TraceThread<std::function<void()> >, "coinsflush", std::function<void()>(std::bind(&CCoinsViewDB::ThreadFlush, this)));
+        pendingFlush = std::move(snapshot);
+    }
+    cvFlush.notify_all();
+    LogPrint(BCLog::COINDB, "Queued %u changed transaction outputs (out of %u) for the coin database...\n", (unsigned int)vDirty.size(), (unsigned int)count);
+    return true;
+}
+
+bool CCoinsViewDB::WaitForFlushLocked(std::unique_lock<std::mutex>& lock) const
+{
+    cvFlush.wait(lock, [this] { return !pendingFlush; });
+    return !fFlushFailed;
+}
+
+size_t CCoinsViewDB::PendingWriteUsage() const
+{
+    LOCK(cs_flush);
+    return pendingFlush ? pendingFlush->nUsage : 0;
+}
+
+void CCoinsViewDB::WaitForFlush() const
+{
+    WAIT_LOCK(cs_flush, lock);
+    WaitForFlushLocked(lock);
+}
+
+bool CCoinsViewDB::WriteSnapshot(const CCoinsFlushSnapshot& snapshot)
+{
+    const int64_t nStart = GetTimeMillis();
+    CDBBatch batch;
+    for (const std::pair<COutPoint, Coin>& entry : snapshot.vCoins) {
+        CoinEntry key(&entry.first);
+        if (entry.second.IsSpent())
+            batch.Erase(key);
+        else
+            batch.Write(key, CCoinCompressor(REF(entry.second)));
+    }
+    batch.Write(DB_BEST_BLOCK, snapshot.hashBlock);
+
+    bool ret = db.WriteBatch(batch);
+    LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs to coin database in the background (%dms)...\n", (unsigned int)snapshot.vCoins.size(), GetTimeMillis() - nStart);
+    return ret;
+}
+
+void CCoinsViewDB::ThreadFlush()
+{
+    while (true) {
+        std::shared_ptr<const CCoinsFlushSnapshot> snapshot;
+        {
+            WAIT_LOCK(cs_flush, lock);
+            cvFlush.wait(lock, [this] { return pendingFlush || fStopFlushThread; });
+            if (!pendingFlush)
+                return;
+            snapshot = pendingFlush;
+        }
+
+        bool fOk = false;
+        try {
+            fOk = WriteSnapshot(*snapshot);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        if (!fOk) {
+            // the database is still at the previous flush; stop before anything builds on this one
+            LogPrintf("*** Failed to write to coin database\n");
+            uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occured, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+        }
+
+        {
+            LOCK(cs_flush);
+            fFlushFailed |= !fOk;
+            pendingFlush.reset();
+        }
+        cvFlush.notify_all();
+    }
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe)
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, "blockindex")
 {
 }
 
@@ -140,13 +342,16 @@ bool CBlockTreeDB::ReadLastBlockFile(int& nFile)
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
-    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper*>(&db)->NewIterator(), GetBestBlock());
+    // The LevelDB iterator reads an implicit snapshot. Take it together with the flush in
+    // flight, which the cursor overlays whether or not it gets committed meanwhile.
+    LOCK(cs_flush);
+    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper*>(&db)->NewIterator(),
+        pendingFlush ? pendingFlush->hashBlock : ReadBestBlock(db), pendingFlush);
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
         i->pcursor->GetKey(entry);
@@ -154,11 +359,16 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
     } else {
         i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
     }
+    i->Settle();
     return i;
 }
 
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
+    if (fPendingCurrent) {
+        key = pending->vCoins[nPending].first;
+        return true;
+    }
     // Return cached key
     if (keyTmp.first == DB_COIN) {
         key = keyTmp.second;
@@ -169,20 +379,36 @@ bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 
 bool CCoinsViewDBCursor::GetValue(Coin& coin) const
 {
-    return pcursor->GetValue(coin);
+    if (fPendingCurrent) {
+        coin = pending->vCoins[nPending].second;
+        return true;
+    }
+    CCoinCompressor compact(coin);
+    return pcursor->GetValue(compact);
 }
 
 unsigned int CCoinsViewDBCursor::GetValueSize() const
 {
+    if (fPendingCurrent)
+        return ::GetSerializeSize(CCoinCompressor(REF(pending->vCoins[nPending].second)), SER_DISK, CLIENT_VERSION);
     return pcursor->GetValueSize();
 }
 
 bool CCoinsViewDBCursor::Valid() const
 {
-    return keyTmp.first == DB_COIN;
+    return fPendingCurrent || keyTmp.first == DB_COIN;
 }
 
 void CCoinsViewDBCursor::Next()
+{
+    if (fPendingCurrent)
+        nPending++;
+    else
+        NextDB();
+    Settle();
+}
+
+void CCoinsViewDBCursor::NextDB()
 {
     pcursor->Next();
     CoinEntry entry(&keyTmp.second);
@@ -193,7 +419,28 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+void CCoinsViewDBCursor::Settle()
+{
+    fPendingCurrent = false;
+    if (!pending)
+        return;
+    while (nPending < pending->vCoins.size()) {
+        const std::pair<COutPoint, Coin>& entry = pending->vCoins[nPending];
+        if (keyTmp.first == DB_COIN && CoinKeyLess(keyTmp.second, entry.first))
+            return; // the database record comes first
+        // the pending coin replaces the database record for the same outpoint
+        if (keyTmp.first == DB_COIN && keyTmp.second == entry.first)
+            NextDB();
+        if (!entry.second.IsSpent()) {
+            fPendingCurrent = true;
+            return;
+        }
+        nPending++;
+    }
+}
+
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                                  const std::map<COutPoint, CSpentIndexValue>& mapSpentIndex, const std::map<uint256, CBlockFeeRecord>& mapBlockFees) {
     CDBBatch batch;
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
@@ -202,6 +449,14 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
+    for (const std::pair<const COutPoint, CSpentIndexValue>& entry : mapSpentIndex) {
+        if (entry.second.IsNull())
+            batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+        else
+            batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+    }
+    for (const std::pair<const uint256, CBlockFeeRecord>& entry : mapBlockFees)
+        batch.Write(std::make_pair(DB_BLOCK_FEES, entry.first), entry.second);
     return WriteBatch(batch, true);
 }
 
@@ -226,6 +481,134 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::WriteAddressIndex(const CAddressIndexBlock& changes)
+{
+    CDBBatch batch;
+    for (const std::pair<CAddressIndexKey, CAmount>& entry : changes.vIndex)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+    // in block order, so that an output spent in its own block ends up erased
+    for (const CAddressUnspentChange& change : changes.vUnspent) {
+        if (change.fSpent)
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, change.key));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, change.key), change.value);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseAddressIndex(const CAddressIndexBlock& changes)
+{
+    CDBBatch batch;
+    for (const std::pair<CAddressIndexKey, CAmount>& entry : changes.vIndex)
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+    for (auto it = changes.vUnspent.rbegin(); it != changes.vUnspent.rend(); ++it) {
+        if (it->fSpent)
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->key), it->value);
+        else
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->key));
+    }
+    return WriteBatch(batch);
+}
+
+/** Erase every record of the block tree database keyed by (chPrefix, K) */
+template <typename K>
+static bool WipeRecords(CBlockTreeDB& db, char chPrefix)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    CDBBatch batch;
+
+    pcursor->Seek(chPrefix);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, K> key;
+        if (!pcursor->GetKey(key) || key.first != chPrefix)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (16 << 20)) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    return db.WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WipeAddressIndex()
+{
+    return WipeRecords<CAddressIndexKey>(*this, DB_ADDRESSINDEX) &&
+           WipeRecords<CAddressUnspentKey>(*this, DB_ADDRESSUNSPENTINDEX);
+}
+
+bool CBlockTreeDB::ReadAddressIndex(uint8_t type, const uint160& hashBytes, std::vector<std::pair<CAddressIndexKey, CAmount> >& vEntries, int nStart, int nEnd)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, hashBytes, nStart)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != type || key.second.hashBytes != hashBytes)
+            break;
+        if (nEnd > 0 && key.second.blockHeight > nEnd)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s : failed to read value", __func__);
+        vEntries.emplace_back(key.second, nValue);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint8_t type, const uint160& hashBytes, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vUnspent)
+{
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentIteratorKey(type, hashBytes)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != type || key.second.hashBytes != hashBytes)
+            break;
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s : failed to read value", __func__);
+        vUnspent.emplace_back(key.second, value);
+        pcursor->Next();
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::WriteSpentIndex(const std::vector<std::pair<COutPoint, CSpentIndexValue> >& vSpent, const std::vector<std::pair<uint256, CBlockFeeRecord> >& vBlockFees)
+{
+    CDBBatch batch;
+    for (const std::pair<COutPoint, CSpentIndexValue>& entry : vSpent)
+        batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+    for (const std::pair<uint256, CBlockFeeRecord>& entry : vBlockFees)
+        batch.Write(std::make_pair(DB_BLOCK_FEES, entry.first), entry.second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WipeSpentIndex()
+{
+    return WipeRecords<COutPoint>(*this, DB_SPENTINDEX);
+}
+
+bool CBlockTreeDB::ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value)
+{
+    return Read(std::make_pair(DB_SPENTINDEX, outpoint), value);
+}
+
+bool CBlockTreeDB::ReadBlockFeeRecord(const uint256& hashBlock, CBlockFeeRecord& record)
+{
+    return Read(std::make_pair(DB_BLOCK_FEES, hashBlock), record);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string& name, bool fValue)
 {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
@@ -357,14 +740,16 @@ public:
 
 }
 
-/** Upgrade the database from older formats.
- *
- * Currently implemented:
- * - from the per-tx utxo model (4.2.0) to per-txout (4.2.99)
- */
-bool CCoinsViewDB::Upgrade() {
+/** Upgrade from the per-tx utxo model (4.2.0) to per-txout coins */
+static bool UpgradePerTxCoins(CDBWrapper& db)
+{
     std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
     pcursor->Seek(std::make_pair(DB_COINS, uint256()));
+    if (pcursor->Valid()) {
+        std::pair<char, uint256> key;
+        if (pcursor->GetKey(key) && key == COINS_FORMAT_KEY)
+            pcursor->Next();
+    }
     if (!pcursor->Valid()) {
         return true;
     }
@@ -386,7 +771,7 @@ bool CCoinsViewDB::Upgrade() {
                     Coin newcoin(std::move(old_coins.vout[i]), old_coins.nHeight, old_coins.fCoinBase, old_coins.fCoinStake);
                     outpoint.n = i;
                     CoinEntry entry(&outpoint);
-                    batch.Write(entry, newcoin);
+                    batch.Write(entry, CCoinCompressor(newcoin));
                 }
             }
             batch.Erase(key);
@@ -402,3 +787,65 @@ bool CCoinsViewDB::Upgrade() {
     db.WriteBatch(batch);
     return true;
 }
+
+/**
+ * Upgrade the per-txout coins (4.2.99) to the compact format. Each batch moves its coins
+ * to the new key prefix, so an interrupted upgrade carries on where it stopped. The format
+ * version is written before the first coin moves.
+ */
+static bool UpgradeLegacyCoins(CDBWrapper& db, size_t batch_size, const std::function<bool()>& fnInterrupt)
+{
+    unsigned char nFormat = 0;
+    if (db.Read(COINS_FORMAT_KEY, nFormat)) {
+        if (nFormat > COINS_FORMAT_VERSION)
+            return error("%s: coins database format %d is newer than this version supports (%d)", __func__, nFormat, COINS_FORMAT_VERSION);
+    } else if (!db.Write(COINS_FORMAT_KEY, COINS_FORMAT_VERSION, true)) {
+        return error("%s: cannot write the coins database format", __func__);
+    }
+
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(DB_COIN_LEGACY);
+
+    size_t count = 0;
+    CDBBatch batch;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint outpoint;
+        CoinEntry entry(&outpoint, DB_COIN_LEGACY);
+        if (!pcursor->GetKey(entry) || entry.key != DB_COIN_LEGACY)
+            break;
+        if (count == 0)
+            LogPrintf("Upgrading coins database to the compact format...\n");
+
+        Coin coin;
+        if (!pcursor->GetValue(coin)) {
+            return error("%s: cannot parse coin record", __func__);
+        }
+        batch.Write(CoinEntry(&outpoint), CCoinCompressor(coin));
+        batch.Erase(entry);
+        count++;
+        if (batch.SizeEstimate() > batch_size) {
+            db.WriteBatch(batch);
+            batch.Clear();
+            if (fnInterrupt()) {
+                LogPrintf("Coins database upgrade interrupted after %u coins\n", (unsigned int)count);
+                return true;
+            }
+        }
+        pcursor->Next();
+    }
+    db.WriteBatch(batch);
+    if (count > 0)
+        LogPrintf("Upgraded %u coins to the compact format\n", (unsigned int)count);
+    return true;
+}
+
+/** Upgrade the database from older formats.
+ *
+ * Currently implemented:
+ * - from the per-tx utxo model (4.2.0) to per-txout (4.2.99)
+ * - from the per-txout coins to the compact coin format
+ */
+bool CCoinsViewDB::Upgrade(size_t nBatchSize, const std::function<bool()>& fnInterrupt) {
+    return UpgradePerTxCoins(db) && UpgradeLegacyCoins(db, nBatchSize, fnInterrupt ? fnInterrupt : ShutdownRequested);
+}
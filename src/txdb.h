@@ -8,12 +8,19 @@
 #ifndef BITCOIN_TXDB_H
 #define BITCOIN_TXDB_H
 
+#include "addressindex.h"
 #include "coins.h"
 #include "chain.h"
 #include "dbwrapper.h"
+#include "spentindex.h"
+#include "sync.h"
 
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -63,27 +70,68 @@ struct CDiskTxPos : public CDiskBlockPos
     }
 };
 
-/** CCoinsView backed by the LevelDB coin database (chainstate/) */
+/** Dirty coins of one flush, sorted in database key order, spent coins included as erasures */
+struct CCoinsFlushSnapshot {
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+    uint256 hashBlock;
+    //! memory held by vCoins, counted against the coins cache size
+    size_t nUsage{0};
+};
+
+/**
+ * CCoinsView backed by the LevelDB coin database (chainstate/)
+ *
+ * BatchWriteAsync() only moves the dirty coins into a snapshot and leaves the LevelDB
+ * write, coins and best block marker in one batch, to a writer thread. Until that batch
+ * is committed the snapshot shadows the database for reads and cursors, so the view
+ * never shows a state between two flushes, and after a crash the database is simply
+ * at the previous best block.
+ */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
 
+    mutable Mutex cs_flush;
+    mutable std::condition_variable cvFlush;
+    //! the flush being written by flushThread, if any
+    std::shared_ptr<const CCoinsFlushSnapshot> pendingFlush GUARDED_BY(cs_flush);
+    //! a background write failed; refuse further writes
+    bool fFlushFailed GUARDED_BY(cs_flush){false};
+    bool fStopFlushThread GUARDED_BY(cs_flush){false};
+    std::thread flushThread;
+
+    //! Wait, with cs_flush held, for the background write in flight. Returns false if a write failed.
+    bool WaitForFlushLocked(std::unique_lock<std::mutex>& lock) const;
+    bool WriteSnapshot(const CCoinsFlushSnapshot& snapshot);
+    void ThreadFlush();
+
 public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint& outpoint, Coin& coin) const override;
     bool HaveCoin(const COutPoint& outpoint) const override;
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
+    bool BatchWriteAsync(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     CCoinsViewCursor* Cursor() const override;
+    size_t PendingWriteUsage() const override;
+
+    //! Block until the background write in flight, if any, is committed
+    void WaitForFlush() const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
-    bool Upgrade();
+    //! Legacy coins move in batches of nBatchSize bytes, and the upgrade stops after a batch
+    //! when fnInterrupt (ShutdownRequested by default) returns true.
+    bool Upgrade(size_t nBatchSize = 1 << 24, const std::function<bool()>& fnInterrupt = nullptr);
     size_t EstimateSize() const override;
 };
 
-/** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
+/**
+ * Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB. A flush still being
+ * written when the cursor was created is merged in, as it is for point reads.
+ */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
 public:
@@ -97,10 +145,17 @@ public:
     void Next();
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256& hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256& hashBlockIn, std::shared_ptr<const CCoinsFlushSnapshot> pendingIn):
+        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn), pending(std::move(pendingIn)) {}
+    void NextDB();
+    //! Position on the next unspent coin of either source, pending coins taking precedence
+    void Settle();
+
     boost::scoped_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    std::shared_ptr<const CCoinsFlushSnapshot> pending;
+    size_t nPending{0};
+    bool fPendingCurrent{false};
 
     friend class CCoinsViewDB;
 };
@@ -117,7 +172,10 @@ private:
 
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    /** Write block file information and block index entries, and the spent index changes (a null
+     *  value erases the entry) and block fee records staged since the last write, in one batch */
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo,
+                        const std::map<COutPoint, CSpentIndexValue>& mapSpentIndex, const std::map<uint256, CBlockFeeRecord>& mapBlockFees);
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& fileinfo);
     bool ReadLastBlockFile(int& nFile);
@@ -125,6 +183,21 @@ public:
     bool ReadReindexing(bool& fReindex);
     bool ReadTxIndex(const uint256& txid, CDiskTxPos& pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >& list);
+    //! Apply the address index changes of a connected block, in one batch
+    bool WriteAddressIndex(const CAddressIndexBlock& changes);
+    //! Revert the address index changes of a disconnected block, in one batch
+    bool EraseAddressIndex(const CAddressIndexBlock& changes);
+    //! Remove all address index records, before the index is built again
+    bool WipeAddressIndex();
+    //! Entries of an address, in chain order, from height nStart on and up to nEnd if it is not 0
+    bool ReadAddressIndex(uint8_t type, const uint160& hashBytes, std::vector<std::pair<CAddressIndexKey, CAmount> >& vEntries, int nStart = 0, int nEnd = 0);
+    bool ReadAddressUnspentIndex(uint8_t type, const uint160& hashBytes, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vUnspent);
+    //! Write spent index entries and block fee records built from the block files, in one batch
+    bool WriteSpentIndex(const std::vector<std::pair<COutPoint, CSpentIndexValue> >& vSpent, const std::vector<std::pair<uint256, CBlockFeeRecord> >& vBlockFees);
+    //! Remove all spent index entries, before the index is built again
+    bool WipeSpentIndex();
+    bool ReadSpentIndex(const COutPoint& outpoint, CSpentIndexValue& value);
+    bool ReadBlockFeeRecord(const uint256& hashBlock, CBlockFeeRecord& record);
     bool WriteFlag(const std::string& name, bool fValue);
     bool ReadFlag(const std::string& name, bool& fValue);
     bool WriteInt(const std::string& name, int nValue);
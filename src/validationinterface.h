@@ -15,6 +15,7 @@ class CBlock;
 struct CBlockLocator;
 class CBlockIndex;
 class CConnman;
+class CDataStream;
 class CReserveScript;
 class CTransaction;
 class CValidationInterface;
@@ -33,7 +34,7 @@ void UnregisterAllValidationInterfaces();
 class CValidationInterface {
 protected:
 // XX42    virtual void EraseFromWallet(const uint256& hash){};
-    virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
+    virtual void UpdatedBlockTip(const CBlockIndex *pindex, const CDataStream *pssBlock) {}
     virtual void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) {}
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
     virtual void SetBestChain(const CBlockLocator &locator) {}
@@ -49,8 +50,9 @@ protected:
 
 struct CMainSignals {
 // XX42    boost::signals2::signal<void(const uint256&)> EraseTransaction;
-    /** Notifies listeners of updated block chain tip */
-    boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
+    /** Notifies listeners of updated block chain tip, along with the network serialization of the
+     *  tip block when it was connected from memory (NULL when only the index is available) */
+    boost::signals2::signal<void (const CBlockIndex *, const CDataStream *)> UpdatedBlockTip;
     /** A posInBlock value for SyncTransaction which indicates the transaction was conflicted, disconnected, or not in a block */
     static const int SYNC_TRANSACTION_NOT_IN_BLOCK = -1;
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
@@ -61,7 +61,9 @@ void WalletTxToJSON(const CWalletTx& wtx, UniValue& entry)
     if (confirms > 0) {
         entry.push_back(Pair("blockhash", wtx.hashBlock.GetHex()));
         entry.push_back(Pair("blockindex", wtx.nIndex));
-        entry.push_back(Pair("blocktime", mapBlockIndex[wtx.hashBlock]->GetBlockTime()));
+        const CBlockIndex* pindex = LookupBlockIndex(wtx.hashBlock);
+        if (pindex)
+            entry.push_back(Pair("blocktime", pindex->GetBlockTime()));
     } else {
         entry.push_back(Pair("trusted", wtx.IsTrusted()));
     }
@@ -1881,23 +1883,13 @@ UniValue listtransactions(const JSONRPCRequest& request)
     if ((nFrom + nCount) > (int)ret.size())
         nCount = ret.size() - nFrom;
 
-    std::vector<UniValue> arrTmp = ret.getValues();
+    // Return oldest to newest
+    const std::vector<UniValue>& vEntries = ret.getValues();
+    JSONResultStream result(request.pstream, UniValue::VARR);
+    for (int i = nFrom + nCount - 1; i >= nFrom; i--)
+        result.push_back(vEntries[i]);
 
-    std::vector<UniValue>::iterator first = arrTmp.begin();
-    std::advance(first, nFrom);
-    std::vector<UniValue>::iterator last = arrTmp.begin();
-    std::advance(last, nFrom+nCount);
-
-    if (last != arrTmp.end()) arrTmp.erase(last, arrTmp.end());
-    if (first != arrTmp.begin()) arrTmp.erase(arrTmp.begin(), first);
-
-    std::reverse(arrTmp.begin(), arrTmp.end()); // Return oldest to newest
-
-    ret.clear();
-    ret.setArray();
-    ret.push_backV(arrTmp);
-
-    return ret;
+    return result.Finish();
 }
 
 UniValue listaccounts(const JSONRPCRequest& request)
@@ -2536,7 +2528,6 @@ UniValue listunspent(const JSONRPCRequest& request)
     CCoinControl coinControl;
     coinControl.fAllowWatchOnly = nWatchonlyConfig == 2;
 
-    UniValue results(UniValue::VARR);
     std::vector<COutput> vecOutputs;
     assert(pwalletMain != NULL);
     LOCK2(cs_main, pwalletMain->cs_wallet);
@@ -2545,6 +2536,7 @@ UniValue listunspent(const JSONRPCRequest& request)
                                 ALL_COINS,  // coin type
                                 false      // only confirmed
                                 );
+    JSONResultStream results(request.pstream, UniValue::VARR);
     for (const COutput& out : vecOutputs) {
         if (out.nDepth < nMinDepth || out.nDepth > nMaxDepth)
             continue;
@@ -2590,7 +2582,7 @@ UniValue listunspent(const JSONRPCRequest& request)
         results.push_back(entry);
     }
 
-    return results;
+    return results.Finish();
 }
 
 UniValue lockunspent(const JSONRPCRequest& request)
@@ -0,0 +1,71 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/stakerewards.h"
+
+int64_t CStakeRewardIndex::BucketStart(int64_t nTime)
+{
+    // round down, also for times before the epoch
+    const int64_t nRem = nTime % BUCKET_SECONDS;
+    return nTime - (nRem < 0 ? nRem + BUCKET_SECONDS : nRem);
+}
+
+void CStakeRewardIndex::RemoveLocked(std::map<uint256, Entry>::iterator it)
+{
+    AssertLockHeld(cs);
+    auto bucket = mapBuckets.find(BucketStart(it->second.nTime));
+    if (bucket != mapBuckets.end()) {
+        bucket->second.nStake -= it->second.nStake;
+        bucket->second.nMasternode -= it->second.nMasternode;
+        if (--bucket->second.nCount == 0)
+            mapBuckets.erase(bucket);
+    }
+    mapEntries.erase(it);
+}
+
+void CStakeRewardIndex::Add(const uint256& hash, int64_t nTime, CAmount nStake, CAmount nMasternode)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end())
+        RemoveLocked(it);
+    mapEntries.emplace(hash, Entry{nTime, nStake, nMasternode});
+
+    const int64_t nStart = BucketStart(nTime);
+    CStakeRewardBucket& bucket = mapBuckets[nStart];
+    bucket.nTime = nStart;
+    bucket.nStake += nStake;
+    bucket.nMasternode += nMasternode;
+    bucket.nCount++;
+}
+
+void CStakeRewardIndex::Remove(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end())
+        RemoveLocked(it);
+}
+
+void CStakeRewardIndex::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    mapBuckets.clear();
+}
+
+std::vector<CStakeRewardBucket> CStakeRewardIndex::GetBuckets(int64_t nTimeFrom, int64_t nTimeTo) const
+{
+    std::vector<CStakeRewardBucket> vBuckets;
+    LOCK(cs);
+    for (auto it = mapBuckets.lower_bound(nTimeFrom); it != mapBuckets.end() && it->first < nTimeTo; ++it)
+        vBuckets.push_back(it->second);
+    return vBuckets;
+}
+
+size_t CStakeRewardIndex::Size() const
+{
+    LOCK(cs);
+    return mapEntries.size();
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef OWO_WALLET_STAKEREWARDS_H
+#define OWO_WALLET_STAKEREWARDS_H
+
+#include "amount.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <map>
+#include <vector>
+
+/** Stake and masternode rewards of the transactions that start in one bucket */
+struct CStakeRewardBucket {
+    int64_t nTime{0};        //!< start of the bucket
+    CAmount nStake{0};
+    CAmount nMasternode{0};
+    uint32_t nCount{0};      //!< number of reward transactions
+};
+
+/**
+ * Time ordered totals of the wallet's stake and masternode rewards, kept up to date by the
+ * wallet as coinstakes are connected and disconnected, so that charts over years of staking
+ * read a few thousand buckets instead of every transaction.
+ *
+ * Buckets span 15 minutes, which every time zone offset is a multiple of, so the caller can
+ * sum them into local days, months or years. Has its own lock and can be read from any thread.
+ */
+class CStakeRewardIndex
+{
+public:
+    static const int64_t BUCKET_SECONDS = 15 * 60;
+
+    /** Records, or replaces, the rewards of a transaction */
+    void Add(const uint256& hash, int64_t nTime, CAmount nStake, CAmount nMasternode);
+    void Remove(const uint256& hash);
+    void Clear();
+
+    /** Non empty buckets starting in [nTimeFrom, nTimeTo), oldest first */
+    std::vector<CStakeRewardBucket> GetBuckets(int64_t nTimeFrom, int64_t nTimeTo) const;
+    /** Number of reward transactions */
+    size_t Size() const;
+
+private:
+    struct Entry {
+        int64_t nTime;
+        CAmount nStake;
+        CAmount nMasternode;
+    };
+
+    mutable Mutex cs;
+    std::map<uint256, Entry> mapEntries GUARDED_BY(cs);
+    std::map<int64_t, CStakeRewardBucket> mapBuckets GUARDED_BY(cs);
+
+    static int64_t BucketStart(int64_t nTime);
+    void RemoveLocked(std::map<uint256, Entry>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(cs);
+};
+
+#endif // OWO_WALLET_STAKEREWARDS_H
@@ -0,0 +1,58 @@
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "test/test_pivx.h"
+#include "wallet/stakerewards.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stakerewards_tests, BasicTestingSetup)
+
+static uint256 TxHash(int n)
+{
+    return ArithToUint256(arith_uint256(n));
+}
+
+BOOST_AUTO_TEST_CASE(stakerewards_buckets)
+{
+    CStakeRewardIndex index;
+    const int64_t nDay = 1600000000 - 1600000000 % 86400;
+
+    index.Add(TxHash(1), nDay + 10, 5 * COIN, 0);
+    index.Add(TxHash(2), nDay + 20, 5 * COIN, 0);
+    index.Add(TxHash(3), nDay + 900, 0, 3 * COIN);
+    index.Add(TxHash(4), nDay + 86400, 5 * COIN, 0);
+    BOOST_CHECK_EQUAL(index.Size(), 4U);
+
+    // the first two share a bucket
+    std::vector<CStakeRewardBucket> vBuckets = index.GetBuckets(nDay, nDay + 86400);
+    BOOST_REQUIRE_EQUAL(vBuckets.size(), 2U);
+    BOOST_CHECK_EQUAL(vBuckets[0].nTime, nDay);
+    BOOST_CHECK_EQUAL(vBuckets[0].nStake, 10 * COIN);
+    BOOST_CHECK_EQUAL(vBuckets[0].nCount, 2U);
+    BOOST_CHECK_EQUAL(vBuckets[1].nTime, nDay + CStakeRewardIndex::BUCKET_SECONDS);
+    BOOST_CHECK_EQUAL(vBuckets[1].nMasternode, 3 * COIN);
+
+    // adding a transaction again replaces it, also when it moved to another bucket
+    index.Add(TxHash(2), nDay + 86400 + 5, 7 * COIN, 0);
+    BOOST_CHECK_EQUAL(index.Size(), 4U);
+    vBuckets = index.GetBuckets(nDay, nDay + 2 * 86400);
+    BOOST_REQUIRE_EQUAL(vBuckets.size(), 3U);
+    BOOST_CHECK_EQUAL(vBuckets[0].nStake, 5 * COIN);
+    BOOST_CHECK_EQUAL(vBuckets[2].nStake, 12 * COIN);
+    BOOST_CHECK_EQUAL(vBuckets[2].nCount, 2U);
+
+    // removing the last transaction of a bucket drops the bucket
+    index.Remove(TxHash(3));
+    index.Remove(TxHash(3));
+    vBuckets = index.GetBuckets(nDay, nDay + 2 * 86400);
+    BOOST_CHECK_EQUAL(vBuckets.size(), 2U);
+    BOOST_CHECK_EQUAL(index.Size(), 3U);
+
+    index.Clear();
+    BOOST_CHECK(index.GetBuckets(0, std::numeric_limits<int64_t>::max()).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
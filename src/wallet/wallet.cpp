@@ -951,7 +951,11 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex
             if (posInBlock != -1)
                 wtx.SetMerkleBranch(pIndex, posInBlock);
 
-            return AddToWallet(wtx, false);
+            if (!AddToWallet(wtx, false))
+                return false;
+            if (tx.IsCoinStake())
+                UpdateStakeRewards(mapWallet.at(tx.GetHash()), posInBlock != -1);
+            return true;
         }
     }
     return false;
@@ -1019,8 +1023,8 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
     LOCK2(cs_main, cs_wallet);
 
     int conflictconfirms = 0;
-    if (mapBlockIndex.count(hashBlock)) {
-        CBlockIndex* pindex = mapBlockIndex[hashBlock];
+    CBlockIndex* pindex = LookupBlockIndex(hashBlock);
+    if (pindex) {
         if (chainActive.Contains(pindex)) {
             conflictconfirms = -(chainActive.Height() - pindex->nHeight + 1);
         }
@@ -1097,6 +1101,7 @@ void CWallet::EraseFromWallet(const uint256& hash)
         LOCK(cs_wallet);
         if (mapWallet.erase(hash)) {
             setWallet.erase(hash);
+            stakeRewards.Remove(hash);
             CWalletDB(strWalletFile).EraseTx(hash);
         }
         LogPrintf("%s: Erased wtx %s from wallet\n", __func__, hash.GetHex());
@@ -1104,6 +1109,39 @@ void CWallet::EraseFromWallet(const uint256& hash)
     return;
 }
 
+void CWallet::UpdateStakeRewards(const CWalletTx& wtx, bool fInMainChain)
+{
+    AssertLockHeld(cs_wallet);
+    if (!wtx.IsCoinStake() || !fInMainChain) {
+        stakeRewards.Remove(wtx.GetHash());
+        return;
+    }
+
+    // Same split as the stake and masternode reward records of the transaction list
+    if (IsMine(wtx.vout[1])) {
+        stakeRewards.Add(wtx.GetHash(), wtx.GetTxTime(), wtx.GetCredit(ISMINE_ALL) - wtx.GetDebit(ISMINE_ALL), 0);
+    } else {
+        const CTxOut& txoutMN = wtx.vout.back();
+        CTxDestination destMN;
+        if (ExtractDestination(txoutMN.scriptPubKey, destMN) && ::IsMine(*this, destMN))
+            stakeRewards.Add(wtx.GetHash(), wtx.GetTxTime(), 0, txoutMN.nValue);
+        else
+            stakeRewards.Remove(wtx.GetHash());
+    }
+}
+
+void CWallet::LoadStakeRewards()
+{
+    LOCK2(cs_main, cs_wallet);
+    stakeRewards.Clear();
+    for (const auto& entry : mapWallet) {
+        const CWalletTx& wtx = entry.second;
+        if (wtx.IsCoinStake() && wtx.GetDepthInMainChain() > 0)
+            UpdateStakeRewards(wtx, true);
+    }
+    LogPrintf("Loaded %u stake rewards\n", stakeRewards.Size());
+}
+
 isminetype CWallet::IsMine(const CTxIn& txin) const
 {
     {
@@ -3731,6 +3769,8 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
     }
     fVerifyingBlocks = false;
 
+    walletInstance->LoadStakeRewards();
+
     return walletInstance;
 }
 
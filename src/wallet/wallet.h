@@ -27,6 +27,7 @@
 #include "validationinterface.h"
 #include "script/ismine.h"
 #include "wallet/scriptpubkeyman.h"
+#include "wallet/stakerewards.h"
 #include "wallet/walletdb.h"
 
 #include <algorithm>
@@ -337,6 +338,9 @@ public:
     // MAX_AMOUNT_LOADED_RECORDS
     int nLoadedRecordsMaxCount;
 
+    //! Stake and masternode rewards of the coinstakes in the active chain, by time
+    CStakeRewardIndex stakeRewards;
+
     CWallet();
     CWallet(std::string strWalletFileIn);
     ~CWallet();
@@ -461,6 +465,10 @@ public:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlockIndex* pIndex, int posInBlock, bool fUpdate);
     void EraseFromWallet(const uint256& hash);
+    /** Records the rewards of a coinstake in stakeRewards, or drops them when it left the active chain */
+    void UpdateStakeRewards(const CWalletTx& wtx, bool fInMainChain);
+    /** Rebuilds stakeRewards from the whole wallet */
+    void LoadStakeRewards();
 
     /**
      * Upgrade wallet to HD if needed. Does nothing if not.
@@ -12,7 +12,7 @@ CZMQAbstractNotifier::~CZMQAbstractNotifier()
     assert(!psocket);
 }
 
-bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
+bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/, const CDataStream * /*pssBlock*/)
 {
     return true;
 }
@@ -22,6 +22,11 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyBlockTransaction(const CTransaction &/*transaction*/, const CBlockIndex * /*pindex*/, int /*posInBlock*/)
+{
+    return true;
+}
+
 bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transaction*/)
 {
     return true;
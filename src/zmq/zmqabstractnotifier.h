@@ -8,15 +8,21 @@
 
 #include "zmqconfig.h"
 
+#include <atomic>
+
 class CBlockIndex;
+class CDataStream;
 class CZMQAbstractNotifier;
 
+/** Default outbound message high water mark (ZMQ_SNDHWM) of a notifier socket */
+static const int DEFAULT_ZMQ_SNDHWM = 1000;
+
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
 {
 public:
-    CZMQAbstractNotifier() : psocket(0) { }
+    CZMQAbstractNotifier() : psocket(0), nOutboundHighWaterMark(DEFAULT_ZMQ_SNDHWM), nMessagesSent(0), nMessagesDropped(0) { }
     virtual ~CZMQAbstractNotifier();
 
     template <typename T>
@@ -29,18 +35,28 @@ public:
     void SetType(const std::string &t) { type = t; }
     std::string GetAddress() const { return address; }
     void SetAddress(const std::string &a) { address = a; }
+    int GetOutboundMessageHighWaterMark() const { return nOutboundHighWaterMark; }
+    void SetOutboundMessageHighWaterMark(int hwm) { if (hwm >= 0) nOutboundHighWaterMark = hwm; }
+    uint64_t GetMessagesSent() const { return nMessagesSent; }
+    uint64_t GetMessagesDropped() const { return nMessagesDropped; }
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
+    // pssBlock holds the serialized block when it was connected from memory, NULL otherwise
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const CDataStream *pssBlock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    // Called in addition to NotifyTransaction for transactions connected in a block
+    virtual bool NotifyBlockTransaction(const CTransaction &transaction, const CBlockIndex *pindex, int posInBlock);
     virtual bool NotifyTransactionLock(const CTransaction &transaction);
 
 protected:
     void *psocket;
     std::string type;
     std::string address;
+    int nOutboundHighWaterMark; // aka ZMQ_SNDHWM
+    std::atomic<uint64_t> nMessagesSent;
+    std::atomic<uint64_t> nMessagesDropped; // not queued because the high water mark was reached
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
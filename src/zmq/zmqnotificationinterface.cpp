@@ -11,6 +11,8 @@
 #include "streams.h"
 #include "util.h"
 
+CZMQNotificationInterface* pzmqNotificationInterface = NULL;
+
 void zmqError(const char *str)
 {
     LogPrint(BCLog::ZMQ, "Error: %s, errno=%s\n", str, zmq_strerror(errno));
@@ -41,6 +43,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubhashtxlock"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionLockNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubrawtxbatch"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionBatchNotifier>;
     factories["pubrawtxlock"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionLockNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
@@ -53,6 +56,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
             CZMQAbstractNotifier *notifier = factory();
             notifier->SetType(i->first);
             notifier->SetAddress(address);
+            std::map<std::string, std::string>::const_iterator k = args.find("-zmq" + i->first + "hwm");
+            notifier->SetOutboundMessageHighWaterMark(k != args.end() ? atoi(k->second) : DEFAULT_ZMQ_SNDHWM);
             notifiers.push_back(notifier);
         }
     }
@@ -72,6 +77,15 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     return notificationInterface;
 }
 
+std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotifiers() const
+{
+    std::list<const CZMQAbstractNotifier*> result;
+    for (const CZMQAbstractNotifier* n : notifiers) {
+        result.push_back(n);
+    }
+    return result;
+}
+
 // Called at startup to conditionally set up ZMQ socket(s)
 bool CZMQNotificationInterface::Initialize()
 {
@@ -127,12 +141,12 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex, const CDataStream *pssBlock)
 {
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
+        if (notifier->NotifyBlock(pindex, pssBlock))
         {
             i++;
         }
@@ -149,7 +163,10 @@ void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CB
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
+        bool fSent = notifier->NotifyTransaction(tx);
+        if (fSent && posInBlock != CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK)
+            fSent = notifier->NotifyBlockTransaction(tx, pindex, posInBlock);
+        if (fSent)
         {
             i++;
         }
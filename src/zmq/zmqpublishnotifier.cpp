@@ -16,9 +16,11 @@ static const char *MSG_HASHTX     = "hashtx";
 static const char *MSG_HASHTXLOCK = "hashtxlock";
 static const char *MSG_RAWBLOCK   = "rawblock";
 static const char *MSG_RAWTX      = "rawtx";
+static const char *MSG_RAWTXBATCH = "rawtxbatch";
 static const char *MSG_RAWTXLOCK = "rawtxlock";
 
 // Internal function to send multipart message
+// Returns -1 with errno set to EAGAIN when the message was not queued because the high water mark was reached
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
 {
     va_list args;
@@ -40,11 +42,14 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
 
         data = va_arg(args, const void*);
 
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
+        rc = zmq_msg_send(&msg, sock, (data ? ZMQ_SNDMORE : 0) | ZMQ_DONTWAIT);
         if (rc == -1)
         {
-            zmqError("Unable to send ZMQ msg");
+            int err = zmq_errno();
+            if (err != EAGAIN)
+                zmqError("Unable to send ZMQ msg");
             zmq_msg_close(&msg);
+            errno = err;
             return -1;
         }
 
@@ -74,7 +79,21 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
             return false;
         }
 
-        int rc = zmq_bind(psocket, address.c_str());
+        int rc = zmq_setsockopt(psocket, ZMQ_SNDHWM, &nOutboundHighWaterMark, sizeof(nOutboundHighWaterMark));
+        if (rc!=0)
+        {
+            zmqError("Failed to set outbound message high water mark");
+            zmq_close(psocket);
+            return false;
+        }
+
+#ifdef ZMQ_XPUB_NODROP
+        // report a full subscriber queue as EAGAIN instead of silently discarding, so drops can be counted
+        int nodrop = 1;
+        zmq_setsockopt(psocket, ZMQ_XPUB_NODROP, &nodrop, sizeof(nodrop));
+#endif
+
+        rc = zmq_bind(psocket, address.c_str());
         if (rc!=0)
         {
             zmqError("Failed to bind address");
@@ -89,6 +108,9 @@ bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
     else
     {
         LogPrint(BCLog::ZMQ, "Reusing socket for address %s\n", address);
+        if (nOutboundHighWaterMark != i->second->nOutboundHighWaterMark)
+            LogPrint(BCLog::ZMQ, "Ignoring high water mark %d of %s, socket already uses %d\n", nOutboundHighWaterMark, type, i->second->nOutboundHighWaterMark);
+        nOutboundHighWaterMark = i->second->nOutboundHighWaterMark;
 
         psocket = i->second->psocket;
         mapPublishNotifiers.insert(std::make_pair(address, this));
@@ -135,8 +157,15 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     unsigned char msgseq[sizeof(uint32_t)];
     WriteLE32(&msgseq[0], nSequence);
     int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
-        return false;
+    if (rc == -1) {
+        if (errno != EAGAIN)
+            return false;
+        // a slow subscriber is not a reason to shut the notifier down, only account for the loss
+        LogPrint(BCLog::ZMQ, "Dropped %s message, high water mark %d reached\n", command, nOutboundHighWaterMark);
+        nMessagesDropped++;
+        return true;
+    }
+    nMessagesSent++;
 
     /* increment memory only sequence number after sending */
     nSequence++;
@@ -144,7 +173,7 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CDataStream * /*pssBlock*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint(BCLog::ZMQ, "Publish hashblock %s\n", hash.GetHex());
@@ -174,16 +203,18 @@ bool CZMQPublishHashTransactionLockNotifier::NotifyTransactionLock(const CTransa
     return SendMessage(MSG_HASHTXLOCK, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CDataStream *pssBlock)
 {
     LogPrint(BCLog::ZMQ, "Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-// XX42    const Consensus::Params& consensusParams = Params().GetConsensus();
+    // the block was just connected from memory, publish the bytes serialized by the validation code
+    if (pssBlock)
+        return SendMessage(MSG_RAWBLOCK, &(*pssBlock->begin()), pssBlock->size());
+
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
         LOCK(cs_main);
         CBlock block;
-// XX42        if(!ReadBlockFromDisk(block, pindex, consensusParams))
         if(!ReadBlockFromDisk(block, pindex))
         {
             zmqError("Can't read block from disk");
@@ -205,6 +236,40 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
 
+bool CZMQPublishRawTransactionBatchNotifier::FlushBatch()
+{
+    uint256 hash = pindexBatch->GetBlockHash();
+    LogPrint(BCLog::ZMQ, "Publish rawtxbatch %s (%u txs)\n", hash.GetHex(), nBatchTx);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    for (unsigned int i = 0; i < 32; i++)
+        ss << hash.begin()[31 - i];
+    WriteCompactSize(ss, nBatchTx);
+    ss += ssBatch;
+
+    pindexBatch = nullptr;
+    nBatchTx = 0;
+    ssBatch.clear();
+
+    return SendMessage(MSG_RAWTXBATCH, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawTransactionBatchNotifier::NotifyBlockTransaction(const CTransaction &transaction, const CBlockIndex *pindex, int posInBlock)
+{
+    // a batch left incomplete by a previous block is published with what it has
+    if (pindexBatch && (pindexBatch != pindex || posInBlock == 0)) {
+        if (!FlushBatch())
+            return false;
+    }
+
+    pindexBatch = pindex;
+    ssBatch << transaction;
+    nBatchTx++;
+
+    if (nBatchTx < pindex->nTx)
+        return true;
+    return FlushBatch();
+}
+
 bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransaction &transaction)
 {
     uint256 hash = transaction.GetHash();
@@ -7,6 +7,8 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "streams.h"
+#include "version.h"
 
 class CBlockIndex;
 
@@ -16,6 +18,7 @@ private:
     uint32_t nSequence; // upcounting per message sequence number
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0) { }
 
     /* send zmq multipart message
        parts:
@@ -32,7 +35,7 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const CDataStream *pssBlock);
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -50,7 +53,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const CDataStream *pssBlock);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -59,6 +62,22 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+/* publishes the transactions of a connected block as a single message:
+   block hash (32 bytes) | compact size tx count | serialized transactions */
+class CZMQPublishRawTransactionBatchNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    const CBlockIndex *pindexBatch;
+    unsigned int nBatchTx;
+    CDataStream ssBatch;
+
+    bool FlushBatch();
+
+public:
+    CZMQPublishRawTransactionBatchNotifier() : pindexBatch(nullptr), nBatchTx(0), ssBatch(SER_NETWORK, PROTOCOL_VERSION) { }
+    bool NotifyBlockTransaction(const CTransaction &transaction, const CBlockIndex *pindex, int posInBlock);
+};
+
 class CZMQPublishRawTransactionLockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
@@ -0,0 +1,69 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zmq/zmqrpc.h"
+
+#include "rpc/server.h"
+#include "utilstrencodings.h"
+#include "zmq/zmqabstractnotifier.h"
+#include "zmq/zmqnotificationinterface.h"
+
+#include <univalue.h>
+
+UniValue getzmqnotifications(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getzmqnotifications\n"
+            "\nReturns information about the active ZeroMQ notifications.\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"type\": \"pubhashtx\",   (string) Type of notification\n"
+            "    \"address\": \"...\",      (string) Address of the publisher\n"
+            "    \"hwm\": n,              (numeric) Outbound message high water mark\n"
+            "    \"sent\": n,             (numeric) Number of messages published\n"
+            "    \"dropped\": n           (numeric) Number of messages dropped because the high water mark was reached\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+
+            "\nExamples:\n" +
+            HelpExampleCli("getzmqnotifications", "") + HelpExampleRpc("getzmqnotifications", ""));
+
+    UniValue result(UniValue::VARR);
+    if (pzmqNotificationInterface != NULL) {
+        for (const CZMQAbstractNotifier* n : pzmqNotificationInterface->GetActiveNotifiers()) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("type", n->GetType()));
+            obj.push_back(Pair("address", n->GetAddress()));
+            obj.push_back(Pair("hwm", n->GetOutboundMessageHighWaterMark()));
+            obj.push_back(Pair("sent", n->GetMessagesSent()));
+            obj.push_back(Pair("dropped", n->GetMessagesDropped()));
+            result.push_back(obj);
+        }
+    }
+
+    return result;
+}
+
+static const CRPCCommand vZMQRPCCommands[] =
+{ //  category              name                        actor (function)           okSafeMode
+  //  --------------------- --------------------------  -------------------------  ----------
+    { "zmq",                "getzmqnotifications",      &getzmqnotifications,      true  },
+};
+
+void zmqRegisterRPCCommands()
+{
+    unsigned int vcidx;
+    for (vcidx = 0; vcidx < ARRAYLEN(vZMQRPCCommands); vcidx++)
+    {
+        const CRPCCommand *pcmd;
+
+        pcmd = &vZMQRPCCommands[vcidx];
+        tableRPC.appendCommand(pcmd->name, pcmd);
+    }
+}
@@ -0,0 +1,11 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2021-2022 The DECENOMY Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ZMQ_ZMQRPC_H
+#define BITCOIN_ZMQ_ZMQRPC_H
+
+void zmqRegisterRPCCommands();
+
+#endif // BITCOIN_ZMQ_ZMQRPC_H
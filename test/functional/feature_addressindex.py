@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the address index (-addressindex) and the spent index (-spentindex).
+
+- Node 0 maintains the indexes from the start, node 1 runs without them.
+- Pay an address, check getaddressbalance, getaddressutxos and getaddresstxids.
+- Spend from the address and check again and getspentinfo, then invalidate the block and check the spend is reverted.
+- Check the fees getblockindexstats sums for a block with several paying transactions.
+- Check getblockindexstats from the block fee records against node 1, which reads the blocks.
+- Restart node 1 with both indexes, which builds them for its chain, and compare.
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class AddressIndexTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-addressindex", "-spentindex"], []]
+
+    def run_test(self):
+        self.nodes[0].generate(101)
+        self.sync_all()
+
+        assert_raises_rpc_error(-1, "Address index not enabled", self.nodes[1].getaddressbalance, [self.nodes[1].getnewaddress()])
+        assert_raises_rpc_error(-5, "Invalid address", self.nodes[0].getaddressbalance, ["notanaddress"])
+        assert_raises_rpc_error(-1, "Spent index not enabled", self.nodes[1].getspentinfo, {"txid": self.nodes[1].getbestblockhash(), "index": 0})
+
+        self.log.info("Pay an address")
+        address = self.nodes[1].getnewaddress()
+        txid1 = self.nodes[0].sendtoaddress(address, 10)
+        txid2 = self.nodes[0].sendtoaddress(address, 5)
+        txid_change = self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1)
+        self.nodes[0].generate(1)
+        self.sync_all()
+        height = self.nodes[0].getblockcount()
+
+        # the fees of the block are the sum of the fees of its transactions
+        fees = -sum(self.nodes[0].gettransaction(txid)["fee"] for txid in (txid1, txid2, txid_change))
+        for node in self.nodes:
+            stats = node.getblockindexstats(height, 1)
+            assert_equal(stats["txcount"], 3)
+            assert_equal(Decimal(stats["ttlfee"]), fees)
+            fee_stats = node.getblockindexstats(height, 1, True)
+            assert "txcount_all" not in fee_stats
+            assert_equal(fee_stats["ttlfee"], stats["ttlfee"])
+
+        balance = self.nodes[0].getaddressbalance([address])
+        assert_equal(balance["balance"], Decimal("15"))
+        assert_equal(balance["received"], Decimal("15"))
+        utxos = self.nodes[0].getaddressutxos([address])
+        assert_equal(sorted(u["txid"] for u in utxos), sorted([txid1, txid2]))
+        for utxo in utxos:
+            assert_equal(utxo["address"], address)
+            assert_equal(utxo["height"], height)
+        assert_equal(sorted(self.nodes[0].getaddresstxids([address])), sorted([txid1, txid2]))
+        assert_equal(self.nodes[0].getaddresstxids([address], 1, height - 1), [])
+
+        self.log.info("Spend from the address")
+        txid3 = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 12)
+        self.sync_all()
+        self.nodes[0].generate(1)
+        self.sync_all()
+
+        balance = self.nodes[0].getaddressbalance([address])
+        assert_equal(balance["balance"], Decimal("0"))
+        assert_equal(balance["received"], Decimal("15"))
+        assert_equal(self.nodes[0].getaddressutxos([address]), [])
+        assert_equal(self.nodes[0].getaddresstxids([address], height + 1), [txid3])
+        outputs = [{"txid": u["txid"], "index": u["outputIndex"]} for u in utxos]
+        for output in outputs:
+            spent = self.nodes[0].getspentinfo(output)
+            assert_equal(spent["txid"], txid3)
+            assert_equal(spent["height"], height + 1)
+        assert_equal(sorted(self.nodes[0].getspentinfo(o)["value"] for o in outputs), [Decimal("5"), Decimal("10")])
+        assert_equal(self.nodes[0].getblockindexstats(1, height + 1), self.nodes[1].getblockindexstats(1, height + 1))
+
+        self.log.info("Disconnect the spending block")
+        tip = self.nodes[0].getbestblockhash()
+        self.nodes[0].invalidateblock(tip)
+        assert_equal(self.nodes[0].getaddressbalance([address])["balance"], Decimal("15"))
+        assert_equal(len(self.nodes[0].getaddressutxos([address])), 2)
+        assert_raises_rpc_error(-5, "Unable to get spent info", self.nodes[0].getspentinfo, outputs[0])
+        self.nodes[0].reconsiderblock(tip)
+        assert_equal(self.nodes[0].getaddressbalance([address])["balance"], Decimal("0"))
+        assert_equal(self.nodes[0].getspentinfo(outputs[0])["txid"], txid3)
+
+        self.log.info("Build the indexes of an existing chain")
+        self.stop_node(1)
+        self.start_node(1, ["-addressindex", "-spentindex"])
+        for rpc in ("getaddressbalance", "getaddressutxos", "getaddresstxids"):
+            assert_equal(getattr(self.nodes[1], rpc)([address]), getattr(self.nodes[0], rpc)([address]))
+        for output in outputs:
+            assert_equal(self.nodes[1].getspentinfo(output), self.nodes[0].getspentinfo(output))
+        assert_equal(self.nodes[1].getblockindexstats(1, height + 1), self.nodes[0].getblockindexstats(1, height + 1))
+
+if __name__ == '__main__':
+    AddressIndexTest().main()
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test -bootstrap with -bootstrapmode=stream from a local file:// URL.
+
+- Generate blocks on node 0, stop it and split its block file into chunks with a manifest.
+- Leave a truncated download of the first chunk in node 1's bootstrap folder.
+- Start node 1 with a bootstrap whose second chunk holds a corrupted block. Verify that
+  it imports the first chunk, resuming the partial download, and leaves the second
+  chunk unmarked.
+- Restart node 1 with the correct bootstrap. Verify that it imports all blocks and
+  deletes the chunks once imported.
+- Restart node 1 with the same options. Verify that nothing is imported again.
+"""
+
+from test_framework.test_framework import PivxTestFramework, SkipTest
+from test_framework.util import assert_equal, wait_until
+import configparser
+import hashlib
+import os
+import struct
+
+BLOCKS_PER_CHUNK = 10
+
+class BootstrapStreamTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        # Check that the daemon has been built with the bootstrap enabled
+        config = configparser.ConfigParser()
+        if not self.options.configfile:
+            self.options.configfile = os.path.abspath(os.path.join(os.path.dirname(__file__), "../config.ini"))
+        config.read_file(open(self.options.configfile))
+
+        if not config["components"].getboolean("ENABLE_BOOTSTRAP"):
+            raise SkipTest("oneworldd has not been built with bootstrap enabled.")
+
+        self.setup_nodes()
+
+    def write_chunks(self, blkfile, outdir, corrupt=None):
+        """Splits a block file at block boundaries and writes the manifest.
+        The merkle root of block number corrupt, if given, is damaged."""
+        with open(blkfile, 'rb') as f:
+            data = f.read()
+        magic = data[:4]
+        records = []
+        pos = 0
+        while pos + 8 <= len(data) and data[pos:pos + 4] == magic:
+            size = struct.unpack('<I', data[pos + 4:pos + 8])[0]
+            records.append(data[pos:pos + 8 + size])
+            pos += 8 + size
+        if corrupt is not None:
+            record = bytearray(records[corrupt])
+            # magic, size, version and previous block hash precede the merkle root
+            record[8 + 4 + 32] ^= 0xff
+            records[corrupt] = bytes(record)
+
+        os.makedirs(outdir)
+        lines = ["# sha256 size name"]
+        for i in range(0, len(records), BLOCKS_PER_CHUNK):
+            chunk = b''.join(records[i:i + BLOCKS_PER_CHUNK])
+            name = "chunk%03d.dat" % (i // BLOCKS_PER_CHUNK)
+            with open(os.path.join(outdir, name), 'wb') as f:
+                f.write(chunk)
+            lines.append("%s %d %s" % (hashlib.sha256(chunk).hexdigest(), len(chunk), name))
+        with open(os.path.join(outdir, "bootstrap.manifest"), 'w') as f:
+            f.write("\n".join(lines) + "\n")
+        return len(records)
+
+    def run_test(self):
+        self.nodes[0].generate(35)
+        blockcount = self.nodes[0].getblockcount()
+        besthash = self.nodes[0].getbestblockhash()
+        self.stop_node(0)
+
+        srcdir = os.path.join(self.options.tmpdir, "bootstrap_src")
+        badsrcdir = os.path.join(self.options.tmpdir, "bootstrap_bad")
+        blkfile = os.path.join(self.nodes[0].datadir, "regtest", "blocks", "blk00000.dat")
+        nblocks = self.write_chunks(blkfile, srcdir)
+        assert_equal(nblocks, blockcount + 1)
+        self.write_chunks(blkfile, badsrcdir, corrupt=BLOCKS_PER_CHUNK)
+
+        self.log.info("Leave a partial download of the first chunk")
+        bootstrapdir = os.path.join(self.nodes[1].datadir, "regtest", "bootstrap")
+        os.makedirs(bootstrapdir)
+        with open(os.path.join(srcdir, "chunk000.dat"), 'rb') as f:
+            first = f.read()
+        with open(os.path.join(bootstrapdir, "chunk000.dat.part"), 'wb') as f:
+            f.write(first[:len(first) // 2])
+
+        self.log.info("Stream a bootstrap with a corrupted block into node 1")
+        debuglog = os.path.join(self.nodes[1].datadir, "regtest", "debug.log")
+        self.restart_node(1, ["-bootstrap", "-bootstrapmode=stream", "-bootstrapurl=file://" + badsrcdir + "/"])
+        wait_until(lambda: "Failed to import chunk001.dat" in open(debuglog).read(), timeout=60)
+        assert_equal(self.nodes[1].getblockcount(), BLOCKS_PER_CHUNK - 1)
+        with open(os.path.join(bootstrapdir, "imported")) as f:
+            assert_equal(len(f.read().split()), 1)
+        assert os.path.exists(os.path.join(bootstrapdir, "chunk001.dat"))
+        # the corrupted chunk was verified against its manifest, drop it to fetch the good one
+        self.stop_node(1)
+        os.remove(os.path.join(bootstrapdir, "chunk001.dat"))
+
+        self.log.info("Stream the bootstrap into node 1")
+        args = ["-bootstrap", "-bootstrapmode=stream", "-bootstrapurl=file://" + srcdir + "/"]
+        self.start_node(1, args)
+        wait_until(lambda: self.nodes[1].getblockcount() == blockcount, timeout=60)
+        wait_until(lambda: not [f for f in os.listdir(bootstrapdir) if f.startswith("chunk")], timeout=30)
+        assert_equal(self.nodes[1].getbestblockhash(), besthash)
+        with open(os.path.join(bootstrapdir, "imported")) as f:
+            assert_equal(len(f.read().split()), (nblocks + BLOCKS_PER_CHUNK - 1) // BLOCKS_PER_CHUNK)
+
+        self.log.info("A restart finds everything imported")
+        self.restart_node(1, args)
+        assert_equal(self.nodes[1].getblockcount(), blockcount)
+        assert not [f for f in os.listdir(bootstrapdir) if f.startswith("chunk")]
+        self.log.info("Success")
+
+if __name__ == '__main__':
+    BootstrapStreamTest().main()
@@ -265,6 +265,34 @@ class RESTTest (PivxTestFramework):
         json_obj = json.loads(response_header_json_str)
         assert_equal(len(json_obj), 5) #now we should have 5 header objects
 
+        #################
+        # /rest/blocks/ #
+        #################
+
+        # binary blocks of a height range, back to back, as the node serializes them
+        bb_height = self.nodes[0].getblock(bb_hash)['height']
+        range_hashes = [self.nodes[0].getblockhash(h) for h in range(bb_height, bb_height + 3)]
+        expected_hex = [self.nodes[0].getblock(block_hash, False) for block_hash in range_hashes]
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/3/'+str(bb_height)+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read(), b''.join(hex_str_to_bytes(block_hex) for block_hex in expected_hex))
+
+        # one block per line in hex, an array of blocks without tx details in json
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/3/'+str(bb_height)+self.FORMAT_SEPARATOR+"hex", True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read().decode('utf-8').split(), expected_hex)
+        json_obj = json.loads(http_get_call(url.hostname, url.port, '/rest/blocks/3/'+str(bb_height)+self.FORMAT_SEPARATOR+"json"))
+        assert_equal([block['hash'] for block in json_obj], range_hashes)
+
+        # the range stops at the tip, a start past it is not found
+        tip_height = self.nodes[0].getblockcount()
+        json_obj = json.loads(http_get_call(url.hostname, url.port, '/rest/blocks/1000/'+str(tip_height)+self.FORMAT_SEPARATOR+"json"))
+        assert_equal(len(json_obj), 1)
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/1/'+str(tip_height + 1)+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/1001/0'+self.FORMAT_SEPARATOR+"bin", True)
+        assert_equal(response.status, 400)
+
         # do tx test
         tx_hash = block_json_obj['tx'][0]['txid']
         json_string = http_get_call(url.hostname, url.port, '/rest/tx/'+tx_hash+self.FORMAT_SEPARATOR+"json")
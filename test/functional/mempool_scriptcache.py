@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the script execution cache statistics in getmempoolinfo.
+
+- Send transactions to the mempool and mine them. Verify that connecting the
+  block found all of them in the script execution cache.
+- Mine a block without mempool transactions. Verify that the counts stay.
+"""
+
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal
+
+class MempoolScriptCacheTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        info = node.getmempoolinfo()
+        assert_equal(info['scriptcachelookups'], 0)
+        assert_equal(info['scriptcachehits'], 0)
+        assert_equal(info['scriptcachehitratio'], 0)
+
+        self.log.info("Mine transactions accepted to the mempool")
+        txids = [node.sendtoaddress(node.getnewaddress(), 1) for _ in range(5)]
+        assert_equal(sorted(node.getrawmempool()), sorted(txids))
+        node.generate(1)
+        assert_equal(node.getrawmempool(), [])
+        info = node.getmempoolinfo()
+        assert_equal(info['scriptcachelookups'], 5)
+        assert_equal(info['scriptcachehits'], 5)
+
+        self.log.info("An empty block hits nothing")
+        node.generate(1)
+        info = node.getmempoolinfo()
+        assert_equal(info['scriptcachelookups'], 5)
+        assert_equal(info['scriptcachehits'], 5)
+
+if __name__ == '__main__':
+    MempoolScriptCacheTest().main()
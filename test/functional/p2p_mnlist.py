@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The DECENOMY Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the per peer counters of masternode list requests (dseg) in getpeerinfo.
+
+- A peer asks for the whole list, which is served.
+- It asks again right away, which is refused (-forcedseglimit applies the
+  mainnet limit to local peers on regtest).
+- A request for a single entry is not counted.
+"""
+
+from test_framework.messages import COutPoint, CTxIn, msg_generic
+from test_framework.mininode import P2PInterface, network_thread_start
+from test_framework.test_framework import PivxTestFramework
+from test_framework.util import assert_equal, wait_until
+
+def msg_dseg(vin=None):
+    if vin is None:
+        vin = CTxIn(COutPoint(0, 0xffffffff), b"", 0xffffffff)
+    return msg_generic(b"dseg", vin.serialize())
+
+class MasternodeListRequestTest(PivxTestFramework):
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-forcedseglimit"]]
+
+    def get_counters(self):
+        peer = self.nodes[0].getpeerinfo()[0]
+        return peer["mnlistrequests"], peer["mnlistrefused"], peer["mnlistlastrequest"]
+
+    def run_test(self):
+        node = self.nodes[0]
+        # masternode messages are only handled once the chain is synced
+        node.generate(1)
+
+        node.add_p2p_connection(P2PInterface())
+        network_thread_start()
+        node.p2p.wait_for_verack()
+        assert_equal(self.get_counters(), (0, 0, 0))
+
+        self.log.info("Request the list")
+        node.p2p.send_message(msg_dseg())
+        wait_until(lambda: self.get_counters()[0] == 1, timeout=30)
+        requests, refused, last = self.get_counters()
+        assert_equal(refused, 0)
+        assert last > 0
+
+        self.log.info("Request it again, too soon")
+        node.p2p.send_message(msg_dseg())
+        wait_until(lambda: self.get_counters()[0] == 2, timeout=30)
+        assert_equal(self.get_counters()[1], 1)
+
+        self.log.info("Request a single entry")
+        node.p2p.send_message(msg_dseg(CTxIn(COutPoint(1, 0), b"", 0xffffffff)))
+        node.p2p.sync_with_ping()
+        assert_equal(self.get_counters()[:2], (2, 1))
+
+if __name__ == '__main__':
+    MasternodeListRequestTest().main()
@@ -93,6 +93,8 @@ BASE_SCRIPTS= [
     'rpc_deprecated.py',                        # ~ 80 sec
     'interface_bitcoin_cli.py',                 # ~ 80 sec
     'mempool_packages.py',                      # ~ 63 sec
+    'feature_addressindex.py',                  # ~ 60 sec
+    'feature_bootstrap_stream.py',              # ~ 60 sec
 
     # vv Tests less than 60s vv
     'wallet_labels.py',                         # ~ 57 sec
@@ -105,6 +107,8 @@ BASE_SCRIPTS= [
     'wallet_disable.py',                        # ~ 50 sec
     'wallet_autocombine.py',                    # ~ 49 sec
     'mining_v5_upgrade.py',                     # ~ 48 sec
+    'p2p_mnlist.py',                            # ~ 30 sec
+    'mempool_scriptcache.py',                   # ~ 30 sec
     'feature_help.py',                          # ~ 30 sec
 
     # Don't append tests at the end to avoid merge conflicts
@@ -152,6 +156,7 @@ EXTENDED_SCRIPTS = [
 
 LEGACY_SKIP_TESTS = [
     # These tests are not run when the flag --legacywallet is used
+    'feature_bootstrap_stream.py',
     'feature_help.py',
     'feature_logging.py',
     'feature_reindex.py',